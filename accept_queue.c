@@ -0,0 +1,32 @@
+#define _GNU_SOURCE
+
+#include "accept_queue.h"
+
+/* Public functions */
+
+// Same test as the kernel's sk_acceptq_is_full(): new connections are dropped.
+bool aq_is_saturated(int len, int backlog) { return len > backlog; }
+
+void aq_add_sample(AcceptQueue *aq, int len, int backlog,
+                   unsigned long time_usec) {
+        // Time since the previous sample is charged to its state.
+        if (aq->samples && aq_is_saturated(aq->current, aq->backlog) &&
+            time_usec > aq->last_sample_usec)
+                aq->saturated_usec += time_usec - aq->last_sample_usec;
+
+        aq->samples++;
+        aq->current = len;
+        aq->backlog = backlog;
+        aq->len_sum += len;
+        if (len > aq->high_water) aq->high_water = len;
+        if (aq_is_saturated(len, backlog)) {
+                if (!aq->saturated_samples)
+                        aq->first_saturation_usec = time_usec;
+                aq->saturated_samples++;
+        }
+        aq->last_sample_usec = time_usec;
+}
+
+double aq_mean_len(const AcceptQueue *aq) {
+        return aq->samples ? (double)aq->len_sum / aq->samples : 0;
+}
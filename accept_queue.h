@@ -0,0 +1,29 @@
+#ifndef ACCEPT_QUEUE_H
+#define ACCEPT_QUEUE_H
+
+#include <stdbool.h>
+
+/* Accept queue of a listening TCP socket, sampled from TCP_INFO: for a
+ * listener, tcpi_unacked holds the number of connections waiting to be
+ * accepted and tcpi_sacked the backlog limit. */
+
+typedef struct {
+        int backlog;  // Limit of the queue, as reported by the kernel.
+        long samples;
+        int current;     // Queue length at the last sample.
+        int high_water;  // Longest queue seen.
+        unsigned long len_sum;
+        long saturated_samples;  // Samples with a full queue.
+        unsigned long saturated_usec;  // Time spent with a full queue.
+        unsigned long first_saturation_usec;
+        unsigned long last_sample_usec;
+} AcceptQueue;
+
+void aq_add_sample(AcceptQueue *aq, int len, int backlog,
+                   unsigned long time_usec);
+
+bool aq_is_saturated(int len, int backlog);
+
+double aq_mean_len(const AcceptQueue *aq);
+
+#endif
@@ -0,0 +1,105 @@
+#define _GNU_SOURCE
+
+#include "anomalies.h"
+#include <string.h>
+#include "init.h"
+
+/* Private functions */
+
+static void update(Anomalies *anom, AnomalyKind kind, bool detected,
+                   unsigned long value, unsigned long baseline) {
+        bool was_ongoing = anom->ongoing[kind];
+        anom->ongoing[kind] = detected;
+        if (!detected || was_ongoing) return;
+        anom->counts[kind]++;
+        if (anom->pending_count == ANOM_KINDS) return;
+        Anomaly *a = &anom->pending[anom->pending_count++];
+        a->kind = kind;
+        a->value = value;
+        a->baseline = baseline;
+}
+
+static void detect_rtt_spike(Anomalies *anom, unsigned long rtt) {
+        unsigned long ewma = anom->rtt_ewma8 >> 3;
+        unsigned long mdev = anom->rtt_mdev4 >> 2;
+        bool spike = anom->samples > ANOM_WARMUP && rtt > 2 * ewma &&
+                     rtt > ewma + 4 * mdev;
+        update(anom, ANOM_RTT_SPIKE, spike, rtt, ewma);
+
+        // Same smoothing as the SRTT of the kernel.
+        if (!anom->rtt_ewma8) {
+                anom->rtt_ewma8 = rtt << 3;
+                anom->rtt_mdev4 = rtt << 1;
+                return;
+        }
+        long err = (long)rtt - (long)ewma;
+        anom->rtt_ewma8 += err;
+        if (err < 0) err = -err;
+        anom->rtt_mdev4 += err - (long)mdev;
+}
+
+/* Public functions */
+
+bool anom_on_sample(Anomalies *anom, const struct tcp_info *info,
+                    int outq_nsd, unsigned long time_usec) {
+        if (info->tcpi_state != TCP_ESTABLISHED &&
+            info->tcpi_state != TCP_CLOSE_WAIT)
+                return false;
+        int pending_before = anom->pending_count;
+        anom->samples++;
+
+        if (info->tcpi_rtt) detect_rtt_spike(anom, info->tcpi_rtt);
+
+        unsigned int cwnd = info->tcpi_snd_cwnd;
+        bool collapse = info->tcpi_ca_state == TCP_CA_Loss ||
+                        (anom->last_cwnd >= 4 && cwnd * 4 <= anom->last_cwnd);
+        update(anom, ANOM_CWND_COLLAPSE, collapse, cwnd, anom->last_cwnd);
+        anom->last_cwnd = cwnd;
+
+        unsigned int retrans =
+            info->tcpi_total_retrans - anom->last_total_retrans;
+        update(anom, ANOM_RETRANS_BURST,
+               anom->samples > 1 && retrans >= ANOM_BURST_SEGMENTS, retrans,
+               0);
+        anom->last_total_retrans = info->tcpi_total_retrans;
+
+        bool zero_window = outq_nsd >= (int)info->tcpi_snd_mss &&
+                           info->tcpi_snd_mss && !info->tcpi_unacked;
+        update(anom, ANOM_ZERO_WINDOW, zero_window, outq_nsd, 0);
+
+        if (anom->pending_count == pending_before) return false;
+        if (conf_opt_w & ANOM_OPT_BOOST)
+                anom->boost_until_usec = time_usec + ANOM_BOOST_USEC;
+        return true;
+}
+
+bool anom_is_boosted(const Anomalies *anom, unsigned long time_usec) {
+        return time_usec < anom->boost_until_usec;
+}
+
+int anom_take(Anomalies *anom, Anomaly anomalies[ANOM_KINDS]) {
+        int count = anom->pending_count;
+        memcpy(anomalies, anom->pending, count * sizeof(Anomaly));
+        anom->pending_count = 0;
+        return count;
+}
+
+unsigned long anom_rtt_ewma(const Anomalies *anom) {
+        return anom->rtt_ewma8 >> 3;
+}
+
+const char *anom_kind_str(AnomalyKind kind) {
+        switch (kind) {
+                case ANOM_RTT_SPIKE:
+                        return "rtt_spike";
+                case ANOM_CWND_COLLAPSE:
+                        return "cwnd_collapse";
+                case ANOM_RETRANS_BURST:
+                        return "retrans_burst";
+                case ANOM_ZERO_WINDOW:
+                        return "zero_window";
+                case ANOM_KINDS:
+                        break;
+        }
+        return "unknown";
+}
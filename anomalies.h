@@ -0,0 +1,72 @@
+#ifndef ANOMALIES_H
+#define ANOMALIES_H
+
+#include <netinet/tcp.h>
+#include <stdbool.h>
+
+/* Online detection of the degradations of a TCP connection, over its TCP_INFO
+ * samples (-b or -u). Each detector keeps a few values per socket:
+ * - rtt_spike: the RTT goes over twice its EWMA and over the EWMA plus 4 mean
+ *   deviations, computed the way the kernel smooths the RTT (gains 1/8, 1/4);
+ * - cwnd_collapse: the congestion window loses 3/4 of its value since the
+ *   previous sample, or the connection enters the Loss state (timeout);
+ * - retrans_burst: ANOM_BURST_SEGMENTS segments or more are retransmitted
+ *   between two samples;
+ * - zero_window: at least a full segment waits to be sent while nothing is in
+ *   flight, the peer has closed its receive window.
+ * An anomaly is reported when it starts, not again until its condition clears.
+ * With -w, an anomaly also makes tcpsnitch sample TCP_INFO every
+ * ANOM_BOOST_INTERVAL_USEC during ANOM_BOOST_USEC (-w 1), and flush the packet
+ * capture of the socket (-w 2). */
+
+#define ANOM_WARMUP 4              // Samples before detecting RTT spikes.
+#define ANOM_BURST_SEGMENTS 3      // Retransmitted between two samples.
+#define ANOM_BOOST_USEC 1000000    // Faster sampling after an anomaly.
+#define ANOM_BOOST_INTERVAL_USEC 10000
+
+#define ANOM_OPT_BOOST 1  // -w bit: sample TCP_INFO faster.
+#define ANOM_OPT_FLUSH 2  // -w bit: flush the packet capture.
+
+typedef enum AnomalyKind {
+        ANOM_RTT_SPIKE,
+        ANOM_CWND_COLLAPSE,
+        ANOM_RETRANS_BURST,
+        ANOM_ZERO_WINDOW,
+        ANOM_KINDS
+} AnomalyKind;
+
+typedef struct {
+        AnomalyKind kind;
+        unsigned long value;     // Value of the sample.
+        unsigned long baseline;  // Value expected.
+} Anomaly;
+
+typedef struct {
+        long samples;
+        unsigned long rtt_ewma8;  // 8 times the EWMA of the RTT, in usec.
+        unsigned long rtt_mdev4;  // 4 times its mean deviation.
+        unsigned int last_cwnd;
+        unsigned int last_total_retrans;
+        bool ongoing[ANOM_KINDS];
+        long counts[ANOM_KINDS];
+        Anomaly pending[ANOM_KINDS];  // Not pushed as events yet.
+        int pending_count;
+        unsigned long boost_until_usec;
+} Anomalies;
+
+// A TCP_INFO sample, with outq_nsd bytes not sent yet (SIOCOUTQNSD, -1 if
+// unknown). Returns true if an anomaly started.
+bool anom_on_sample(Anomalies *anom, const struct tcp_info *info,
+                    int outq_nsd, unsigned long time_usec);
+
+// TCP_INFO is sampled faster after an anomaly (-w 1).
+bool anom_is_boosted(const Anomalies *anom, unsigned long time_usec);
+
+// Moves the anomalies not pushed yet to anomalies, returns their number.
+int anom_take(Anomalies *anom, Anomaly anomalies[ANOM_KINDS]);
+
+unsigned long anom_rtt_ewma(const Anomalies *anom);
+
+const char *anom_kind_str(AnomalyKind kind);
+
+#endif
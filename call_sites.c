@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+
+#include "call_sites.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef __ANDROID__
+#include <execinfo.h>
+#endif
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+// Frames of tcpsnitch above the caller, at most.
+#define CS_OWN_FRAMES 8
+
+// Call sites of a thread, only written by that thread. They stay after the
+// thread exits, until dumped.
+typedef struct CsTable {
+        CallSite sites[CS_THREAD_MAX];
+        struct CsTable *next;
+} CsTable;
+
+static __thread const void *current_addr;
+static __thread unsigned long current_start_usec;
+static __thread CsTable *thread_table;
+static __thread bool thread_untabled;  // Beyond CS_MAX_TABLES.
+
+// Protects the list of the tables, and the calls of the threads without a
+// table or with a full one.
+static pthread_mutex_t cs_mutex = MUTEX_ERRORCHECK;
+static CsTable *tables = NULL;
+static int tables_count = 0;
+static CallSite sites[CS_MAX];
+static long sites_dropped = 0;  // Calls from sites beyond CS_MAX.
+
+/* Private functions */
+
+// Open addressing, the tables never shrink.
+static CallSite *get_site(CallSite *table, int size, const void *addr) {
+        unsigned int i = ((uintptr_t)addr >> 2) % size;
+        for (int probes = 0; probes < size; probes++) {
+                CallSite *site = &table[(i + probes) % size];
+                if (site->addr == addr) return site;
+                if (site->addr) continue;
+                site->addr = addr;
+                return site;
+        }
+        return NULL;
+}
+
+// Registered once, under the mutex. NULL beyond CS_MAX_TABLES.
+static CsTable *get_thread_table(void) {
+        if (thread_table || thread_untabled) return thread_table;
+        mutex_lock(&cs_mutex);
+        if (tables_count < CS_MAX_TABLES) {
+                thread_table = (CsTable *)my_calloc(sizeof(CsTable));
+                thread_table->next = tables;
+                tables = thread_table;
+                tables_count++;
+        } else {
+                thread_untabled = true;
+        }
+        mutex_unlock(&cs_mutex);
+        return thread_table;
+}
+
+// Returns true if the stack of the call should be captured.
+static bool add_call(CallSite *site, int type, bool success, long bytes,
+                     unsigned long latency_usec) {
+        if (!site->calls) site->type = type;
+        site->calls++;
+        if (!success) site->errors++;
+        if (bytes >= 0) {
+                site->bytes += bytes;
+                histo_add(&site->bytes_per_call, bytes);
+        }
+        histo_add(&site->latency, latency_usec);
+        // The first call of a site, then one out of conf_opt_r.
+        return conf_opt_r > 0 && (site->calls - 1) % conf_opt_r == 0;
+}
+
+// Adds the call sites of a thread to the process table merged, whose calls
+// beyond CS_MAX are counted in *dropped.
+static void merge_table(CallSite *merged, const CsTable *table,
+                        long *dropped) {
+        for (int i = 0; i < CS_THREAD_MAX; i++) {
+                const CallSite *src = &table->sites[i];
+                if (!src->calls) continue;
+                CallSite *dst = get_site(merged, CS_MAX, src->addr);
+                if (!dst) {
+                        *dropped += src->calls;
+                        continue;
+                }
+                if (!dst->calls) dst->type = src->type;
+                dst->calls += src->calls;
+                dst->errors += src->errors;
+                dst->bytes += src->bytes;
+                histo_merge(&dst->bytes_per_call, &src->bytes_per_call);
+                histo_merge(&dst->latency, &src->latency);
+        }
+}
+
+static void dump_maps(void) {
+        char *path = alloc_concat_path(logs_dir_path, "maps.txt");
+        if (!path) goto error;
+        FILE *in = fopen("/proc/self/maps", "r");
+        FILE *out = fopen(path, "w");
+        free(path);
+        if (!in || !out) goto error1;
+
+        char line[512];
+        while (fgets(line, sizeof(line), in)) my_fputs(line, out);
+
+        fclose(in);
+        if (fclose(out) == EOF)
+                LOG(ERROR, "fclose() failed. %s.", strerror(errno));
+        return;
+error1:
+        if (in) fclose(in);
+        if (out) fclose(out);
+error:
+        LOG(ERROR, "Could not copy /proc/self/maps.");
+        LOG_FUNC_ERROR;
+}
+
+static char *alloc_site_line(int i, void *arg) {
+        const CallSite *site = &((CallSite *)arg)[i];
+        return site->calls ? alloc_call_site_json(site) : NULL;
+}
+
+/* Public functions */
+
+void cs_enter(const void *ret_addr, bool timed) {
+        current_addr = ret_addr;
+        current_start_usec = timed ? get_time_micros() : 0;
+}
+
+const void *cs_take(unsigned long *start_usec) {
+        const void *addr = current_addr;
+        *start_usec = current_start_usec;
+        current_addr = NULL;
+        return addr;
+}
+
+bool cs_on_call(const void *addr, int type, bool success, long bytes,
+                unsigned long latency_usec) {
+        if (!addr) return false;
+        CsTable *table = get_thread_table();
+        CallSite *site =
+            table ? get_site(table->sites, CS_THREAD_MAX, addr) : NULL;
+        if (site) return add_call(site, type, success, bytes, latency_usec);
+
+        bool sample = false;
+        mutex_lock(&cs_mutex);
+        site = get_site(sites, CS_MAX, addr);
+        if (site)
+                sample = add_call(site, type, success, bytes, latency_usec);
+        else
+                sites_dropped++;
+        mutex_unlock(&cs_mutex);
+        return sample;
+}
+
+int cs_capture_stack(const void *addr, void ***frames) {
+#ifdef __ANDROID__
+        UNUSED(addr);
+        UNUSED(frames);
+        return 0;
+#else
+        void *buf[CS_MAX_STACK + CS_OWN_FRAMES];
+        int depth = backtrace(buf, CS_MAX_STACK + CS_OWN_FRAMES);
+        // Skip the frames of tcpsnitch, up to the caller.
+        int first = 0;
+        while (first < depth && buf[first] != addr) first++;
+        if (first == depth) return 0;
+        int count = depth - first;
+        if (count > CS_MAX_STACK) count = CS_MAX_STACK;
+        *frames = (void **)my_malloc(count * sizeof(void *));
+        if (!*frames) return 0;
+        memcpy(*frames, buf + first, count * sizeof(void *));
+        return count;
+#endif
+}
+
+void dump_all_call_sites(void) {
+        if (!logs_dir_path) return;
+        CallSite *merged = NULL;
+        mutex_lock(&cs_mutex);
+        // The threads may still be running: their calls in progress are
+        // missed.
+        merged = (CallSite *)my_malloc(sizeof(sites));
+        if (!merged) goto error;
+        memcpy(merged, sites, sizeof(sites));
+        long dropped = sites_dropped;
+        for (const CsTable *t = tables; t; t = t->next)
+                merge_table(merged, t, &dropped);
+        bool found = false;
+        for (int i = 0; i < CS_MAX && !found; i++) found = merged[i].calls;
+        if (!found) goto exit;
+
+        LOG_FUNC_INFO;
+        if (dropped)
+                LOG(WARN, "%ld calls from untracked call sites.", dropped);
+        if (!write_json_lines("call_sites.json", false, CS_MAX, alloc_site_line,
+                              merged))
+                goto error;
+        dump_maps();
+        goto exit;
+error:
+        LOG(ERROR, "Could not write call sites.");
+        LOG_FUNC_ERROR;
+exit:
+        mutex_unlock(&cs_mutex);
+        free(merged);
+}
+
+void cs_reset(void) {
+        mutex_init(&cs_mutex);
+        while (tables) {
+                CsTable *next = tables->next;
+                free(tables);
+                tables = next;
+        }
+        tables_count = 0;
+        thread_table = NULL;
+        thread_untabled = false;
+        memset(sites, 0, sizeof(sites));
+        sites_dropped = 0;
+}
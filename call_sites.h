@@ -0,0 +1,57 @@
+#ifndef CALL_SITES_H
+#define CALL_SITES_H
+
+#include <stdbool.h>
+#include "histogram.h"
+
+/* Attribution of the socket calls to the code of the application. Each
+ * overridden function records its return address, that is the instruction
+ * following the call in the caller, and, for the calls on Internet sockets,
+ * the time at which it was called. The calls are then aggregated per call
+ * site: number of calls and errors, bytes and latency. Each thread aggregates
+ * its calls in its own table, without lock, and the tables are merged when
+ * dumped. With -r <n>, the full stack of one call out of <n> is also captured
+ * per call site and per thread.
+ *
+ * Addresses are not symbolized at runtime: /proc/self/maps is copied to
+ * maps.txt at exit, so that addresses can be mapped offline to a module and an
+ * offset (e.g. with addr2line). */
+
+#define CS_MAX 1024        // Call sites tracked per process.
+#define CS_THREAD_MAX 64   // Call sites in the table of a thread.
+#define CS_MAX_TABLES 64   // Threads with a table, the others lock.
+#define CS_MAX_STACK 32    // Frames per captured stack.
+
+typedef struct {
+        const void *addr;  // Return address in the caller, NULL if unused.
+        int type;          // SockEventType of the first call.
+        long calls;
+        long errors;
+        unsigned long bytes;
+        Histogram bytes_per_call;  // Only for the calls moving data.
+        Histogram latency;         // In micro-seconds.
+} CallSite;
+
+// Called on entry of the overridden functions, with the return address. The
+// start time is only taken if timed, i.e. if the fd is an Internet socket.
+void cs_enter(const void *ret_addr, bool timed);
+
+// Returns the call site of the current call of the thread, and its start
+// time (0 if not timed). The call site is then cleared, so that the events
+// created by tcpsnitch itself are not attributed to it.
+const void *cs_take(unsigned long *start_usec);
+
+// Accounts for a call, bytes being -1 if the call does not move data.
+// Returns true if the stack of the call should be captured.
+bool cs_on_call(const void *addr, int type, bool success, long bytes,
+                unsigned long latency_usec);
+
+// Captures the stack of the current call, from the caller of the overridden
+// function. Returns the number of frames, *frames being allocated.
+int cs_capture_stack(const void *addr, void ***frames);
+
+void dump_all_call_sites(void);  // Written to call_sites.json and maps.txt.
+
+void cs_reset(void);  // Free state (called after fork()).
+
+#endif
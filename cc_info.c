@@ -0,0 +1,71 @@
+#define _GNU_SOURCE
+
+#include "cc_info.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "lib.h"
+
+/* Private functions */
+
+static CcKind kind_from_algorithm(const char *algorithm, socklen_t len) {
+        if (!strncmp(algorithm, "bbr", 3) &&
+            len >= sizeof(struct tcp_bbr_info))
+                return CC_BBR;
+        if (!strcmp(algorithm, "dctcp") && len >= sizeof(struct tcp_dctcp_info))
+                return CC_DCTCP;
+        // Westwood and Illinois fill a struct tcpvegas_info as well.
+        if ((!strcmp(algorithm, "vegas") || !strcmp(algorithm, "westwood") ||
+             !strcmp(algorithm, "illinois")) &&
+            len >= sizeof(struct tcpvegas_info))
+                return CC_VEGAS;
+        return CC_NONE;
+}
+
+/* Public functions */
+
+bool cc_fill_sample(int fd, CcSample *sample) {
+        memset(sample, 0, sizeof(CcSample));
+#ifdef TCP_CC_INFO
+        socklen_t len = sizeof(sample->algorithm) - 1;
+        if (!get_sockopt_if_supported(fd, IPPROTO_TCP, TCP_CONGESTION,
+                                      sample->algorithm, &len))
+                return false;
+        len = sizeof(sample->info);
+        if (!get_sockopt_if_supported(fd, IPPROTO_TCP, TCP_CC_INFO,
+                                      &sample->info, &len))
+                return false;
+        sample->kind = kind_from_algorithm(sample->algorithm, len);
+        return true;
+#else
+        UNUSED(fd);
+        return false;
+#endif
+}
+
+void cc_add_sample(CcStats *stats, const CcSample *sample) {
+        if (sample->kind == CC_NONE) return;
+        stats->samples++;
+        stats->last = *sample;
+        if (sample->kind == CC_BBR) {
+                const struct tcp_bbr_info *bbr = &sample->info.bbr;
+                uint64_t bw = cc_bbr_bw(bbr);
+                histo_add(&stats->bbr_bw, bw);
+                if (bw > stats->bbr_max_bw) stats->bbr_max_bw = bw;
+                // ~0U until the first RTT sample.
+                if (bbr->bbr_min_rtt != UINT32_MAX &&
+                    (!stats->bbr_min_rtt ||
+                     bbr->bbr_min_rtt < stats->bbr_min_rtt))
+                        stats->bbr_min_rtt = bbr->bbr_min_rtt;
+        } else if (sample->kind == CC_DCTCP) {
+                const struct tcp_dctcp_info *dctcp = &sample->info.dctcp;
+                histo_add(&stats->dctcp_alpha, dctcp->dctcp_alpha);
+                if (dctcp->dctcp_alpha > stats->dctcp_max_alpha)
+                        stats->dctcp_max_alpha = dctcp->dctcp_alpha;
+        }
+}
+
+uint64_t cc_bbr_bw(const struct tcp_bbr_info *bbr) {
+        return (uint64_t)bbr->bbr_bw_hi << 32 | bbr->bbr_bw_lo;
+}
@@ -0,0 +1,52 @@
+#ifndef CC_INFO_H
+#define CC_INFO_H
+
+#include <linux/inet_diag.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "histogram.h"
+
+/* Internal state of the congestion control algorithm of a TCP socket, read
+ * with TCP_CC_INFO along with each TCP_INFO sample (-b or -u). TCP_INFO gives
+ * the congestion window, not the reasons behind it:
+ * - BBR: bottleneck bandwidth estimate (bytes per second), min RTT, and the
+ *   pacing and cwnd gains of its current phase (shifted left 8 bits);
+ * - DCTCP: alpha, the estimated fraction of marked bytes (out of 1024), and
+ *   the bytes acknowledged with and without ECN-Echo in its last window;
+ * - Vegas (also reported by Westwood and Illinois): RTT and min RTT.
+ * The other algorithms (e.g. Cubic, Reno) report nothing. As the layout of the
+ * info depends on the algorithm, TCP_CONGESTION is read alongside. */
+
+#define CC_NAME_LEN 16  // TCP_CA_NAME_MAX.
+#define CC_GAIN_UNIT 256  // BBR_UNIT: gains are fixed point, 8 bits.
+#define CC_DCTCP_ALPHA_MAX 1024
+
+typedef enum CcKind { CC_NONE, CC_BBR, CC_DCTCP, CC_VEGAS } CcKind;
+
+typedef struct {
+        CcKind kind;  // CC_NONE if the algorithm reports nothing.
+        char algorithm[CC_NAME_LEN];
+        union tcp_cc_info info;
+} CcSample;
+
+typedef struct {
+        long samples;  // Samples with info.
+        CcSample last;
+        // BBR.
+        Histogram bbr_bw;  // Bytes per second.
+        uint64_t bbr_max_bw;
+        uint32_t bbr_min_rtt;  // Lowest min RTT in micro-seconds, 0 if none.
+        // DCTCP.
+        Histogram dctcp_alpha;  // Out of CC_DCTCP_ALPHA_MAX.
+        uint32_t dctcp_max_alpha;
+} CcStats;
+
+// Fills sample from fd. Returns false if TCP_CC_INFO is not supported, in
+// which case sample->kind is CC_NONE.
+bool cc_fill_sample(int fd, CcSample *sample);
+
+void cc_add_sample(CcStats *stats, const CcSample *sample);
+
+uint64_t cc_bbr_bw(const struct tcp_bbr_info *bbr);  // Bytes per second.
+
+#endif
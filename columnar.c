@@ -0,0 +1,395 @@
+#define _GNU_SOURCE
+
+#include "columnar.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+
+#define COL_PATH_MAX 256
+#define COL_COLUMNS_MAX 65535
+#define TIMESTAMP_SUFFIX "timestamp_usec"
+
+typedef struct {
+        char *name;
+        bool has_kind;  // False until a non-null value.
+        ColKind kind;
+        json_t **values;  // A value per row, NULL if null.
+} Column;
+
+typedef struct {
+        Column *cols;
+        int count;
+        int cap;
+        int *slots;  // Open addressing on the names, -1 if free.
+        int slots_cap;
+        int rows;
+} Columns;
+
+typedef struct {
+        char *str;
+        size_t len;
+} DictEntry;
+
+typedef struct {
+        DictEntry *entries;
+        uint32_t count;
+        uint32_t cap;
+        int64_t *slots;  // Index of the entry, -1 if free.
+        size_t slots_cap;
+} Dict;
+
+/* Private functions */
+
+static void *col_realloc(void *ptr, size_t size) {
+        void *ret = realloc(ptr, size);
+        if (!ret && size) {
+                fprintf(stderr, "realloc() failed.\n");
+                abort();
+        }
+        return ret;
+}
+
+static void *col_calloc(size_t count, size_t size) {
+        void *ret = calloc(count, size);
+        if (!ret && count && size) {
+                fprintf(stderr, "calloc() failed.\n");
+                abort();
+        }
+        return ret;
+}
+
+static void buf_reserve(ColBuf *buf, size_t len) {
+        if (buf->len + len <= buf->cap) return;
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while (cap < buf->len + len) cap *= 2;
+        buf->data = (unsigned char *)col_realloc(buf->data, cap);
+        buf->cap = cap;
+}
+
+static void put_bytes(ColBuf *buf, const void *bytes, size_t len) {
+        buf_reserve(buf, len);
+        memcpy(buf->data + buf->len, bytes, len);
+        buf->len += len;
+}
+
+static void put_le(ColBuf *buf, uint64_t val, int bytes) {
+        buf_reserve(buf, bytes);
+        for (int i = 0; i < bytes; i++)
+                buf->data[buf->len++] = (unsigned char)(val >> (8 * i));
+}
+
+static void patch_u64(ColBuf *buf, size_t offset, uint64_t val) {
+        for (int i = 0; i < 8; i++)
+                buf->data[offset + i] = (unsigned char)(val >> (8 * i));
+}
+
+static void put_varint(ColBuf *buf, uint64_t val) {
+        buf_reserve(buf, 10);
+        while (val >= 0x80) {
+                buf->data[buf->len++] = (unsigned char)(val | 0x80);
+                val >>= 7;
+        }
+        buf->data[buf->len++] = (unsigned char)val;
+}
+
+static uint64_t zigzag(int64_t val) {
+        return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+static void put_bitmap(ColBuf *buf, const bool *bits, int count) {
+        size_t len = (count + 7) / 8;
+        buf_reserve(buf, len);
+        memset(buf->data + buf->len, 0, len);
+        for (int i = 0; i < count; i++)
+                if (bits[i]) buf->data[buf->len + i / 8] |= 1 << (i % 8);
+        buf->len += len;
+}
+
+static ColKind kind_of(const json_t *val) {
+        switch (json_typeof(val)) {
+                case JSON_INTEGER:
+                        return COL_INT;
+                case JSON_REAL:
+                        return COL_DOUBLE;
+                case JSON_TRUE:
+                case JSON_FALSE:
+                        return COL_BOOL;
+                default:
+                        return COL_STRING;
+        }
+}
+
+static ColKind merge_kinds(ColKind a, ColKind b) {
+        if (a == b) return a;
+        if (a == COL_STRING || b == COL_STRING) return COL_STRING;
+        if (a == COL_DOUBLE || b == COL_DOUBLE) return COL_DOUBLE;
+        return COL_INT;  // BOOL and INT.
+}
+
+static void grow_slots(Columns *cols) {
+        free(cols->slots);
+        cols->slots_cap = cols->slots_cap ? cols->slots_cap * 2 : 64;
+        cols->slots = (int *)col_realloc(NULL, cols->slots_cap * sizeof(int));
+        memset(cols->slots, -1, cols->slots_cap * sizeof(int));
+        int mask = cols->slots_cap - 1;
+        for (int i = 0; i < cols->count; i++) {
+                const char *name = cols->cols[i].name;
+                int slot = hash_bytes(name, strlen(name)) & mask;
+                while (cols->slots[slot] != -1) slot = (slot + 1) & mask;
+                cols->slots[slot] = i;
+        }
+}
+
+static Column *get_column(Columns *cols, const char *name) {
+        if (2 * (cols->count + 1) > cols->slots_cap) grow_slots(cols);
+        int mask = cols->slots_cap - 1;
+        int slot = hash_bytes(name, strlen(name)) & mask;
+        while (cols->slots[slot] != -1) {
+                Column *col = &cols->cols[cols->slots[slot]];
+                if (!strcmp(col->name, name)) return col;
+                slot = (slot + 1) & mask;
+        }
+        if (cols->count == COL_COLUMNS_MAX) return NULL;
+        if (cols->count == cols->cap) {
+                cols->cap = cols->cap ? cols->cap * 2 : 32;
+                cols->cols = (Column *)col_realloc(
+                    cols->cols, cols->cap * sizeof(Column));
+        }
+        cols->slots[slot] = cols->count;
+        Column *col = &cols->cols[cols->count++];
+        col->name = strdup(name);
+        col->has_kind = false;
+        col->values = (json_t **)col_calloc(cols->rows, sizeof(json_t *));
+        return col;
+}
+
+static void add_leaf(Columns *cols, const char *path, json_t *val, int row) {
+        if (json_typeof(val) == JSON_NULL) return;
+        Column *col = get_column(cols, path);
+        if (!col) return;
+        col->values[row] = val;
+        col->kind =
+            col->has_kind ? merge_kinds(col->kind, kind_of(val)) : kind_of(val);
+        col->has_kind = true;
+}
+
+static void add_leaves(Columns *cols, json_t *obj, char *path, size_t len,
+                       int row) {
+        void *iter = json_object_iter(obj);
+        for (; iter; iter = json_object_iter_next(obj, iter)) {
+                const char *key = json_object_iter_key(iter);
+                json_t *val = json_object_iter_value(iter);
+                size_t key_len = strlen(key);
+                size_t new_len = len + (len ? 1 : 0) + key_len;
+                if (new_len >= COL_PATH_MAX) continue;
+                if (len) path[len] = '.';
+                memcpy(path + new_len - key_len, key, key_len + 1);
+                if (json_typeof(val) == JSON_OBJECT)
+                        add_leaves(cols, val, path, new_len, row);
+                else
+                        add_leaf(cols, path, val, row);
+                path[len] = '\0';
+        }
+}
+
+static bool is_timestamp(const char *name) {
+        size_t len = strlen(name);
+        size_t suffix_len = strlen(TIMESTAMP_SUFFIX);
+        return len >= suffix_len &&
+               !strcmp(name + len - suffix_len, TIMESTAMP_SUFFIX);
+}
+
+static int64_t int_value(const json_t *val) {
+        if (json_typeof(val) == JSON_INTEGER) return json_integer_value(val);
+        return json_typeof(val) == JSON_TRUE;
+}
+
+static double double_value(const json_t *val) {
+        if (json_typeof(val) == JSON_REAL || json_typeof(val) == JSON_INTEGER)
+                return json_number_value(val);
+        return json_typeof(val) == JSON_TRUE;
+}
+
+static uint32_t dict_add(Dict *dict, const char *str, size_t len) {
+        size_t mask = dict->slots_cap - 1;
+        size_t slot = hash_bytes(str, len) & mask;
+        while (dict->slots[slot] != -1) {
+                DictEntry *entry = &dict->entries[dict->slots[slot]];
+                if (entry->len == len && !memcmp(entry->str, str, len))
+                        return dict->slots[slot];
+                slot = (slot + 1) & mask;
+        }
+        if (dict->count == dict->cap) {
+                dict->cap = dict->cap ? dict->cap * 2 : 16;
+                dict->entries = (DictEntry *)col_realloc(
+                    dict->entries, dict->cap * sizeof(DictEntry));
+        }
+        DictEntry *entry = &dict->entries[dict->count];
+        entry->str = (char *)col_realloc(NULL, len ? len : 1);
+        memcpy(entry->str, str, len);
+        entry->len = len;
+        dict->slots[slot] = dict->count;
+        return dict->count++;
+}
+
+static void put_ints(ColBuf *buf, const Column *col, int rows,
+                     ColEncoding encoding) {
+        int64_t prev = 0;
+        for (int i = 0; i < rows; i++) {
+                int64_t val = col->values[i] ? int_value(col->values[i])
+                                             : encoding == COL_DELTA ? prev : 0;
+                if (encoding == COL_DELTA)
+                        put_varint(buf, zigzag(val - prev));
+                else
+                        put_le(buf, (uint64_t)val, 8);
+                prev = val;
+        }
+}
+
+static void put_doubles(ColBuf *buf, const Column *col, int rows) {
+        for (int i = 0; i < rows; i++) {
+                double val = col->values[i] ? double_value(col->values[i]) : 0;
+                uint64_t bits;
+                memcpy(&bits, &val, sizeof(bits));
+                put_le(buf, bits, 8);
+        }
+}
+
+static void put_bools(ColBuf *buf, const Column *col, int rows) {
+        bool *bits = (bool *)col_calloc(rows, sizeof(bool));
+        for (int i = 0; i < rows; i++)
+                bits[i] = col->values[i] &&
+                          json_typeof(col->values[i]) == JSON_TRUE;
+        put_bitmap(buf, bits, rows);
+        free(bits);
+}
+
+static void put_strings(ColBuf *buf, const Column *col, int rows) {
+        Dict dict = {0};
+        dict.slots_cap = 16;
+        while (dict.slots_cap < 2 * (size_t)rows) dict.slots_cap *= 2;
+        dict.slots = (int64_t *)col_realloc(NULL,
+                                            dict.slots_cap * sizeof(int64_t));
+        memset(dict.slots, -1, dict.slots_cap * sizeof(int64_t));
+        uint32_t *indexes = (uint32_t *)col_calloc(rows, sizeof(uint32_t));
+
+        for (int i = 0; i < rows; i++) {
+                const json_t *val = col->values[i];
+                if (!val) continue;  // Index 0, masked by the validity.
+                if (json_typeof(val) == JSON_STRING) {
+                        indexes[i] = dict_add(&dict, json_string_value(val),
+                                              json_string_length(val));
+                        continue;
+                }
+                char *text = json_dumps(val, JSON_COMPACT | JSON_ENCODE_ANY);
+                if (!text) continue;
+                indexes[i] = dict_add(&dict, text, strlen(text));
+                free(text);
+        }
+
+        put_le(buf, dict.count, 4);
+        for (uint32_t i = 0; i < dict.count; i++) {
+                put_le(buf, dict.entries[i].len, 4);
+                put_bytes(buf, dict.entries[i].str, dict.entries[i].len);
+                free(dict.entries[i].str);
+        }
+        for (int i = 0; i < rows; i++) put_le(buf, indexes[i], 4);
+
+        free(indexes);
+        free(dict.entries);
+        free(dict.slots);
+}
+
+static void encode_column(const Column *col, int rows, ColBuf *buf) {
+        ColEncoding encoding = COL_PLAIN;
+        if (col->kind == COL_STRING)
+                encoding = COL_DICT;
+        else if (col->kind == COL_INT && is_timestamp(col->name))
+                encoding = COL_DELTA;
+
+        size_t name_len = strlen(col->name);
+        put_le(buf, name_len, 2);
+        put_bytes(buf, col->name, name_len);
+        put_le(buf, col->kind, 1);
+        put_le(buf, encoding, 1);
+
+        bool *valid = (bool *)col_calloc(rows, sizeof(bool));
+        bool nullable = false;
+        for (int i = 0; i < rows; i++) {
+                valid[i] = col->values[i] != NULL;
+                if (!valid[i]) nullable = true;
+        }
+        put_le(buf, nullable, 1);
+        if (nullable) put_bitmap(buf, valid, rows);
+        free(valid);
+
+        size_t len_offset = buf->len;
+        put_le(buf, 0, 8);
+        switch (col->kind) {
+                case COL_INT:
+                        put_ints(buf, col, rows, encoding);
+                        break;
+                case COL_DOUBLE:
+                        put_doubles(buf, col, rows);
+                        break;
+                case COL_BOOL:
+                        put_bools(buf, col, rows);
+                        break;
+                case COL_STRING:
+                        put_strings(buf, col, rows);
+                        break;
+        }
+        patch_u64(buf, len_offset, buf->len - len_offset - 8);
+}
+
+/* Public functions */
+
+void col_buf_header(ColBuf *buf) {
+        put_bytes(buf, "TCOL", 4);
+        put_le(buf, COL_VERSION, 1);
+}
+
+void col_buf_free(ColBuf *buf) {
+        free(buf->data);
+        memset(buf, 0, sizeof(ColBuf));
+}
+
+void col_table_add(ColTable *table, json_t *row) {
+        if (table->count == table->cap) {
+                table->cap = table->cap ? table->cap * 2 : 256;
+                table->rows = (json_t **)col_realloc(
+                    table->rows, table->cap * sizeof(json_t *));
+        }
+        table->rows[table->count++] = row;
+}
+
+void col_table_encode(ColTable *table, ColBuf *buf) {
+        if (!table->count) return;
+        Columns cols = {0};
+        cols.rows = table->count;
+        char path[COL_PATH_MAX] = "";
+        for (int i = 0; i < table->count; i++)
+                if (json_typeof(table->rows[i]) == JSON_OBJECT)
+                        add_leaves(&cols, table->rows[i], path, 0, i);
+
+        put_le(buf, table->count, 4);
+        put_le(buf, cols.count, 2);
+        for (int i = 0; i < cols.count; i++) {
+                encode_column(&cols.cols[i], table->count, buf);
+                free(cols.cols[i].name);
+                free(cols.cols[i].values);
+        }
+        free(cols.cols);
+        free(cols.slots);
+
+        for (int i = 0; i < table->count; i++) json_decref(table->rows[i]);
+        table->count = 0;
+}
+
+void col_table_free(ColTable *table) {
+        for (int i = 0; i < table->count; i++) json_decref(table->rows[i]);
+        free(table->rows);
+        memset(table, 0, sizeof(ColTable));
+}
@@ -0,0 +1,63 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <jansson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Columnar tables of events, for the analysis of traces with dataframes or
+ * vectorized queries (see tcpsnitch_columnar.c). A table holds the events of
+ * a single type, in a .tcol file made of independent row groups:
+ *
+ *   file      = "TCOL" version:u8 row_group*
+ *   row_group = rows:u32 columns:u16 column*
+ *   column    = name_len:u16 name kind:u8 encoding:u8 nullable:u8
+ *               [validity:(rows+7)/8] data_len:u64 data
+ *
+ * Numbers are little-endian. A column is a leaf of the JSON events, named by
+ * its path (e.g. "details.addr.ip"). Columns differ between row groups, as
+ * events of a type do not always carry the same fields. When a column is
+ * nullable, bit i of the validity bitmap (LSB first) is set if row i has a
+ * value; null rows still take a slot in the data, holding 0 or the previous
+ * value. The data of a column depends on its kind and encoding:
+ * - COL_INT, COL_PLAIN: an int64 per row;
+ * - COL_INT, COL_DELTA: a varint per row, the zigzag-encoded difference with
+ *   the previous row (0 before the first). Used for timestamps;
+ * - COL_DOUBLE, COL_PLAIN: a float64 per row;
+ * - COL_BOOL, COL_PLAIN: a bitmap, as the validity;
+ * - COL_STRING, COL_DICT: entries:u32, then each entry as len:u32 and bytes,
+ *   then a u32 index in the entries per row. Used for the enums, addresses
+ *   and any other string, and for the arrays, kept as compact JSON text.
+ * Columns mixing kinds are promoted: BOOL to INT, INT to DOUBLE, and anything
+ * else to the JSON text of the values. */
+
+#define COL_VERSION 1
+
+typedef enum { COL_INT, COL_DOUBLE, COL_BOOL, COL_STRING } ColKind;
+
+typedef enum { COL_PLAIN, COL_DELTA, COL_DICT } ColEncoding;
+
+typedef struct {
+        unsigned char *data;
+        size_t len;
+        size_t cap;
+} ColBuf;
+
+// Rows waiting to be encoded as a row group.
+typedef struct {
+        json_t **rows;
+        int count;
+        int cap;
+} ColTable;
+
+void col_buf_header(ColBuf *buf);  // Starts a file.
+void col_buf_free(ColBuf *buf);
+
+void col_table_add(ColTable *table, json_t *row);  // Takes a reference.
+
+// Appends the rows as a row group to buf, and empties the table.
+void col_table_encode(ColTable *table, ColBuf *buf);
+
+void col_table_free(ColTable *table);
+
+#endif
@@ -0,0 +1,172 @@
+#define _GNU_SOURCE
+
+#include "concurrency.h"
+#include "sock_events.h"
+
+typedef enum { SIDE_NONE, SIDE_READ, SIDE_WRITE, SIDE_CLOSE } Side;
+
+/* Private functions */
+
+static Side side_of(int type) {
+        switch (type) {
+                case SOCK_EV_ACCEPT:
+                case SOCK_EV_ACCEPT4:
+                case SOCK_EV_RECV:
+                case SOCK_EV_RECVFROM:
+                case SOCK_EV_RECVMSG:
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 21
+                case SOCK_EV_RECVMMSG:
+#endif
+                case SOCK_EV_READ:
+                case SOCK_EV_READV:
+                        return SIDE_READ;
+                case SOCK_EV_SEND:
+                case SOCK_EV_SENDTO:
+                case SOCK_EV_SENDMSG:
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 21
+                case SOCK_EV_SENDMMSG:
+#endif
+                case SOCK_EV_WRITE:
+                case SOCK_EV_WRITEV:
+                case SOCK_EV_SENDFILE:
+                        return SIDE_WRITE;
+                case SOCK_EV_SHUTDOWN:
+                case SOCK_EV_CLOSE:
+                        return SIDE_CLOSE;
+                default:
+                        return SIDE_NONE;
+        }
+}
+
+// Kind of conflict between two calls of different threads, false if none.
+static bool conflict(const ConcCall *c1, const ConcCall *c2, ConcKind *kind) {
+        Side s1 = side_of(c1->type), s2 = side_of(c2->type);
+        if (s1 == SIDE_NONE || s2 == SIDE_NONE) return false;
+        if (s1 == SIDE_CLOSE || s2 == SIDE_CLOSE)
+                *kind = CONC_OVERLAP_CLOSE;
+        else if (s1 != s2)
+                return false;  // Full duplex.
+        else
+                *kind = s1 == SIDE_READ ? CONC_OVERLAP_READ
+                                        : CONC_OVERLAP_WRITE;
+        return true;
+}
+
+static bool overlap(const ConcCall *c1, const ConcCall *c2) {
+        return c1->start_usec < c2->end_usec && c2->start_usec < c1->end_usec;
+}
+
+static void report(Concurrency *conc, ConcKind kind, unsigned long time_usec,
+                   unsigned long usec, const ConcCall *first,
+                   const ConcCall *second) {
+        ConcReport *r = NULL;
+        if (conc->reports_count < CONC_MAX_REPORTS) {
+                r = &conc->reports[conc->reports_count++];
+        } else if (kind != CONC_RAPID_HANDOFF) {
+                // Overlaps take the place of hand-offs.
+                for (int i = 0; i < CONC_MAX_REPORTS && !r; i++)
+                        if (conc->reports[i].kind == CONC_RAPID_HANDOFF)
+                                r = &conc->reports[i];
+        }
+        if (!r) {
+                conc->reports_dropped++;
+                return;
+        }
+        r->kind = kind;
+        r->timestamp_usec = time_usec;
+        r->usec = usec;
+        r->first = *first;
+        r->second = *second;
+}
+
+static void count(Concurrency *conc, ConcKind kind) {
+        switch (kind) {
+                case CONC_OVERLAP_READ:
+                        conc->read_overlaps++;
+                        break;
+                case CONC_OVERLAP_WRITE:
+                        conc->write_overlaps++;
+                        break;
+                case CONC_OVERLAP_CLOSE:
+                        conc->close_overlaps++;
+                        break;
+                case CONC_RAPID_HANDOFF:
+                        conc->rapid_handoffs++;
+                        break;
+        }
+}
+
+static void push_recent(Concurrency *conc, const ConcCall *call) {
+        if (conc->recent_count < CONC_RECENT) {
+                conc->recent[(conc->recent_head + conc->recent_count++) %
+                             CONC_RECENT] = *call;
+        } else {
+                conc->recent[conc->recent_head] = *call;
+                conc->recent_head = (conc->recent_head + 1) % CONC_RECENT;
+        }
+}
+
+/* Public functions */
+
+bool conc_on_call(Concurrency *conc, pid_t thread_id, int type,
+                  const void *call_site, unsigned long start_usec,
+                  unsigned long end_usec) {
+        ConcCall call = {thread_id, type, call_site, start_usec, end_usec};
+        bool overlapped = false;
+        ConcKind kind;
+        // A call is compared with the calls returned before it: each pair of
+        // calls is thus seen once, when the second returns.
+        for (int i = 0; i < conc->recent_count; i++) {
+                const ConcCall *prev =
+                    &conc->recent[(conc->recent_head + i) % CONC_RECENT];
+                if (prev->thread_id == thread_id || !overlap(prev, &call) ||
+                    !conflict(prev, &call, &kind))
+                        continue;
+                unsigned long from = prev->start_usec > start_usec
+                                         ? prev->start_usec
+                                         : start_usec;
+                unsigned long to =
+                    prev->end_usec < end_usec ? prev->end_usec : end_usec;
+                count(conc, kind);
+                report(conc, kind, from, to - from, prev, &call);
+                overlapped = true;
+        }
+
+        if (conc->recent_count) {
+                const ConcCall *last =
+                    &conc->recent[(conc->recent_head + conc->recent_count - 1) %
+                                  CONC_RECENT];
+                if (last->thread_id != thread_id &&
+                    start_usec >= last->end_usec) {
+                        conc->handoffs++;
+                        unsigned long gap = start_usec - last->end_usec;
+                        if (gap < CONC_RAPID_USEC) {
+                                count(conc, CONC_RAPID_HANDOFF);
+                                report(conc, CONC_RAPID_HANDOFF, start_usec,
+                                       gap, last, &call);
+                        }
+                }
+        }
+
+        push_recent(conc, &call);
+        return overlapped;
+}
+
+long conc_overlaps(const Concurrency *conc) {
+        return conc->read_overlaps + conc->write_overlaps +
+               conc->close_overlaps;
+}
+
+const char *conc_kind_str(ConcKind kind) {
+        switch (kind) {
+                case CONC_OVERLAP_READ:
+                        return "read_overlap";
+                case CONC_OVERLAP_WRITE:
+                        return "write_overlap";
+                case CONC_OVERLAP_CLOSE:
+                        return "close_overlap";
+                case CONC_RAPID_HANDOFF:
+                        return "rapid_handoff";
+        }
+        return "unknown";
+}
@@ -0,0 +1,67 @@
+#ifndef CONCURRENCY_H
+#define CONCURRENCY_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* Detects the calls made concurrently on a socket by different threads. Two
+ * calls overlap when one starts before the other returns. Overlapping calls of
+ * the same direction interleave their data (two threads writing a stream) and
+ * serialize on the socket lock; a close() overlapping any call races with it.
+ * A send in one thread and a recv in another are normal and ignored. The
+ * detector also counts the hand-offs of the socket between threads, and those
+ * in rapid succession, which point to a socket shared by a pool without
+ * affinity. Only the last calls are kept, not the history. */
+
+#define CONC_RECENT 8        // Last calls kept per socket.
+#define CONC_MAX_REPORTS 16  // Overlaps and hand-offs reported per socket.
+#define CONC_RAPID_USEC 1000  // Hand-offs within this delay are rapid.
+
+typedef enum ConcKind {
+        CONC_OVERLAP_READ,
+        CONC_OVERLAP_WRITE,
+        CONC_OVERLAP_CLOSE,
+        CONC_RAPID_HANDOFF
+} ConcKind;
+
+typedef struct {
+        pid_t thread_id;
+        int type;  // SockEventType.
+        const void *call_site;
+        unsigned long start_usec;
+        unsigned long end_usec;
+} ConcCall;
+
+typedef struct {
+        ConcKind kind;
+        unsigned long timestamp_usec;  // Start of the overlap, or hand-off.
+        unsigned long usec;  // Duration of the overlap, or gap of the hand-off.
+        ConcCall first;      // Returned first.
+        ConcCall second;
+} ConcReport;
+
+typedef struct {
+        ConcCall recent[CONC_RECENT];
+        int recent_head;
+        int recent_count;
+        long read_overlaps;
+        long write_overlaps;
+        long close_overlaps;
+        long handoffs;        // Consecutive calls made by different threads.
+        long rapid_handoffs;  // Within CONC_RAPID_USEC.
+        int reports_count;
+        long reports_dropped;
+        ConcReport reports[CONC_MAX_REPORTS];
+} Concurrency;
+
+// A call of the application on the socket returned. Returns true if it
+// overlaps a call of another thread.
+bool conc_on_call(Concurrency *conc, pid_t thread_id, int type,
+                  const void *call_site, unsigned long start_usec,
+                  unsigned long end_usec);
+
+long conc_overlaps(const Concurrency *conc);
+
+const char *conc_kind_str(ConcKind kind);
+
+#endif
@@ -0,0 +1,59 @@
+#define _GNU_SOURCE
+
+#include "cpu_affinity.h"
+#include <sys/socket.h>
+#include "lib.h"
+
+/* Private functions */
+
+static void read_incoming(CpuAffinity *ca, int fd) {
+        ca->incoming_read = true;
+#ifdef SO_INCOMING_CPU
+        int cpu;
+        if (get_int_sockopt_if_supported(fd, SOL_SOCKET, SO_INCOMING_CPU,
+                                         &cpu))
+                ca->incoming_cpu = cpu;
+#endif
+#ifdef SO_INCOMING_NAPI_ID
+        int napi_id;
+        if (get_int_sockopt_if_supported(fd, SOL_SOCKET, SO_INCOMING_NAPI_ID,
+                                         &napi_id))
+                ca->napi_id = napi_id;
+#endif
+        UNUSED(fd);
+}
+
+/* Public functions */
+
+void cpu_init(CpuAffinity *ca) {
+        ca->last_cpu = -1;
+        ca->incoming_cpu = -1;
+}
+
+void cpu_on_event(CpuAffinity *ca, int cpu) {
+        if (cpu < 0) return;
+        ca->events++;
+        if (ca->last_cpu >= 0 && ca->last_cpu != cpu) ca->migrations++;
+        ca->last_cpu = cpu;
+
+        for (int i = 0; i < ca->cpus_count; i++) {
+                if (ca->cpus[i].cpu == cpu) {
+                        ca->cpus[i].events++;
+                        return;
+                }
+        }
+        if (ca->cpus_count == CPU_MAX_TRACKED) {
+                ca->cpus_dropped++;
+                return;
+        }
+        ca->cpus[ca->cpus_count].cpu = cpu;
+        ca->cpus[ca->cpus_count].events = 1;
+        ca->cpus_count++;
+}
+
+void cpu_on_data(CpuAffinity *ca, int fd, int cpu) {
+        if (!ca->incoming_read) read_incoming(ca, fd);
+        if (cpu < 0 || ca->incoming_cpu < 0) return;
+        ca->data_calls++;
+        if (cpu != ca->incoming_cpu) ca->incoming_mismatches++;
+}
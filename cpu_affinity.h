@@ -0,0 +1,41 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <stdbool.h>
+
+/* Tracks on which CPUs the events of a socket are processed, and compares the
+ * CPU making the data calls with the CPU on which the kernel processed the
+ * incoming packets (SO_INCOMING_CPU). A mismatch means the data crosses CPUs
+ * between the softirq and the application, which IRQ affinity, RPS/RFS or
+ * SO_REUSEPORT steering may avoid. */
+
+#define CPU_MAX_TRACKED 16  // CPUs with a per-CPU event count, per socket.
+
+typedef struct {
+        int cpu;
+        long events;
+} CpuCount;
+
+typedef struct {
+        long events;
+        int last_cpu;     // -1 before the first event.
+        long migrations;  // Consecutive events processed on different CPUs.
+        int cpus_count;
+        long cpus_dropped;  // Events on CPUs beyond CPU_MAX_TRACKED.
+        CpuCount cpus[CPU_MAX_TRACKED];
+        // Read once, at the first call transferring data.
+        bool incoming_read;
+        int incoming_cpu;  // -1 if unknown.
+        int napi_id;       // 0 if unknown.
+        long data_calls;   // Data calls once incoming_cpu is known.
+        long incoming_mismatches;
+} CpuAffinity;
+
+void cpu_init(CpuAffinity *ca);
+
+void cpu_on_event(CpuAffinity *ca, int cpu);
+
+// Called for each data call. Reads SO_INCOMING_CPU/NAPI_ID the first time.
+void cpu_on_data(CpuAffinity *ca, int fd, int cpu);
+
+#endif
@@ -0,0 +1,61 @@
+#define _GNU_SOURCE
+
+#include "histogram.h"
+
+/* Private functions */
+
+static int bucket_index(unsigned long val) {
+        int i = 0;
+        while (val && i < HISTO_BUCKETS - 1) {
+                val >>= 1;
+                i++;
+        }
+        return i;
+}
+
+/* Public functions */
+
+void histo_add(Histogram *histo, unsigned long val) {
+        if (!histo->count || val < histo->min) histo->min = val;
+        if (val > histo->max) histo->max = val;
+        histo->count++;
+        histo->sum += val;
+        histo->buckets[bucket_index(val)]++;
+}
+
+void histo_merge(Histogram *histo, const Histogram *other) {
+        if (!other->count) return;
+        if (!histo->count || other->min < histo->min) histo->min = other->min;
+        if (other->max > histo->max) histo->max = other->max;
+        histo->count += other->count;
+        histo->sum += other->sum;
+        for (int i = 0; i < HISTO_BUCKETS; i++)
+                histo->buckets[i] += other->buckets[i];
+}
+
+bool histo_is_empty(const Histogram *histo) { return histo->count == 0; }
+
+unsigned long histo_mean(const Histogram *histo) {
+        return histo->count ? histo->sum / histo->count : 0;
+}
+
+unsigned long histo_bucket_upper_bound(int bucket) {
+        if (bucket <= 0) return 0;
+        return (1UL << bucket) - 1;
+}
+
+unsigned long histo_percentile(const Histogram *histo, int percentile) {
+        if (!histo->count) return 0;
+        unsigned long rank = (histo->count * percentile + 99) / 100;
+        if (rank == 0) rank = 1;
+        unsigned long seen = 0;
+        for (int i = 0; i < HISTO_BUCKETS; i++) {
+                seen += histo->buckets[i];
+                if (seen >= rank) {
+                        if (i == HISTO_BUCKETS - 1) return histo->max;
+                        unsigned long bound = histo_bucket_upper_bound(i);
+                        return (bound > histo->max) ? histo->max : bound;
+                }
+        }
+        return histo->max;
+}
@@ -0,0 +1,29 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdbool.h>
+
+/* Histogram with power-of-two buckets. Bucket i counts the values v such that
+ * 2^(i-1) <= v < 2^i, bucket 0 counts the zero values and the last bucket
+ * counts everything above. Histograms are plain values: they do not allocate
+ * and may be copied into events. */
+
+#define HISTO_BUCKETS 32
+
+typedef struct {
+        unsigned long count;
+        unsigned long min;
+        unsigned long max;
+        unsigned long sum;
+        unsigned long buckets[HISTO_BUCKETS];
+} Histogram;
+
+void histo_add(Histogram *histo, unsigned long val);
+void histo_merge(Histogram *histo, const Histogram *other);  // Adds other.
+bool histo_is_empty(const Histogram *histo);
+unsigned long histo_mean(const Histogram *histo);
+// Upper bound of the bucket holding the given percentile (0-100).
+unsigned long histo_percentile(const Histogram *histo, int percentile);
+unsigned long histo_bucket_upper_bound(int bucket);
+
+#endif
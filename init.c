@@ -4,6 +4,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -12,19 +13,37 @@
 #include <android/log.h>
 #include <sys/system_properties.h>
 #endif
+#include "call_sites.h"
 #include "lib.h"
+#include "local_ports.h"
 #include "logger.h"
+#include "name_resolution.h"
+#include "numa_nodes.h"
+#include "sock_config.h"
 #include "sock_events.h"
 #include "string_builders.h"
+#include "thread_profile.h"
+#include "verbose_mode.h"
+#include "wakeups.h"
+#include "waterfall.h"
 
 long conf_opt_b;
 long conf_opt_c;
 char *conf_opt_d;
+char *conf_opt_e;
 long conf_opt_f;
+long conf_opt_g;
+char *conf_opt_j;
 long conf_opt_l;
+long conf_opt_m;
+long conf_opt_o;
+long conf_opt_r;
+long conf_opt_s;
 long conf_opt_u;
 long conf_opt_t;
 long conf_opt_v;
+long conf_opt_w;
+long conf_opt_x;
 
 char *logs_dir_path;
 
@@ -35,11 +54,10 @@ FILE *_stderr;
 
 static bool initialized = false;
 
-#ifdef __ANDROID__
-static pthread_mutex_t init_mutex = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER;
-#else
-static pthread_mutex_t init_mutex = PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP;
-#endif
+static bool sampler_started = false;
+
+static pthread_mutex_t init_mutex = MUTEX_ERRORCHECK;
+static pthread_mutex_t sampler_mutex = MUTEX_ERRORCHECK;
 
 /* Private functions */
 
@@ -89,6 +107,8 @@ error_out:
 
 static void tcpsnitch_free(void) {
         free(conf_opt_d);
+        free(conf_opt_e);
+        free(conf_opt_j);
         free(logs_dir_path);
 #ifndef __ANDROID__
         if (_stdout) fclose(_stdout);
@@ -117,11 +137,20 @@ static void get_options(void) {
         conf_opt_c = get_long_opt_or_defaultval(OPT_C, 0);
         conf_opt_d = alloc_str_opt(OPT_D);
 #endif
+        conf_opt_e = alloc_str_opt_or_null(OPT_E);
         conf_opt_f = get_long_opt_or_defaultval(OPT_F, WARN);
+        conf_opt_g = get_long_opt_or_defaultval(OPT_G, 0);
+        conf_opt_j = alloc_str_opt_or_null(OPT_J);
         conf_opt_l = get_long_opt_or_defaultval(OPT_L, WARN);
+        conf_opt_m = get_long_opt_or_defaultval(OPT_M, 0);
+        conf_opt_o = get_long_opt_or_defaultval(OPT_O, 0);
+        conf_opt_r = get_long_opt_or_defaultval(OPT_R, 0);
+        conf_opt_s = get_long_opt_or_defaultval(OPT_S, 100);
         conf_opt_t = get_long_opt_or_defaultval(OPT_T, 1000);
         conf_opt_u = get_long_opt_or_defaultval(OPT_U, 0);
         conf_opt_v = get_long_opt_or_defaultval(OPT_V, 0);
+        conf_opt_w = get_long_opt_or_defaultval(OPT_W, 0);
+        conf_opt_x = get_long_opt_or_defaultval(OPT_X, 0);
 }
 
 static void log_options(void) {
@@ -130,11 +159,20 @@ static void log_options(void) {
         LOG(INFO, "Option c: %lu.", conf_opt_c);
 #endif
         LOG(INFO, "Option d: %s", conf_opt_d);
+        LOG(INFO, "Option e: %s", conf_opt_e ? conf_opt_e : "none");
         LOG(INFO, "Option f: %lu.", conf_opt_f);
+        LOG(INFO, "Option g: %lu.", conf_opt_g);
+        LOG(INFO, "Option j: %s", conf_opt_j ? conf_opt_j : "none");
         LOG(INFO, "Option l: %lu.", conf_opt_l);
+        LOG(INFO, "Option m: %lu.", conf_opt_m);
+        LOG(INFO, "Option o: %lu.", conf_opt_o);
+        LOG(INFO, "Option r: %lu.", conf_opt_r);
+        LOG(INFO, "Option s: %lu.", conf_opt_s);
         LOG(INFO, "Option t: %lu.", conf_opt_t);
         LOG(INFO, "Option u: %lu.", conf_opt_u);
         LOG(INFO, "Option v: %lu.", conf_opt_v);
+        LOG(INFO, "Option w: %lu.", conf_opt_w);
+        LOG(INFO, "Option x: %lu.", conf_opt_x);
 }
 
 static void init_logs(void) {
@@ -149,16 +187,20 @@ error:
         LOG(ERROR, "No logs to file.");
 }
 
+// One per NUMA node, see numa_nodes.h.
 static void *json_dumper_thread(void *arg) {
-        UNUSED(arg);
+        int node = (int)(intptr_t)arg;
         LOG_FUNC_INFO;
+        if (numa_pin_thread(node))
+                LOG(INFO, "JSON dumper pinned to NUMA node %d.", node);
 
         struct timespec time;
         time.tv_sec = conf_opt_t / 1000;
         time.tv_nsec = (conf_opt_t % 1000) * 1000 * 1000;  // opt_t is in ms
 
         while (true) {
-                dump_all_sock_events();
+                dump_all_sock_events(numa_nodes_count() > 1 ? node : -1);
+                if (!node) dump_all_dns_events();
                 nanosleep(&time, NULL);
         }
         // Unreachable
@@ -166,8 +208,28 @@ static void *json_dumper_thread(void *arg) {
 }
 
 void start_json_dumper_thread(void) {
-        pthread_t thread;
-        my_pthread_create(&thread, NULL, json_dumper_thread, NULL);
+        numa_init();
+        for (int node = 0; node < numa_nodes_count(); node++) {
+                pthread_t thread;
+                my_pthread_create(&thread, NULL, json_dumper_thread,
+                                  (void *)(intptr_t)node);
+        }
+}
+
+static void *listen_sampler_thread(void *arg) {
+        UNUSED(arg);
+        LOG_FUNC_INFO;
+
+        struct timespec time;
+        time.tv_sec = conf_opt_s / 1000;
+        time.tv_nsec = (conf_opt_s % 1000) * 1000 * 1000;  // opt_s is in ms
+
+        while (true) {
+                sample_all_listeners();
+                nanosleep(&time, NULL);
+        }
+        // Unreachable
+        return NULL;
 }
 
 /* Public functions */
@@ -182,7 +244,17 @@ void reset_tcpsnitch(void) {
         logger_init(NULL, WARN, WARN);
         initialized = false;
         mutex_init(&init_mutex);
+        mutex_init(&sampler_mutex);
+        sampler_started = false;  // Threads do not survive fork().
         sock_ev_reset();
+        dns_reset();
+        wakeup_reset();
+        ports_reset();
+        cs_reset();
+        cfg_reset();
+        wf_reset();
+        prof_reset();
+        verbose_reset();
 }
 
 void init_tcpsnitch(void) {
@@ -193,6 +265,7 @@ void init_tcpsnitch(void) {
         open_std_streams();
 #endif
         get_options();
+        verbose_init();
         if (!conf_opt_d) goto exit1;
         if (!(logs_dir_path = create_logs_dir_at_path(conf_opt_d))) goto exit1;
         init_logs();
@@ -207,9 +280,31 @@ exit:
         return;
 }
 
+/* The accept queues are sampled by a thread started at the first successful
+ * listen(), so that clients do not pay for it. */
+void start_listen_sampler_thread(void) {
+        if (conf_opt_s <= 0) return;
+        mutex_lock(&sampler_mutex);
+        if (!sampler_started) {
+                pthread_t thread;
+                my_pthread_create(&thread, NULL, listen_sampler_thread, NULL);
+                sampler_started = true;
+        }
+        mutex_unlock(&sampler_mutex);
+}
+
 __attribute__((destructor)) static void cleanup(void) {
         LOG(INFO, "Performing library cleanup before end of process.");
-        dump_all_sock_events();
+        summarize_all_sockets();
+        verbose_flush();
+        dump_all_sock_events(-1);
+        dump_all_dns_events();
+        dump_all_epoll_wakeups();
+        dump_all_ports();
+        dump_all_call_sites();
+        dump_all_configs();
+        dump_all_waterfalls();
+        dump_all_thread_profiles();
         // tcp_free();
         // tcpsnitch_free();
 }
@@ -2,12 +2,17 @@
 
 #include "json_builder.h"
 #include <jansson.h>
+#include <linux/errqueue.h>
 #include <netdb.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "constants.h"
 #include "fcntl.h"
+#include "histogram.h"
 #include "init.h"
 #include "lib.h"
 #include "logger.h"
+#include "name_resolution.h"
 #include "string.h"
 #include "string_builders.h"
 #include "sys/epoll.h"
@@ -36,6 +41,11 @@ static json_t *my_json_array(void) {
 typedef int (*add_type)(json_t *o, const char *k, json_t *v);
 static add_type add = &json_object_set_new;
 
+static void add_sock_identity(json_t *json, const SockInfo *sock_info) {
+        add(json, "cookie", json_integer(sock_info->cookie));
+        add(json, "inode", json_integer(sock_info->inode));
+}
+
 static json_t *build_sock_info(const SockInfo *sock_info) {
         // We only fill it when the event is the first of the trace.
         if (!sock_info->filled) return NULL;
@@ -61,6 +71,7 @@ static json_t *build_sock_info(const SockInfo *sock_info) {
 
         add(json_si, "SOCK_CLOEXEC", json_boolean(sock_info->sock_cloexec));
         add(json_si, "SOCK_NONBLOCK", json_boolean(sock_info->sock_nonblock));
+        add_sock_identity(json_si, sock_info);
 
         return json_si;
 }
@@ -177,29 +188,54 @@ static json_t *build_iovec(const Iovec *iovec) {
         return json_iovec;
 }
 
+static long usec_from_timespec(const struct timespec *ts) {
+        return ts->tv_sec * 1000000L + ts->tv_nsec / 1000;
+}
+
+// Decodes the timestamps of SO_TIMESTAMP, SO_TIMESTAMPNS & SO_TIMESTAMPING.
+static void add_cmsg_timestamp(json_t *json_cd, const struct cmsghdr *cmsg) {
+        if (cmsg->cmsg_level != SOL_SOCKET) return;
+        if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+                struct timeval tv;
+                memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+                add(json_cd, "timestamp_usec",
+                    json_integer(tv.tv_sec * 1000000L + tv.tv_usec));
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                add(json_cd, "timestamp_usec",
+                    json_integer(usec_from_timespec(&ts)));
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                // ts[1] is deprecated, ts[2] is the raw hardware timestamp.
+                struct scm_timestamping tss;
+                memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+                add(json_cd, "timestamp_usec",
+                    json_integer(usec_from_timespec(&tss.ts[0])));
+                add(json_cd, "hw_timestamp_usec",
+                    json_integer(usec_from_timespec(&tss.ts[2])));
+        }
+}
+
 static json_t *build_control_data(struct msghdr *msgh) {
         json_t *json_cd_list = my_json_array();
-        // TODO: Can't find where the problem is... Can't properly extract the
-        // ancillary data.
-        struct cmsghdr *cmsg;
-        cmsg = CMSG_FIRSTHDR(msgh);
-        if (cmsg) {
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msgh); cmsg;
+             cmsg = CMSG_NXTHDR(msgh, cmsg)) {
                 json_t *json_cd = my_json_object();
                 add(json_cd, "cmsg_level", json_integer(cmsg->cmsg_level));
                 add(json_cd, "cmsg_type", json_integer(cmsg->cmsg_type));
+                add_cmsg_timestamp(json_cd, cmsg);
+                if (cmsg->cmsg_level == SOL_SOCKET &&
+                    cmsg->cmsg_type == SO_RXQ_OVFL) {
+                        uint32_t drops;
+                        memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                        add(json_cd, "drops", json_integer(drops));
+                }
+                int gso_size = udp_gso_from_cmsg(cmsg);
+                if (gso_size) add(json_cd, "gso_size", json_integer(gso_size));
+                int gro_size = udp_gro_from_cmsg(cmsg);
+                if (gro_size) add(json_cd, "gro_size", json_integer(gro_size));
                 json_array_append_new(json_cd_list, json_cd);
         }
-        //        cmsg = CMSG_NXTHDR(msgh, cmsg);
-        //        for (cmsg = CMSG_FIRSTHDR(msgh); cmsg != NULL;
-        //           cmsg = CMSG_NXTHDR(msgh, cmsg)) {
-        //              json_t *json_cd = my_json_object();
-        //              add(json_cd, "cmsg_level",
-        // json_integer(cmsg->cmsg_level));
-        //              add(json_cd, "cmsg_type",
-        // json_integer(cmsg->cmsg_type));
-        //              json_array_append_new(json_cd_list, json_cd);
-        //      }
-
         return json_cd_list;
 }
 
@@ -414,6 +450,19 @@ static void add_fl_flags(json_t *details, int flags) {
         add(details, "O_NONBLOCK", json_boolean(flags & O_NONBLOCK));
 }
 
+static json_t *build_code_addr(const void *addr) {
+        char str[2 + 2 * sizeof(void *) + 1];
+        snprintf(str, sizeof(str), "0x%lx", (unsigned long)(uintptr_t)addr);
+        return json_string(str);
+}
+
+static json_t *build_stack(void *const *frames, int depth) {
+        json_t *json_stack = json_array();
+        for (int i = 0; i < depth; i++)
+                json_array_append_new(json_stack, build_code_addr(frames[i]));
+        return json_stack;
+}
+
 static void build_shared_fields(json_t *json_ev, const SockEvent *ev) {
         const char *type_str = string_from_sock_event_type(ev->type);
         add(json_ev, "type", json_string(type_str));
@@ -426,9 +475,466 @@ static void build_shared_fields(json_t *json_ev, const SockEvent *ev) {
                 free(errno_str);
         }
         add(json_ev, "thread_id", json_integer(ev->thread_id));
+        add(json_ev, "cpu", json_integer(ev->cpu));
+        if (ev->call_site)
+                add(json_ev, "call_site", build_code_addr(ev->call_site));
+        if (ev->stack)
+                add(json_ev, "stack", build_stack(ev->stack, ev->stack_depth));
         add(json_ev, "fake_call", json_boolean(false));
 }
 
+static json_t *build_histogram(const Histogram *histo) {
+        json_t *json_histo = my_json_object();
+        add(json_histo, "count", json_integer(histo->count));
+        if (histo_is_empty(histo)) return json_histo;
+        add(json_histo, "min", json_integer(histo->min));
+        add(json_histo, "max", json_integer(histo->max));
+        add(json_histo, "mean", json_integer(histo_mean(histo)));
+        add(json_histo, "p50", json_integer(histo_percentile(histo, 50)));
+        add(json_histo, "p90", json_integer(histo_percentile(histo, 90)));
+        add(json_histo, "p99", json_integer(histo_percentile(histo, 99)));
+
+        // Only non-empty buckets, as [upper_bound, count] pairs.
+        json_t *json_buckets = my_json_array();
+        for (int i = 0; i < HISTO_BUCKETS; i++) {
+                if (!histo->buckets[i]) continue;
+                unsigned long bound = (i == HISTO_BUCKETS - 1)
+                                          ? histo->max
+                                          : histo_bucket_upper_bound(i);
+                json_t *json_bucket = my_json_array();
+                json_array_append_new(json_bucket, json_integer(bound));
+                json_array_append_new(json_bucket,
+                                      json_integer(histo->buckets[i]));
+                json_array_append_new(json_buckets, json_bucket);
+        }
+        add(json_histo, "buckets", json_buckets);
+        return json_histo;
+}
+
+static json_t *build_request_response(const ReqResp *rr) {
+        json_t *json_rr = my_json_object();
+        add(json_rr, "role", json_string(rr->server ? "server" : "client"));
+        add(json_rr, "exchanges", json_integer(rr->exchanges));
+        add(json_rr, "unanswered_requests",
+            json_integer(rr->unanswered_requests));
+        add(json_rr, "unsolicited_responses",
+            json_integer(rr->unsolicited_responses));
+        add(json_rr, "response_time_usec", build_histogram(&rr->response_time));
+        add(json_rr, "request_bytes", build_histogram(&rr->request_size));
+        add(json_rr, "response_bytes", build_histogram(&rr->response_size));
+        return json_rr;
+}
+
+static json_t *build_nagle_advice(const NagleAdvisor *na) {
+        json_t *json_advice = my_json_array();
+        if (na->write_write_read)
+                json_array_append_new(
+                    json_advice,
+                    json_string("write-write-read with Nagle on: set "
+                                "TCP_NODELAY or coalesce the writes"));
+        if (na->writev_candidates)
+                json_array_append_new(
+                    json_advice,
+                    json_string("bursts of writes: use writev() or buffer "
+                                "the data in user space"));
+        if (na->small_write_bursts && !na->msg_more_writes && !na->cork_used)
+                json_array_append_new(
+                    json_advice,
+                    json_string("sub-MSS write bursts: consider MSG_MORE or "
+                                "TCP_CORK"));
+        if (na->wasted_read_syscalls)
+                json_array_append_new(
+                    json_advice, json_string("tiny reads: use a larger "
+                                             "receive buffer"));
+        return json_advice;
+}
+
+static json_t *build_nagle(const NagleAdvisor *na) {
+        json_t *json_na = my_json_object();
+        add(json_na, "TCP_NODELAY", json_boolean(na->nodelay));
+        add(json_na, "TCP_CORK", json_boolean(na->cork_used));
+        add(json_na, "snd_mss", json_integer(na->snd_mss));
+        add(json_na, "writes", json_integer(na->writes));
+        add(json_na, "small_writes", json_integer(na->small_writes));
+        add(json_na, "msg_more_writes", json_integer(na->msg_more_writes));
+        add(json_na, "corked_writes", json_integer(na->corked_writes));
+        add(json_na, "write_bursts", json_integer(na->write_bursts));
+        add(json_na, "small_write_bursts",
+            json_integer(na->small_write_bursts));
+        add(json_na, "writev_candidates", json_integer(na->writev_candidates));
+        add(json_na, "write_write_read", json_integer(na->write_write_read));
+        add(json_na, "reads", json_integer(na->reads));
+        add(json_na, "tiny_reads", json_integer(na->tiny_reads));
+        add(json_na, "wasted_syscalls",
+            json_integer(nagle_wasted_syscalls(na)));
+        add(json_na, "advice", build_nagle_advice(na));
+        return json_na;
+}
+
+static json_t *build_wakeup_threads(const Wakeups *w) {
+        json_t *json_threads = my_json_array();
+        for (int i = 0; i < w->threads_count; i++) {
+                const WakeupThread *t = &w->threads[i];
+                json_t *json_thread = my_json_object();
+                add(json_thread, "thread_id", json_integer(t->thread_id));
+                add(json_thread, "wakeups", json_integer(t->wakeups));
+                add(json_thread, "productive", json_integer(t->productive));
+                add(json_thread, "spurious", json_integer(t->spurious));
+                add(json_thread, "lost_races", json_integer(t->lost_races));
+                json_array_append_new(json_threads, json_thread);
+        }
+        return json_threads;
+}
+
+static json_t *build_wakeups(const Wakeups *w, const char *advice) {
+        json_t *json_w = my_json_object();
+        add(json_w, "wakeups", json_integer(w->wakeups));
+        add(json_w, "productive", json_integer(w->productive));
+        add(json_w, "spurious", json_integer(w->spurious));
+        add(json_w, "lost_races", json_integer(w->lost_races));
+        add(json_w, "unconsumed", json_integer(w->unconsumed));
+        add(json_w, "spurious_ratio", json_real(wakeup_spurious_ratio(w)));
+        add(json_w, "threads", build_wakeup_threads(w));
+        if (w->threads_dropped)
+                add(json_w, "threads_dropped",
+                    json_integer(w->threads_dropped));
+        json_t *json_advice = my_json_array();
+        if (w->lost_races && advice)
+                json_array_append_new(json_advice, json_string(advice));
+        add(json_w, "advice", json_advice);
+        return json_w;
+}
+
+static json_t *build_accept_queue(const AcceptQueue *aq) {
+        json_t *json_aq = my_json_object();
+        add(json_aq, "backlog", json_integer(aq->backlog));
+        add(json_aq, "samples", json_integer(aq->samples));
+        add(json_aq, "current", json_integer(aq->current));
+        add(json_aq, "high_water", json_integer(aq->high_water));
+        add(json_aq, "mean_len", json_real(aq_mean_len(aq)));
+        add(json_aq, "saturated_samples", json_integer(aq->saturated_samples));
+        add(json_aq, "saturated_usec", json_integer(aq->saturated_usec));
+        if (aq->saturated_samples)
+                add(json_aq, "first_saturation_usec",
+                    json_integer(aq->first_saturation_usec));
+        return json_aq;
+}
+
+static json_t *build_sock_queues(const SockQueues *queues) {
+        json_t *json_queues = my_json_object();
+        add(json_queues, "outq", json_integer(queues->outq));
+        add(json_queues, "outq_nsd", json_integer(queues->outq_nsd));
+        add(json_queues, "inq", json_integer(queues->inq));
+        return json_queues;
+}
+
+static json_t *build_sock_queues_stats(const SockQueuesStats *stats) {
+        json_t *json_stats = my_json_object();
+        add(json_stats, "outq", build_histogram(&stats->outq));
+        add(json_stats, "outq_nsd", build_histogram(&stats->outq_nsd));
+        add(json_stats, "inq", build_histogram(&stats->inq));
+        return json_stats;
+}
+
+// Delay between 2 timestamps of a send call, -1 if one is missing.
+static json_t *build_ts_delay(unsigned long from, unsigned long to) {
+        if (!from || !to) return json_integer(-1);
+        return json_integer(to > from ? to - from : 0);
+}
+
+static json_t *build_ts_sends(const TsSend *sends, int count) {
+        json_t *json_sends = my_json_array();
+        for (int i = 0; i < count; i++) {
+                const TsSend *s = sends + i;
+                json_t *json_send = my_json_object();
+                add(json_send, "send_id", json_integer(s->send_id));
+                add(json_send, "key", json_integer(s->key));
+                add(json_send, "bytes", json_integer(s->bytes));
+                add(json_send, "sched_delay_usec",
+                    build_ts_delay(s->call_usec, s->sched_usec));
+                add(json_send, "qdisc_delay_usec",
+                    build_ts_delay(s->sched_usec, s->sent_usec));
+                add(json_send, "ack_delay_usec",
+                    build_ts_delay(s->sent_usec, s->ack_usec));
+                json_array_append_new(json_sends, json_send);
+        }
+        return json_sends;
+}
+
+static json_t *build_timestamping(const Timestamping *ts) {
+        json_t *json_ts = my_json_object();
+        add(json_ts, "tx", json_boolean(ts->flags & TS_OPT_TX));
+        add(json_ts, "app_owned", json_boolean(ts->app_owned));
+        add(json_ts, "completed", json_integer(ts->completed));
+        add(json_ts, "incomplete", json_integer(ts->pending_count));
+        add(json_ts, "dropped", json_integer(ts->dropped));
+        add(json_ts, "foreign", json_integer(ts->foreign));
+        add(json_ts, "sched_delay", build_histogram(&ts->sched_delay));
+        add(json_ts, "qdisc_delay", build_histogram(&ts->qdisc_delay));
+        add(json_ts, "ack_delay", build_histogram(&ts->ack_delay));
+        return json_ts;
+}
+
+static json_t *build_retx_reports(const RetxReport *reports, int count) {
+        json_t *json_reports = my_json_array();
+        for (int i = 0; i < count; i++) {
+                const RetxReport *r = reports + i;
+                json_t *json_report = my_json_object();
+                add(json_report, "send_id", json_integer(r->send_id));
+                add(json_report, "bytes", json_integer(r->bytes));
+                add(json_report, "retrans_bytes",
+                    json_integer(r->retrans_bytes));
+                add(json_report, "ack_delay_usec",
+                    json_integer(r->ack_delay_usec));
+                add(json_report, "added_delay_usec",
+                    json_integer(r->added_delay_usec));
+                json_array_append_new(json_reports, json_report);
+        }
+        return json_reports;
+}
+
+static json_t *build_retransmissions(const Retransmissions *retx) {
+        json_t *json_retx = my_json_object();
+        add(json_retx, "snapshots", json_integer(retx->snapshots));
+        add(json_retx, "segments", json_integer(retx->segments));
+        add(json_retx, "bytes", json_integer(retx->bytes));
+        add(json_retx, "attributed_bytes",
+            json_integer(retx->attributed_bytes));
+        add(json_retx, "affected_calls", json_integer(retx->affected_calls));
+        add(json_retx, "clean_calls", json_integer(retx->clean_calls));
+        add(json_retx, "incomplete", json_integer(retx->pending_count));
+        add(json_retx, "dropped", json_integer(retx->dropped));
+        add(json_retx, "clean_ack_delay_usec",
+            build_histogram(&retx->clean_ack_delay));
+        add(json_retx, "retrans_ack_delay_usec",
+            build_histogram(&retx->retrans_ack_delay));
+        add(json_retx, "added_delay_usec",
+            build_histogram(&retx->added_delay));
+        return json_retx;
+}
+
+static json_t *build_anomalies(const Anomalies *anom) {
+        json_t *json_anom = my_json_object();
+        add(json_anom, "samples", json_integer(anom->samples));
+        add(json_anom, "rtt_ewma_usec", json_integer(anom_rtt_ewma(anom)));
+        for (int i = 0; i < ANOM_KINDS; i++)
+                add(json_anom, anom_kind_str(i), json_integer(anom->counts[i]));
+        return json_anom;
+}
+
+// Decoded according to the algorithm.
+static json_t *build_cc_sample(const CcSample *cc) {
+        json_t *json_cc = my_json_object();
+        add(json_cc, "algorithm", json_string(cc->algorithm));
+        if (cc->kind == CC_BBR) {
+                const struct tcp_bbr_info *bbr = &cc->info.bbr;
+                add(json_cc, "bw", json_integer(cc_bbr_bw(bbr)));
+                add(json_cc, "min_rtt", json_integer(bbr->bbr_min_rtt));
+                add(json_cc, "pacing_gain",
+                    json_real((double)bbr->bbr_pacing_gain / CC_GAIN_UNIT));
+                add(json_cc, "cwnd_gain",
+                    json_real((double)bbr->bbr_cwnd_gain / CC_GAIN_UNIT));
+        } else if (cc->kind == CC_DCTCP) {
+                const struct tcp_dctcp_info *dctcp = &cc->info.dctcp;
+                add(json_cc, "enabled", json_integer(dctcp->dctcp_enabled));
+                add(json_cc, "ce_state", json_integer(dctcp->dctcp_ce_state));
+                add(json_cc, "alpha",
+                    json_real((double)dctcp->dctcp_alpha / CC_DCTCP_ALPHA_MAX));
+                add(json_cc, "ecn_bytes", json_integer(dctcp->dctcp_ab_ecn));
+                add(json_cc, "total_bytes", json_integer(dctcp->dctcp_ab_tot));
+        } else if (cc->kind == CC_VEGAS) {
+                const struct tcpvegas_info *vegas = &cc->info.vegas;
+                add(json_cc, "enabled", json_integer(vegas->tcpv_enabled));
+                add(json_cc, "rtt_count", json_integer(vegas->tcpv_rttcnt));
+                add(json_cc, "rtt", json_integer(vegas->tcpv_rtt));
+                add(json_cc, "min_rtt", json_integer(vegas->tcpv_minrtt));
+        }
+        return json_cc;
+}
+
+static json_t *build_cc_stats(const CcStats *stats) {
+        json_t *json_cc = build_cc_sample(&stats->last);
+        add(json_cc, "samples", json_integer(stats->samples));
+        if (stats->last.kind == CC_BBR) {
+                add(json_cc, "bw_histogram", build_histogram(&stats->bbr_bw));
+                add(json_cc, "max_bw", json_integer(stats->bbr_max_bw));
+                add(json_cc, "lowest_min_rtt",
+                    json_integer(stats->bbr_min_rtt));
+        } else if (stats->last.kind == CC_DCTCP) {
+                add(json_cc, "alpha_histogram",
+                    build_histogram(&stats->dctcp_alpha));
+                add(json_cc, "max_alpha",
+                    json_real((double)stats->dctcp_max_alpha /
+                              CC_DCTCP_ALPHA_MAX));
+        }
+        return json_cc;
+}
+
+static void add_phase(json_t *json_wf, const char *key, long usec) {
+        if (usec >= 0) add(json_wf, key, json_integer(usec));
+}
+
+static json_t *build_waterfall(const Waterfall *wf) {
+        WfPhases phases;
+        wf_phases(wf, &phases);
+        json_t *json_wf = my_json_object();
+        add_phase(json_wf, "dns_usec", phases.dns);
+        add_phase(json_wf, "connect_usec", phases.connect);
+        add_phase(json_wf, "first_byte_sent_usec", phases.first_byte_sent);
+        add_phase(json_wf, "first_byte_received_usec",
+                  phases.first_byte_received);
+        add_phase(json_wf, "transfer_usec", phases.transfer);
+        add(json_wf, "idle_gaps", json_integer(wf->idle_gaps));
+        add(json_wf, "idle_usec", json_integer(wf->idle_usec));
+        add(json_wf, "max_idle_usec", json_integer(wf->max_idle_usec));
+        add_phase(json_wf, "close_wait_usec", phases.close_wait);
+        add_phase(json_wf, "close_usec", phases.close);
+        return json_wf;
+}
+
+static json_t *build_memory(const SockMemory *mem) {
+        json_t *json_mem = my_json_object();
+        add(json_mem, "samples", json_integer(mem->samples));
+        add(json_mem, "rcvbuf", json_integer(mem->last.rcvbuf));
+        add(json_mem, "sndbuf", json_integer(mem->last.sndbuf));
+        add(json_mem, "rmem_high_water", json_integer(mem->rmem_high_water));
+        add(json_mem, "wmem_high_water", json_integer(mem->wmem_high_water));
+        add(json_mem, "drops", json_integer(mem->last.drops));
+        add(json_mem, "drops_while_traced",
+            json_integer(mem->drops_while_traced));
+        add(json_mem, "drop_intervals", json_integer(mem->drop_intervals));
+        add(json_mem, "recv_calls", json_integer(mem->recv_calls));
+        add(json_mem, "recv_rate", json_real(mem_recv_rate(mem)));
+        add(json_mem, "drop_intervals_recv_rate",
+            json_real(mem_drop_intervals_recv_rate(mem)));
+        return json_mem;
+}
+
+static json_t *build_udp_offload(const UdpOffload *udp) {
+        json_t *json_udp = my_json_object();
+        add(json_udp, "gso_size", json_integer(udp->gso_size));
+        add(json_udp, "gro", json_boolean(udp->gro));
+        add(json_udp, "send_calls", json_integer(udp->send_calls));
+        add(json_udp, "datagrams_sent", json_integer(udp->datagrams_sent));
+        add(json_udp, "gso_calls", json_integer(udp->gso_calls));
+        add(json_udp, "datagrams_per_send",
+            json_real(udp->send_calls
+                          ? (double)udp->datagrams_sent / udp->send_calls
+                          : 0));
+        add(json_udp, "bytes_per_send",
+            json_real(udp->send_calls
+                          ? (double)udp->bytes_sent / udp->send_calls
+                          : 0));
+        add(json_udp, "recv_calls", json_integer(udp->recv_calls));
+        add(json_udp, "datagrams_received",
+            json_integer(udp->datagrams_received));
+        add(json_udp, "gro_calls", json_integer(udp->gro_calls));
+        add(json_udp, "datagrams_per_recv",
+            json_real(udp->recv_calls
+                          ? (double)udp->datagrams_received / udp->recv_calls
+                          : 0));
+        add(json_udp, "bytes_per_recv",
+            json_real(udp->recv_calls
+                          ? (double)udp->bytes_received / udp->recv_calls
+                          : 0));
+        return json_udp;
+}
+
+static json_t *build_flow(const UdpFlow *flow) {
+        json_t *json_flow = my_json_object();
+        Addr addr;
+        memcpy(&addr.sockaddr_sto, &flow->addr, sizeof(addr.sockaddr_sto));
+        addr.len = flow->addr_len;
+        add(json_flow, "addr", build_addr(&addr));
+        add(json_flow, "packets_sent", json_integer(flow->packets_sent));
+        add(json_flow, "packets_received",
+            json_integer(flow->packets_received));
+        add(json_flow, "bytes_sent", json_integer(flow->bytes_sent));
+        add(json_flow, "bytes_received", json_integer(flow->bytes_received));
+        add(json_flow, "first_seen_usec", json_integer(flow->first_seen_usec));
+        add(json_flow, "last_seen_usec", json_integer(flow->last_seen_usec));
+        add(json_flow, "inter_arrival_usec",
+            build_histogram(&flow->inter_arrival));
+        add(json_flow, "request_response", build_request_response(&flow->rr));
+        return json_flow;
+}
+
+static json_t *build_flows(const UdpFlows *flows) {
+        json_t *json_flows = my_json_object();
+        add(json_flows, "peers", json_integer(flows->count));
+        add(json_flows, "untracked_datagrams", json_integer(flows->untracked));
+        json_t *json_list = my_json_array();
+        for (const UdpFlow *flow = flows->first; flow; flow = flow->next)
+                json_array_append_new(json_list, build_flow(flow));
+        add(json_flows, "list", json_list);
+        return json_flows;
+}
+
+static json_t *build_conc_call(const ConcCall *call) {
+        json_t *json_call = my_json_object();
+        add(json_call, "thread_id", json_integer(call->thread_id));
+        add(json_call, "function",
+            json_string(string_from_sock_event_type(call->type)));
+        add(json_call, "call_site", build_code_addr(call->call_site));
+        add(json_call, "start_usec", json_integer(call->start_usec));
+        add(json_call, "end_usec", json_integer(call->end_usec));
+        return json_call;
+}
+
+static json_t *build_concurrency(const Concurrency *conc) {
+        json_t *json_conc = my_json_object();
+        add(json_conc, "read_overlaps", json_integer(conc->read_overlaps));
+        add(json_conc, "write_overlaps", json_integer(conc->write_overlaps));
+        add(json_conc, "close_overlaps", json_integer(conc->close_overlaps));
+        add(json_conc, "handoffs", json_integer(conc->handoffs));
+        add(json_conc, "rapid_handoffs", json_integer(conc->rapid_handoffs));
+        json_t *json_reports = my_json_array();
+        for (int i = 0; i < conc->reports_count; i++) {
+                const ConcReport *r = &conc->reports[i];
+                json_t *json_r = my_json_object();
+                add(json_r, "kind", json_string(conc_kind_str(r->kind)));
+                add(json_r, "timestamp_usec", json_integer(r->timestamp_usec));
+                add(json_r, r->kind == CONC_RAPID_HANDOFF ? "gap_usec"
+                                                          : "overlap_usec",
+                    json_integer(r->usec));
+                add(json_r, "first", build_conc_call(&r->first));
+                add(json_r, "second", build_conc_call(&r->second));
+                json_array_append_new(json_reports, json_r);
+        }
+        add(json_conc, "reports", json_reports);
+        if (conc->reports_dropped)
+                add(json_conc, "reports_dropped",
+                    json_integer(conc->reports_dropped));
+        return json_conc;
+}
+
+static json_t *build_cpu_affinity(const CpuAffinity *ca) {
+        json_t *json_ca = my_json_object();
+        add(json_ca, "events", json_integer(ca->events));
+        add(json_ca, "migrations", json_integer(ca->migrations));
+
+        // Events per CPU, as [cpu, events] pairs.
+        json_t *json_cpus = my_json_array();
+        for (int i = 0; i < ca->cpus_count; i++) {
+                json_t *json_cpu = my_json_array();
+                json_array_append_new(json_cpu,
+                                      json_integer(ca->cpus[i].cpu));
+                json_array_append_new(json_cpu,
+                                      json_integer(ca->cpus[i].events));
+                json_array_append_new(json_cpus, json_cpu);
+        }
+        add(json_ca, "cpus", json_cpus);
+        if (ca->cpus_dropped)
+                add(json_ca, "cpus_dropped", json_integer(ca->cpus_dropped));
+
+        add(json_ca, "incoming_cpu", json_integer(ca->incoming_cpu));
+        add(json_ca, "napi_id", json_integer(ca->napi_id));
+        add(json_ca, "data_calls", json_integer(ca->data_calls));
+        add(json_ca, "incoming_cpu_mismatches",
+            json_integer(ca->incoming_mismatches));
+        return json_ca;
+}
+
 #define DETAILS_FAILURE "json_object() failed. Cannot build event details."
 
 #define BUILD_EV_PRELUDE()                                   \
@@ -467,10 +973,20 @@ static json_t *build_sock_ev_bind(const SockEvBind *ev) {
         return json_ev;
 }
 
+static json_t *build_dns_link(const DnsLink *link) {
+        if (!link->found) return NULL;
+        json_t *json_link = my_json_object();
+        add(json_link, "query_id", json_integer(link->query_id));
+        add(json_link, "resolved_usec", json_integer(link->resolved_usec));
+        add(json_link, "duration_usec", json_integer(link->duration_usec));
+        return json_link;
+}
+
 static json_t *build_sock_ev_connect(const SockEvConnect *ev) {
         BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
                             // *json_details
         add(json_details, "addr", build_addr(&ev->addr));
+        add(json_details, "dns", build_dns_link(&ev->dns));
         return json_ev;
 }
 
@@ -812,6 +1328,7 @@ static json_t *build_sock_ev_epoll_ctl(const SockEvEpollCtl *ev) {
 static json_t *build_sock_ev_epoll_wait(const SockEvEpollWait *ev) {
         BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
                             // *json_details
+        add(json_details, "epfd", json_integer(ev->epfd));
         add(json_details, "timeout", json_integer(ev->timeout));
         add(json_details, "returned_events",
             build_epoll_events(ev->returned_events));
@@ -821,6 +1338,7 @@ static json_t *build_sock_ev_epoll_wait(const SockEvEpollWait *ev) {
 static json_t *build_sock_ev_epoll_pwait(const SockEvEpollPwait *ev) {
         BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
                             // *json_details
+        add(json_details, "epfd", json_integer(ev->epfd));
         add(json_details, "timeout", json_integer(ev->timeout));
         add(json_details, "returned_events",
             build_epoll_events(ev->returned_events));
@@ -884,6 +1402,107 @@ static json_t *build_sock_ev_tcp_info(const SockEvTcpInfo *ev) {
 
         add(json_details, "total_retrans", json_integer(i.tcpi_total_retrans));
 
+        /* Queues */
+        add(json_details, "queues", build_sock_queues(&ev->queues));
+
+        if (ev->cc.kind != CC_NONE)
+                add(json_details, "cc", build_cc_sample(&ev->cc));
+
+        if (ev->retrans_count)
+                add(json_details, "retransmitted_sends",
+                    build_retx_reports(ev->retrans, ev->retrans_count));
+
+        return json_ev;
+}
+
+static json_t *build_sock_ev_tx_timestamps(const SockEvTxTimestamps *ev) {
+        BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
+                            // *json_details
+        add(json_ev, "fake_call", json_boolean(true));
+        add(json_details, "sends",
+            build_ts_sends(ev->sends, ev->sends ? ev->sends_count : 0));
+        return json_ev;
+}
+
+static json_t *build_sock_ev_meminfo(const SockEvMeminfo *ev) {
+        BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
+                            // *json_details
+        add(json_ev, "fake_call", json_boolean(true));
+        const MemSample *s = &ev->sample;
+        add(json_details, "rmem_alloc", json_integer(s->rmem_alloc));
+        add(json_details, "rcvbuf", json_integer(s->rcvbuf));
+        add(json_details, "wmem_alloc", json_integer(s->wmem_alloc));
+        add(json_details, "sndbuf", json_integer(s->sndbuf));
+        add(json_details, "backlog", json_integer(s->backlog));
+        add(json_details, "drops", json_integer(s->drops));
+        add(json_details, "new_drops", json_integer(ev->interval.new_drops));
+        add(json_details, "recv_calls", json_integer(ev->interval.recv_calls));
+        add(json_details, "interval_usec",
+            json_integer(ev->interval.interval_usec));
+        return json_ev;
+}
+
+static json_t *build_sock_ev_anomaly(const SockEvAnomaly *ev) {
+        BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
+                            // *json_details
+        add(json_ev, "fake_call", json_boolean(true));
+        const Anomaly *a = &ev->anomaly;
+        add(json_details, "kind", json_string(anom_kind_str(a->kind)));
+        add(json_details, "value", json_integer(a->value));
+        add(json_details, "baseline", json_integer(a->baseline));
+        return json_ev;
+}
+
+static json_t *build_sock_ev_summary(const SockEvSummary *ev) {
+        BUILD_EV_PRELUDE()  // Inst. json_t *json_ev & json_t
+                            // *json_details
+        const SockAnalyses *a = &ev->analyses;
+        add(json_ev, "fake_call", json_boolean(true));
+        add(json_details, "bytes_sent", json_integer(ev->bytes_sent));
+        add(json_details, "bytes_received", json_integer(ev->bytes_received));
+        add(json_details, "request_response",
+            build_request_response(a->rr));
+        if (ev->stream) add(json_details, "nagle", build_nagle(&ev->nagle));
+        if (a->queues && (!histo_is_empty(&a->queues->outq) ||
+                          !histo_is_empty(&a->queues->inq)))
+                add(json_details, "queues", build_sock_queues_stats(a->queues));
+        if (ev->listening)
+                add(json_details, "accept_queue",
+                    build_accept_queue(&ev->accept_queue));
+        json_t *json_wakeups =
+            build_wakeups(a->wakeups,
+                          ev->listening
+                              ? "threads race to accept(): use SO_REUSEPORT "
+                                "or EPOLLEXCLUSIVE"
+                              : "threads race to read the socket: use "
+                                "EPOLLONESHOT or a single reader");
+        add(json_wakeups, "calls_per_wakeup",
+            build_histogram(&a->wakeups->calls_per_wakeup));
+        add(json_details, "wakeups", json_wakeups);
+        add(json_details, "cpu", build_cpu_affinity(a->cpu_affinity));
+        add(json_details, "concurrency", build_concurrency(a->concurrency));
+        if (ev->config_id != -1)
+                add(json_details, "config_id", json_integer(ev->config_id));
+        if (a->timestamping && a->timestamping->flags)
+                add(json_details, "timestamping",
+                    build_timestamping(a->timestamping));
+        if (a->retransmissions && a->retransmissions->snapshots &&
+            !ev->listening)
+                add(json_details, "retransmissions",
+                    build_retransmissions(a->retransmissions));
+        if (a->anomalies && a->anomalies->samples)
+                add(json_details, "anomalies", build_anomalies(a->anomalies));
+        if (a->cc && a->cc->samples)
+                add(json_details, "congestion_control", build_cc_stats(a->cc));
+        if (a->waterfall && a->waterfall->tracked)
+                add(json_details, "waterfall", build_waterfall(a->waterfall));
+        if (ev->memory.samples)
+                add(json_details, "memory", build_memory(&ev->memory));
+        if (ev->udp.send_calls || ev->udp.recv_calls || ev->udp.gso_size ||
+            ev->udp.gro)
+                add(json_details, "udp", build_udp_offload(&ev->udp));
+        if (ev->flows.count || ev->flows.untracked)
+                add(json_details, "flows", build_flows(&ev->flows));
         return json_ev;
 }
 
@@ -1030,12 +1649,315 @@ static json_t *build_sock_ev(const SockEvent *ev) {
                 case SOCK_EV_TCP_INFO:
                         r = build_sock_ev_tcp_info((const SockEvTcpInfo *)ev);
                         break;
+                case SOCK_EV_TX_TIMESTAMPS:
+                        r = build_sock_ev_tx_timestamps(
+                            (const SockEvTxTimestamps *)ev);
+                        break;
+                case SOCK_EV_MEMINFO:
+                        r = build_sock_ev_meminfo((const SockEvMeminfo *)ev);
+                        break;
+                case SOCK_EV_ANOMALY:
+                        r = build_sock_ev_anomaly((const SockEvAnomaly *)ev);
+                        break;
+                case SOCK_EV_SUMMARY:
+                        r = build_sock_ev_summary((const SockEvSummary *)ev);
+                        break;
         }
         return r;
 }
 
+static json_t *build_dns_addrs(const DnsEvent *ev) {
+        json_t *json_addrs = my_json_array();
+        for (int i = 0; i < ev->addrs_count; i++) {
+                char *ip = alloc_ip_str((const struct sockaddr *)&ev->addrs[i]);
+                json_array_append_new(json_addrs, json_string(ip));
+                free(ip);
+        }
+        return json_addrs;
+}
+
+static json_t *build_dns_ev(const DnsEvent *ev) {
+        json_t *json_ev = my_json_object();
+        add(json_ev, "type", json_string(string_from_dns_event_type(ev->type)));
+        add(json_ev, "id", json_integer(ev->id));
+        add(json_ev, "timestamp_usec", json_integer(ev->timestamp_usec));
+        add(json_ev, "duration_usec", json_integer(ev->duration_usec));
+        add(json_ev, "return_value", json_integer(ev->return_value));
+        add(json_ev, "success", json_boolean(ev->success));
+        if (!ev->success) {
+                if (ev->type == DNS_EV_GETADDRINFO ||
+                    ev->type == DNS_EV_GETNAMEINFO)
+                        add(json_ev, "error",
+                            json_string(gai_strerror(ev->err)));
+                else
+                        add(json_ev, "error", json_string(hstrerror(ev->err)));
+        }
+        add(json_ev, "thread_id", json_integer(ev->thread_id));
+
+        json_t *json_details = my_json_object();
+        add(json_ev, "details", json_details);
+        if (ev->node) add(json_details, "node", json_string(ev->node));
+        if (ev->service) add(json_details, "service", json_string(ev->service));
+        add(json_details, "results_count", json_integer(ev->results_count));
+        json_t *json_families = my_json_object();
+        add(json_families, "AF_INET", json_integer(ev->ipv4_count));
+        add(json_families, "AF_INET6", json_integer(ev->ipv6_count));
+        add(json_details, "families", json_families);
+        add(json_details, "addrs", build_dns_addrs(ev));
+        return json_ev;
+}
+
+static json_t *build_epoll_wakeups(const EpollWakeups *ew) {
+        json_t *json_ew = my_json_object();
+        add(json_ew, "epfd", json_integer(ew->epfd));
+        add(json_ew, "wakeups",
+            build_wakeups(&ew->wakeups,
+                          "threads woken for the same events: register the "
+                          "sockets with EPOLLEXCLUSIVE"));
+        return json_ew;
+}
+
+static json_t *build_port_dest(const PortDest *dest) {
+        json_t *json_dest = my_json_object();
+        Addr addr;
+        memcpy(&addr.sockaddr_sto, &dest->addr, sizeof(addr.sockaddr_sto));
+        addr.len = dest->addr_len;
+        add(json_dest, "addr", build_addr(&addr));
+        add(json_dest, "connects", json_integer(dest->connects));
+        add(json_dest, "implicit_binds", json_integer(dest->implicit_binds));
+        add(json_dest, "distinct_ports", json_integer(dest->distinct_ports));
+        add(json_dest, "reuses", json_integer(dest->reuses));
+        add(json_dest, "reuse_rate",
+            json_real(dest->connects ? (double)dest->reuses / dest->connects
+                                     : 0));
+        add(json_dest, "open", json_integer(dest->open));
+        add(json_dest, "active_closes", json_integer(dest->active_closes));
+        add(json_dest, "passive_closes", json_integer(dest->passive_closes));
+        add(json_dest, "time_wait", json_integer(ports_time_wait(dest)));
+        add(json_dest, "time_wait_peak", json_integer(dest->time_wait_peak));
+        add(json_dest, "pressure_peak", json_integer(dest->pressure_peak));
+
+        int low, high;
+        ports_get_range(&low, &high);
+        long range = high - low + 1;
+        json_t *json_range = my_json_object();
+        add(json_range, "low", json_integer(low));
+        add(json_range, "high", json_integer(high));
+        add(json_dest, "port_range", json_range);
+        add(json_dest, "pressure_peak_ratio",
+            json_real((double)dest->pressure_peak / range));
+        return json_dest;
+}
+
+static json_t *build_sock_index(const Socket *sock) {
+        json_t *json_index = my_json_object();
+        add(json_index, "socket", json_integer(sock->id));
+        add(json_index, "fd", json_integer(sock->fd));
+        add_sock_identity(json_index, &sock->sock_info);
+        add(json_index, "accepted", json_boolean(sock->accepted));
+        return json_index;
+}
+
+static json_t *build_sock_config(const CfgEntry *entry) {
+        const SockConfig *cfg = &entry->config;
+        json_t *json_cfg = my_json_object();
+        add(json_cfg, "id", json_integer(entry->id));
+        add(json_cfg, "sockets", json_integer(entry->sockets));
+        char *domain = alloc_sock_domain_str(cfg->domain);
+        add(json_cfg, "domain", json_string(domain));
+        free(domain);
+        char *type = alloc_sock_type_str(cfg->type);
+        add(json_cfg, "type", json_string(type));
+        free(type);
+        add(json_cfg, "sndbuf", json_integer(cfg->sndbuf));
+        add(json_cfg, "rcvbuf", json_integer(cfg->rcvbuf));
+        add(json_cfg, "keepalive", json_integer(cfg->keepalive));
+        add(json_cfg, "reuseaddr", json_integer(cfg->reuseaddr));
+        add(json_cfg, "reuseport", json_integer(cfg->reuseport));
+        add(json_cfg, "priority", json_integer(cfg->priority));
+        add(json_cfg, "linger_sec", json_integer(cfg->linger_sec));
+        add(json_cfg, "tos", json_integer(cfg->tos));
+        add(json_cfg, "max_pacing_rate", json_integer(cfg->max_pacing_rate));
+        if (cfg->type != SOCK_STREAM) return json_cfg;
+        add(json_cfg, "nodelay", json_integer(cfg->nodelay));
+        add(json_cfg, "cork", json_integer(cfg->cork));
+        add(json_cfg, "keepidle", json_integer(cfg->keepidle));
+        add(json_cfg, "keepintvl", json_integer(cfg->keepintvl));
+        add(json_cfg, "keepcnt", json_integer(cfg->keepcnt));
+        add(json_cfg, "notsent_lowat", json_integer(cfg->notsent_lowat));
+        add(json_cfg, "user_timeout", json_integer(cfg->user_timeout));
+        add(json_cfg, "congestion", json_string(cfg->congestion));
+        return json_cfg;
+}
+
+static json_t *build_wf_dest(const WfDest *dest) {
+        json_t *json_dest = my_json_object();
+        Addr addr;
+        memcpy(&addr.sockaddr_sto, &dest->addr, sizeof(addr.sockaddr_sto));
+        addr.len = dest->addr_len;
+        add(json_dest, "addr", build_addr(&addr));
+        add(json_dest, "accepted", json_boolean(dest->accepted));
+        add(json_dest, "connections", json_integer(dest->connections));
+        add(json_dest, "dns_usec", build_histogram(&dest->dns));
+        add(json_dest, "connect_usec", build_histogram(&dest->connect));
+        add(json_dest, "first_byte_sent_usec",
+            build_histogram(&dest->first_byte_sent));
+        add(json_dest, "first_byte_received_usec",
+            build_histogram(&dest->first_byte_received));
+        add(json_dest, "transfer_usec", build_histogram(&dest->transfer));
+        add(json_dest, "idle_usec", build_histogram(&dest->idle));
+        add(json_dest, "close_wait_usec", build_histogram(&dest->close_wait));
+        add(json_dest, "close_usec", build_histogram(&dest->close));
+        return json_dest;
+}
+
+static json_t *build_call_site(const CallSite *site) {
+        json_t *json_site = my_json_object();
+        add(json_site, "call_site", build_code_addr(site->addr));
+        add(json_site, "function",
+            json_string(string_from_sock_event_type(site->type)));
+        add(json_site, "calls", json_integer(site->calls));
+        add(json_site, "errors", json_integer(site->errors));
+        add(json_site, "bytes", json_integer(site->bytes));
+        add(json_site, "bytes_per_call",
+            build_histogram(&site->bytes_per_call));
+        add(json_site, "latency_usec", build_histogram(&site->latency));
+        return json_site;
+}
+
+static json_t *build_prof_time(const ProfTime *time) {
+        json_t *json_time = my_json_object();
+        add(json_time, "calls", json_integer(time->calls));
+        add(json_time, "blocked_usec", json_integer(time->blocked_usec));
+        return json_time;
+}
+
+static json_t *build_thread_profile(const ProfThread *t) {
+        json_t *json_thread = my_json_object();
+        add(json_thread, "thread_id", json_integer(t->thread_id));
+        add(json_thread, "name", json_string(t->name));
+        add(json_thread, "calls", json_integer(t->total.calls));
+        add(json_thread, "blocked_usec", json_integer(t->total.blocked_usec));
+        unsigned long observed = t->last_call_usec - t->first_call_usec;
+        add(json_thread, "observed_usec", json_integer(observed));
+        add(json_thread, "blocked_ratio",
+            json_real(observed ? (double)t->total.blocked_usec / observed
+                               : 0));
+        add(json_thread, "blocked_per_call_usec",
+            build_histogram(&t->blocked));
+
+        json_t *json_types = json_array();
+        for (int i = 0; i < SOCK_EV_SUMMARY; i++) {
+                if (!t->by_type[i].calls) continue;
+                json_t *json_fn = build_prof_time(&t->by_type[i]);
+                add(json_fn, "function",
+                    json_string(string_from_sock_event_type(i)));
+                json_array_append_new(json_types, json_fn);
+        }
+        add(json_thread, "by_function", json_types);
+
+        json_t *json_sockets = json_array();
+        for (int i = 0; i < t->sockets_count; i++) {
+                json_t *json_sock = build_prof_time(&t->sockets[i].time);
+                add(json_sock, "socket", json_integer(t->sockets[i].sock_id));
+                json_array_append_new(json_sockets, json_sock);
+        }
+        add(json_thread, "by_socket", json_sockets);
+        add(json_thread, "other_sockets", build_prof_time(&t->other_sockets));
+        add(json_thread, "multiplexed", build_prof_time(&t->multiplexed));
+        return json_thread;
+}
+
 /* Public functions */
 
+char *alloc_thread_profile_json(const ProfThread *t) {
+        json_t *json_thread = build_thread_profile(t);
+        char *json_string = json_dumps(json_thread, 0);
+        json_decref(json_thread);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_call_site_json(const CallSite *site) {
+        json_t *json_site = build_call_site(site);
+        char *json_string = json_dumps(json_site, 0);
+        json_decref(json_site);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_sock_index_json(const Socket *sock) {
+        json_t *json_index = build_sock_index(sock);
+        char *json_string = json_dumps(json_index, 0);
+        json_decref(json_index);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_sock_config_json(const CfgEntry *entry) {
+        json_t *json_cfg = build_sock_config(entry);
+        char *json_string = json_dumps(json_cfg, 0);
+        json_decref(json_cfg);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_wf_dest_json(const WfDest *dest) {
+        json_t *json_dest = build_wf_dest(dest);
+        char *json_string = json_dumps(json_dest, 0);
+        json_decref(json_dest);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_port_dest_json(const PortDest *dest) {
+        json_t *json_dest = build_port_dest(dest);
+        char *json_string = json_dumps(json_dest, 0);
+        json_decref(json_dest);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_epoll_wakeups_json(const EpollWakeups *ew) {
+        json_t *json_ew = build_epoll_wakeups(ew);
+        char *json_string = json_dumps(json_ew, 0);
+        json_decref(json_ew);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
+char *alloc_dns_ev_json(const DnsEvent *ev) {
+        json_t *json_ev = build_dns_ev(ev);
+        char *json_string = json_dumps(json_ev, 0);
+        json_decref(json_ev);
+        if (!json_string) goto error;
+        return json_string;
+error:
+        LOG_FUNC_ERROR;
+        return NULL;
+}
+
 char *alloc_sock_ev_json(const SockEvent *ev) {
         json_t *json_ev = build_sock_ev(ev);
         if (!json_ev) goto error;
@@ -1,8 +1,23 @@
 #ifndef TCP_SPY_JSON_H
 #define TCP_SPY_JSON_H
 
+#include "call_sites.h"
+#include "local_ports.h"
+#include "name_resolution.h"
+#include "sock_config.h"
 #include "sock_events.h"
+#include "thread_profile.h"
+#include "wakeups.h"
+#include "waterfall.h"
 
 char *alloc_sock_ev_json(const SockEvent *ev);
+char *alloc_dns_ev_json(const DnsEvent *ev);
+char *alloc_epoll_wakeups_json(const EpollWakeups *ew);
+char *alloc_port_dest_json(const PortDest *dest);
+char *alloc_wf_dest_json(const WfDest *dest);
+char *alloc_call_site_json(const CallSite *site);
+char *alloc_sock_config_json(const CfgEntry *entry);
+char *alloc_sock_index_json(const Socket *sock);
+char *alloc_thread_profile_json(const ProfThread *t);
 
 #endif
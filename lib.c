@@ -5,6 +5,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <netinet/in.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -42,6 +44,55 @@ error:
         return ret;
 }
 
+typedef int (*orig_setsockopt_type)(int sockfd, int level, int optname,
+                                    const void *optval, socklen_t optlen);
+
+orig_setsockopt_type orig_setsockopt;
+
+int my_setsockopt(int sockfd, int level, int optname, const void *optval,
+                  socklen_t optlen) {
+        if (!orig_setsockopt)
+                orig_setsockopt =
+                    (orig_setsockopt_type)dlsym(RTLD_NEXT, "setsockopt");
+        int ret = orig_setsockopt(sockfd, level, optname, optval, optlen);
+        if (ret) goto error;
+        return ret;
+error:
+        LOG(ERROR, "setsockopt() failed. %s.", strerror(errno));
+        LOG_FUNC_ERROR;
+        return ret;
+}
+
+typedef int (*orig_getsockname_type)(int sockfd, struct sockaddr *addr,
+                                     socklen_t *addrlen);
+
+orig_getsockname_type orig_getsockname;
+
+int my_getsockname(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
+        if (!orig_getsockname)
+                orig_getsockname =
+                    (orig_getsockname_type)dlsym(RTLD_NEXT, "getsockname");
+        int ret = orig_getsockname(sockfd, addr, addrlen);
+        if (ret) goto error;
+        return ret;
+error:
+        LOG(ERROR, "getsockname() failed. %s.", strerror(errno));
+        LOG_FUNC_ERROR;
+        return ret;
+}
+
+typedef ssize_t (*orig_recvmsg_type)(int sockfd, struct msghdr *msg,
+                                     int flags);
+
+orig_recvmsg_type orig_recvmsg;
+
+// Errors are not logged: EAGAIN is expected with MSG_DONTWAIT.
+ssize_t my_recvmsg(int sockfd, struct msghdr *msg, int flags) {
+        if (!orig_recvmsg)
+                orig_recvmsg = (orig_recvmsg_type)dlsym(RTLD_NEXT, "recvmsg");
+        return orig_recvmsg(sockfd, msg, flags);
+}
+
 typedef FILE *(*orig_fdopen_type)(int fd, const char *mode);
 
 orig_fdopen_type orig_fdopen;
@@ -134,6 +185,47 @@ error:
         return false;
 }
 
+// Unlike my_getsockopt(), an option unknown to the kernel is not an error.
+bool same_inet_addr(const struct sockaddr *a1, const struct sockaddr *a2) {
+        if (a1->sa_family != a2->sa_family) return false;
+        if (a1->sa_family == AF_INET) {
+                const struct sockaddr_in *in1 = (const struct sockaddr_in *)a1;
+                const struct sockaddr_in *in2 = (const struct sockaddr_in *)a2;
+                return in1->sin_port == in2->sin_port &&
+                       in1->sin_addr.s_addr == in2->sin_addr.s_addr;
+        }
+        if (a1->sa_family == AF_INET6) {
+                const struct sockaddr_in6 *in1 =
+                    (const struct sockaddr_in6 *)a1;
+                const struct sockaddr_in6 *in2 =
+                    (const struct sockaddr_in6 *)a2;
+                return in1->sin6_port == in2->sin6_port &&
+                       !memcmp(&in1->sin6_addr, &in2->sin6_addr,
+                               sizeof(in1->sin6_addr));
+        }
+        return false;
+}
+
+bool get_sockopt_if_supported(int fd, int level, int optname, void *val,
+                              socklen_t *optlen) {
+        if (!orig_getsockopt)
+                orig_getsockopt =
+                    (orig_getsockopt_type)dlsym(RTLD_NEXT, "getsockopt");
+        return !orig_getsockopt(fd, level, optname, val, optlen);
+}
+
+bool get_int_sockopt_if_supported(int fd, int level, int optname, int *val) {
+        socklen_t optlen = sizeof(int);
+        return get_sockopt_if_supported(fd, level, optname, val, &optlen);
+}
+
+bool set_int_sockopt_if_supported(int fd, int level, int optname, int val) {
+        if (!orig_setsockopt)
+                orig_setsockopt =
+                    (orig_setsockopt_type)dlsym(RTLD_NEXT, "setsockopt");
+        return !orig_setsockopt(fd, level, optname, &val, sizeof(val));
+}
+
 int append_string_to_file(const char *str, const char *path) {
         FILE *fp = fopen(path, "a");
         if (!fp) goto error1;
@@ -154,6 +246,32 @@ error_out:
         return -1;
 }
 
+bool write_json_lines(const char *file, bool append, int count,
+                      char *(*alloc_line)(int i, void *arg), void *arg) {
+        char *path = alloc_concat_path(logs_dir_path, file);
+        if (!path) goto error_out;
+        FILE *fp = fopen(path, append ? "a" : "w");
+        free(path);
+        if (!fp) goto error;
+
+        for (int i = 0; i < count; i++) {
+                char *json_str = alloc_line(i, arg);
+                if (!json_str) continue;
+                my_fputs(json_str, fp);
+                my_fputs("\n", fp);
+                free(json_str);
+        }
+
+        if (fclose(fp) == EOF)
+                LOG(ERROR, "fclose() failed. %s.", strerror(errno));
+        return true;
+error:
+        LOG(ERROR, "fopen() failed. %s.", strerror(errno));
+error_out:
+        LOG_FUNC_ERROR;
+        return false;
+}
+
 int fill_timeval(struct timeval *timeval) {
         if (gettimeofday(timeval, NULL)) goto error;
         return 0;
@@ -182,6 +300,10 @@ error:
         return 0;
 }
 
+/* sched_getcpu() reads the CPU number from the rseq area or the vDSO, so it is
+ * cheap enough to be called for each event. Returns -1 on failure. */
+int get_current_cpu(void) { return sched_getcpu(); }
+
 unsigned long get_time_micros(void) {
         struct timeval tv;
         if (fill_timeval(&tv)) goto error;
@@ -334,6 +456,22 @@ error:
         abort();
 }
 
+void *my_aligned_calloc(size_t size) {
+#ifdef PACKED_SOCKETS
+        return my_calloc(size);
+#else
+        void *ret;
+        int rc = posix_memalign(&ret, CACHE_LINE_SIZE, size);
+        if (rc) goto error;
+        memset(ret, 0, size);
+        return ret;
+error:
+        LOG(ERROR, "posix_memalign() failed. %s.", strerror(rc));
+        LOG_FUNC_ERROR;
+        abort();
+#endif
+}
+
 int my_fputs(const char *s, FILE *stream) {
         int ret = fputs(s, stream);
         if (ret == EOF) goto error;
@@ -4,6 +4,7 @@
 #include <netinet/tcp.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -11,10 +12,33 @@
 #include <unistd.h>
 
 #define UNUSED(x) (void)(x)
+#define CACHE_LINE_SIZE 64
+
+// Building with PACKED_SOCKETS=1 drops the cache line alignment of the sockets
+// and of their locks, to measure its effect (see "rake bench").
+#ifdef PACKED_SOCKETS
+#define CACHE_ALIGNED
+#else
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#endif
+
+// Initializer of the static mutexes, see mutex_init() for the others.
+#ifdef __ANDROID__
+#define MUTEX_ERRORCHECK PTHREAD_ERRORCHECK_MUTEX_INITIALIZER
+#else
+#define MUTEX_ERRORCHECK PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP
+#endif
 
 int my_getsockopt(int sockfd, int level, int optname, void *optval,
                   socklen_t *optlen);
 
+int my_setsockopt(int sockfd, int level, int optname, const void *optval,
+                  socklen_t optlen);
+
+int my_getsockname(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+
+ssize_t my_recvmsg(int sockfd, struct msghdr *msg, int flags);
+
 FILE *my_fdopen(int fd, const char *mode);
 
 #ifdef __ANDROID__
@@ -28,13 +52,29 @@ bool is_socket(int fd);
 bool is_inet_socket(int fd);
 bool is_tcp_socket(int fd);
 
+// Same family, address and port. Only for AF_INET and AF_INET6, false
+// otherwise.
+bool same_inet_addr(const struct sockaddr *a1, const struct sockaddr *a2);
+
+bool get_sockopt_if_supported(int fd, int level, int optname, void *val,
+                              socklen_t *optlen);
+bool get_int_sockopt_if_supported(int fd, int level, int optname, int *val);
+bool set_int_sockopt_if_supported(int fd, int level, int optname, int val);
+
 int append_string_to_file(const char *str, const char *path);
 
+// Writes count lines of JSON to a file of the trace directory, in append mode
+// or from scratch. Line i is returned by alloc_line(i, arg), to be freed, or
+// NULL to skip it. Returns false if the file could not be opened.
+bool write_json_lines(const char *file, bool append, int count,
+                      char *(*alloc_line)(int i, void *arg), void *arg);
+
 int fill_tcp_info(int fd, struct tcp_info *info);
 int fill_timeval(struct timeval *timeval);
 
 time_t get_time_sec(void);
 unsigned long get_time_micros(void);
+int get_current_cpu(void);
 
 long parse_long(const char *str);
 long get_env_as_long(const char *env_var);
@@ -54,8 +94,21 @@ int my_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
                       void *(*start_routine)(void *), void *arg);
 void *my_malloc(size_t size);
 void *my_calloc(size_t size);
+// Zeroed, aligned as CACHE_ALIGNED, freed with free().
+void *my_aligned_calloc(size_t size);
 int my_fputs(const char *s, FILE *stream);
 
 bool is_dir_writable(const char *path);
 
+// FNV-1a. Inline, as the columnar exporter is built without this library.
+static inline uint32_t hash_bytes(const void *bytes, size_t len) {
+        const unsigned char *b = (const unsigned char *)bytes;
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < len; i++) {
+                hash ^= b[i];
+                hash *= 16777619u;
+        }
+        return hash;
+}
+
 #endif
@@ -23,10 +23,13 @@
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include "call_sites.h"
 #include "init.h"
 #include "logger.h"
+#include "name_resolution.h"
 #include "sock_events.h"
 #include "string_builders.h"
+#include "thread_profile.h"
 
 #define EXPORT __attribute__((visibility("default")))
 #define LIBC_VERSION (__GLIBC__ * 100 + __GLIBC_MINOR__)
@@ -45,9 +48,11 @@
                 if (!orig_##FUNCTION)                                      \
                         orig_##FUNCTION =                                  \
                             (FUNCTION##_type)dlsym(RTLD_NEXT, #FUNCTION);  \
+                bool is_inet = is_inet_socket(fd);                         \
+                cs_enter(__builtin_return_address(0), is_inet);            \
                 RETURN_TYPE ret = orig_##FUNCTION(fd, arg##ARGS_COUNT);    \
                 int err = errno;                                           \
-                if (is_inet_socket(fd))                                    \
+                if (is_inet)                                               \
                         sock_ev_##FUNCTION(fd, ret, err, arg##ARGS_COUNT); \
                 errno = err;                                               \
                 return ret;                                                \
@@ -61,9 +66,11 @@
                 if (!orig_##FUNCTION)                                     \
                         orig_##FUNCTION =                                 \
                             (FUNCTION##_type)dlsym(RTLD_NEXT, #FUNCTION); \
+                bool is_inet = is_inet_socket(fd);                        \
+                cs_enter(__builtin_return_address(0), is_inet);           \
                 RETURN_TYPE ret = orig_##FUNCTION(fd);                    \
                 int err = errno;                                          \
-                if (is_inet_socket(fd)) sock_ev_##FUNCTION(fd, ret, err); \
+                if (is_inet) sock_ev_##FUNCTION(fd, ret, err);            \
                 errno = err;                                              \
                 return ret;                                               \
         }
@@ -93,6 +100,7 @@ typedef int (*socket_type)(int domain, int type, int protocol);
 socket_type orig_socket;
 
 EXPORT int socket(int domain, int type, int protocol) {
+        cs_enter(__builtin_return_address(0), true);  // No fd to check yet.
         if (!orig_socket) orig_socket = (socket_type)dlsym(RTLD_NEXT, "socket");
         int fd = orig_socket(domain, type, protocol);
         if (is_inet_socket(fd)) sock_ev_socket(fd, domain, type, protocol);
@@ -106,10 +114,12 @@ EXPORT int connect(int fd, const struct sockaddr *addr, socklen_t len) {
         if (!orig_connect)
                 orig_connect = (connect_type)dlsym(RTLD_NEXT, "connect");
 
-        if (is_inet_socket(fd) && conf_opt_c) sock_start_capture(fd, addr);
+        bool is_inet = is_inet_socket(fd);
+        if (is_inet && conf_opt_c) sock_start_capture(fd, addr);
+        cs_enter(__builtin_return_address(0), is_inet);
         int ret = orig_connect(fd, addr, len);
         int err = errno;
-        if (is_inet_socket(fd)) sock_ev_connect(fd, ret, err, addr, len);
+        if (is_inet) sock_ev_connect(fd, ret, err, addr, len);
 
         errno = err;
         return ret;
@@ -193,6 +203,8 @@ EXPORT int close(int fd) {
         if (!orig_close) orig_close = (close_type)dlsym(RTLD_NEXT, "close");
 
         bool is_inet = is_inet_socket(fd);
+        if (is_inet) sock_before_close(fd);
+        cs_enter(__builtin_return_address(0), is_inet);
         int ret = orig_close(fd);
         int err = errno;
         if (is_inet) sock_ev_close(fd, ret, err);
@@ -268,9 +280,11 @@ EXPORT int ioctl(int fd, unsigned long int request, ...) {
 
         if (!orig_ioctl) orig_ioctl = (ioctl_type)dlsym(RTLD_NEXT, "ioctl");
 
+        bool is_inet = is_inet_socket(fd);
+        cs_enter(__builtin_return_address(0), is_inet);
         int ret = orig_ioctl(fd, request, value);
         int err = errno;
-        if (is_inet_socket(fd)) sock_ev_ioctl(fd, ret, err, request);
+        if (is_inet) sock_ev_ioctl(fd, ret, err, request);
 
         errno = err;
         return ret;
@@ -308,15 +322,21 @@ poll_type orig_poll;
 EXPORT int poll(struct pollfd *fds, nfds_t nfds, int timeout) {
         if (!orig_poll) orig_poll = (poll_type)dlsym(RTLD_NEXT, "poll");
 
+        unsigned long start_usec = get_time_micros();
         int ret = orig_poll(fds, nfds, timeout);
         int err = errno;
+        unsigned long end_usec = get_time_micros();
+        bool sockets = false;
         unsigned long i;
         for (i = 0; i < nfds; i++) {
                 struct pollfd pollfd = fds[i];
-                if (is_inet_socket(pollfd.fd))
+                if (is_inet_socket(pollfd.fd)) {
+                        sockets = true;
                         sock_ev_poll(pollfd.fd, ret, err, pollfd.events,
                                      pollfd.revents, timeout);
+                }
         }
+        if (sockets) prof_on_wait(SOCK_EV_POLL, start_usec, end_usec);
 
         errno = err;
         return ret;
@@ -331,15 +351,21 @@ EXPORT int ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *tmo_p,
           const sigset_t *sigmask) {
         if (!orig_ppoll) orig_ppoll = (ppoll_type)dlsym(RTLD_NEXT, "ppoll");
 
+        unsigned long start_usec = get_time_micros();
         int ret = orig_ppoll(fds, nfds, tmo_p, sigmask);
         int err = errno;
+        unsigned long end_usec = get_time_micros();
+        bool sockets = false;
         unsigned long i;
         for (i = 0; i < nfds; i++) {
                 struct pollfd pollfd = fds[i];
-                if (is_inet_socket(pollfd.fd))
+                if (is_inet_socket(pollfd.fd)) {
+                        sockets = true;
                         sock_ev_ppoll(pollfd.fd, ret, err, pollfd.events,
                                       pollfd.revents, tmo_p);
+                }
         }
+        if (sockets) prof_on_wait(SOCK_EV_PPOLL, start_usec, end_usec);
 
         errno = err;
         return ret;
@@ -384,12 +410,16 @@ EXPORT int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds
                 }
         }
 
+        unsigned long start_usec = get_time_micros();
         int ret = orig_select(nfds, readfds, writefds, exceptfds, timeout);
         int err = errno;
+        unsigned long end_usec = get_time_micros();
+        bool sockets = false;
 
         for (fd = 0; fd < nfds; fd++) {
                 if (is_inet_socket(fd) &&
                     req_ev[fd]) {  // Socket was in initial call
+                        sockets = true;
                         sock_ev_select(fd, ret, err, (req_ev[fd] & READ_FLAG),
                                        (req_ev[fd] & WRITE_FLAG),
                                        (req_ev[fd] & EXCEPT_FLAG),
@@ -399,6 +429,7 @@ EXPORT int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds
                                        timeout);
                 }
         }
+        if (sockets) prof_on_wait(SOCK_EV_SELECT, start_usec, end_usec);
 
         return ret;
 }
@@ -428,12 +459,16 @@ EXPORT int pselect(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfd
                 }
         }
 
+        unsigned long start_usec = get_time_micros();
         int ret =
             orig_pselect(nfds, readfds, writefds, exceptfds, timeout, sigmask);
         int err = errno;
+        unsigned long end_usec = get_time_micros();
+        bool sockets = false;
 
         for (fd = 0; fd < nfds; fd++) {
                 if (is_inet_socket(fd) && req_ev[fd]) {
+                        sockets = true;
                         sock_ev_pselect(fd, ret, err, (req_ev[fd] & READ_FLAG),
                                         (req_ev[fd] & WRITE_FLAG),
                                         (req_ev[fd] & EXCEPT_FLAG),
@@ -443,6 +478,7 @@ EXPORT int pselect(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfd
                                         timeout);
                 }
         }
+        if (sockets) prof_on_wait(SOCK_EV_PSELECT, start_usec, end_usec);
 
         errno = err;
         return ret;
@@ -472,9 +508,11 @@ EXPORT int fcntl(int fd, int cmd, ...) {
         arg = va_arg(argp, void *);
         va_end(argp);
 
+        bool is_inet = is_inet_socket(fd);
+        cs_enter(__builtin_return_address(0), is_inet);
         int ret = orig_fcntl(fd, cmd, arg);
         int err = errno;
-        if (is_inet_socket(fd)) sock_ev_fcntl(fd, ret, err, cmd, arg);
+        if (is_inet) sock_ev_fcntl(fd, ret, err, cmd, arg);
 
         errno = err;
         return ret;
@@ -501,10 +539,14 @@ EXPORT int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
         if (!orig_epoll_ctl)
                 orig_epoll_ctl = (epoll_ctl_type)dlsym(RTLD_NEXT, "epoll_ctl");
 
+        bool is_inet = is_inet_socket(fd);
+        cs_enter(__builtin_return_address(0), is_inet);
         int ret = orig_epoll_ctl(epfd, op, fd, event);
         int err = errno;
-        if (is_inet_socket(fd))
+        if (is_inet) {
+                if (!ret && op == EPOLL_CTL_ADD) prof_watch_epfd(epfd);
                 sock_ev_epoll_ctl(fd, ret, err, op, event->events);
+        }
 
         errno = err;
         return ret;
@@ -521,16 +563,20 @@ EXPORT int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
                 orig_epoll_wait =
                     (epoll_wait_type)dlsym(RTLD_NEXT, "epoll_wait");
 
+        unsigned long start_usec = get_time_micros();
         int ret = orig_epoll_wait(epfd, events, maxevents, timeout);
         int err = errno;
+        unsigned long end_usec = get_time_micros();
         for (int i = 0; i < ret; i++) {
                 int fd = events[i].data.fd;
                 if (is_inet_socket(fd)) {
                         uint32_t returned_events = events[i].events;
-                        sock_ev_epoll_wait(fd, ret, err, timeout,
+                        sock_ev_epoll_wait(fd, ret, err, epfd, timeout,
                                            returned_events);
                 }
         }
+        if (prof_is_watched_epfd(epfd))
+                prof_on_wait(SOCK_EV_EPOLL_WAIT, start_usec, end_usec);
 
         errno = err;
         return ret;
@@ -548,16 +594,20 @@ EXPORT int epoll_pwait(int epfd, struct epoll_event *events, int maxevents,
                 orig_epoll_pwait =
                     (epoll_pwait_type)dlsym(RTLD_NEXT, "epoll_pwait");
 
+        unsigned long start_usec = get_time_micros();
         int ret = orig_epoll_pwait(epfd, events, maxevents, timeout, sigmask);
         int err = errno;
+        unsigned long end_usec = get_time_micros();
         for (int i = 0; i < ret; i++) {
                 int fd = events[i].data.fd;
                 if (is_inet_socket(fd)) {
                         uint32_t returned_events = events[i].events;
-                        sock_ev_epoll_pwait(fd, ret, err, timeout,
+                        sock_ev_epoll_pwait(fd, ret, err, epfd, timeout,
                                             returned_events);
                 }
         }
+        if (prof_is_watched_epfd(epfd))
+                prof_on_wait(SOCK_EV_EPOLL_PWAIT, start_usec, end_usec);
 
         errno = err;
         return ret;
@@ -576,3 +626,145 @@ EXPORT int epoll_pwait(int epfd, struct epoll_event *events, int maxevents,
 */
 
 override(fdopen, FILE *, 2, const char *a);
+
+/*
+  _   _ _____ _____ ____  ____       _    ____ ___
+ | \ | | ____|_   _|  _ \| __ )     / \  |  _ \_ _|
+ |  \| |  _|   | | | | | |  _ \    / _ \ | |_) | |
+ | |\  | |___  | | | |_| | |_) |  / ___ \|  __/| |
+ |_| \_|_____| |_| |____/|____/  /_/   \_\_|  |___|
+
+ netdb.h
+
+ functions: getaddrinfo(), getnameinfo(), gethostbyname(), gethostbyname2(),
+ gethostbyname_r(), gethostbyname2_r().
+*/
+
+typedef int (*getaddrinfo_type)(const char *node, const char *service,
+                                const struct addrinfo *hints,
+                                struct addrinfo **res);
+
+getaddrinfo_type orig_getaddrinfo;
+
+EXPORT int getaddrinfo(const char *node, const char *service,
+                       const struct addrinfo *hints, struct addrinfo **res) {
+        if (!orig_getaddrinfo)
+                orig_getaddrinfo =
+                    (getaddrinfo_type)dlsym(RTLD_NEXT, "getaddrinfo");
+
+        unsigned long start = get_time_micros();
+        int ret = orig_getaddrinfo(node, service, hints, res);
+        int err = errno;
+        dns_ev_getaddrinfo(ret, node, service, (ret == 0) ? *res : NULL, start);
+        errno = err;
+        return ret;
+}
+
+#ifndef __ANDROID__  // Bionic uses size_t for hostlen & servlen.
+typedef int (*getnameinfo_type)(const struct sockaddr *addr, socklen_t addrlen,
+                                char *host, socklen_t hostlen, char *serv,
+                                socklen_t servlen, int flags);
+
+getnameinfo_type orig_getnameinfo;
+
+EXPORT int getnameinfo(const struct sockaddr *addr, socklen_t addrlen,
+                       char *host, socklen_t hostlen, char *serv,
+                       socklen_t servlen, int flags) {
+        if (!orig_getnameinfo)
+                orig_getnameinfo =
+                    (getnameinfo_type)dlsym(RTLD_NEXT, "getnameinfo");
+
+        unsigned long start = get_time_micros();
+        int ret = orig_getnameinfo(addr, addrlen, host, hostlen, serv, servlen,
+                                   flags);
+        int err = errno;
+        dns_ev_getnameinfo(ret, addr, addrlen, (host && hostlen) ? host : NULL,
+                           (serv && servlen) ? serv : NULL, start);
+        errno = err;
+        return ret;
+}
+#endif
+
+typedef struct hostent *(*gethostbyname_type)(const char *name);
+
+gethostbyname_type orig_gethostbyname;
+
+EXPORT struct hostent *gethostbyname(const char *name) {
+        if (!orig_gethostbyname)
+                orig_gethostbyname =
+                    (gethostbyname_type)dlsym(RTLD_NEXT, "gethostbyname");
+
+        unsigned long start = get_time_micros();
+        struct hostent *ret = orig_gethostbyname(name);
+        int err = errno;
+        dns_ev_gethostbyname(DNS_EV_GETHOSTBYNAME, name, ret, h_errno, start);
+        errno = err;
+        return ret;
+}
+
+typedef struct hostent *(*gethostbyname2_type)(const char *name, int af);
+
+gethostbyname2_type orig_gethostbyname2;
+
+EXPORT struct hostent *gethostbyname2(const char *name, int af) {
+        if (!orig_gethostbyname2)
+                orig_gethostbyname2 =
+                    (gethostbyname2_type)dlsym(RTLD_NEXT, "gethostbyname2");
+
+        unsigned long start = get_time_micros();
+        struct hostent *ret = orig_gethostbyname2(name, af);
+        int err = errno;
+        dns_ev_gethostbyname(DNS_EV_GETHOSTBYNAME2, name, ret, h_errno, start);
+        errno = err;
+        return ret;
+}
+
+#ifndef __ANDROID__
+typedef int (*gethostbyname_r_type)(const char *name, struct hostent *ret,
+                                    char *buf, size_t buflen,
+                                    struct hostent **result, int *h_errnop);
+
+gethostbyname_r_type orig_gethostbyname_r;
+
+EXPORT int gethostbyname_r(const char *name, struct hostent *ret, char *buf,
+                           size_t buflen, struct hostent **result,
+                           int *h_errnop) {
+        if (!orig_gethostbyname_r)
+                orig_gethostbyname_r =
+                    (gethostbyname_r_type)dlsym(RTLD_NEXT, "gethostbyname_r");
+
+        unsigned long start = get_time_micros();
+        int r = orig_gethostbyname_r(name, ret, buf, buflen, result, h_errnop);
+        int err = errno;
+        dns_ev_gethostbyname(DNS_EV_GETHOSTBYNAME_R, name,
+                             (r == 0) ? *result : NULL,
+                             h_errnop ? *h_errnop : 0, start);
+        errno = err;
+        return r;
+}
+
+typedef int (*gethostbyname2_r_type)(const char *name, int af,
+                                     struct hostent *ret, char *buf,
+                                     size_t buflen, struct hostent **result,
+                                     int *h_errnop);
+
+gethostbyname2_r_type orig_gethostbyname2_r;
+
+EXPORT int gethostbyname2_r(const char *name, int af, struct hostent *ret,
+                            char *buf, size_t buflen, struct hostent **result,
+                            int *h_errnop) {
+        if (!orig_gethostbyname2_r)
+                orig_gethostbyname2_r = (gethostbyname2_r_type)dlsym(
+                    RTLD_NEXT, "gethostbyname2_r");
+
+        unsigned long start = get_time_micros();
+        int r = orig_gethostbyname2_r(name, af, ret, buf, buflen, result,
+                                      h_errnop);
+        int err = errno;
+        dns_ev_gethostbyname(DNS_EV_GETHOSTBYNAME2_R, name,
+                             (r == 0) ? *result : NULL,
+                             h_errnop ? *h_errnop : 0, start);
+        errno = err;
+        return r;
+}
+#endif
@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+
+#include "local_ports.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+#define PORT_RANGE_PATH "/proc/sys/net/ipv4/ip_local_port_range"
+#define PORTS_BITMAP_SIZE (65536 / 8)
+
+static pthread_mutex_t ports_mutex = MUTEX_ERRORCHECK;
+static PortDest dests[PORTS_DESTS_MAX];
+static int dests_count = 0;
+static long dests_dropped = 0;  // Connects to destinations beyond the max.
+static int range_low = 0;       // 0 until read.
+static int range_high = 0;
+
+/* Private functions */
+
+static void read_port_range(void) {
+        if (range_low) return;
+        // Defaults of Linux, if /proc is not readable.
+        range_low = 32768;
+        range_high = 60999;
+        FILE *fp = fopen(PORT_RANGE_PATH, "r");
+        if (!fp) return;
+        int low, high;
+        if (fscanf(fp, "%d %d", &low, &high) == 2 && low > 0 && high >= low) {
+                range_low = low;
+                range_high = high;
+        }
+        fclose(fp);
+}
+
+static int get_dest(const struct sockaddr *addr, socklen_t len) {
+        for (int i = 0; i < dests_count; i++)
+                if (same_inet_addr((const struct sockaddr *)&dests[i].addr,
+                                   addr))
+                        return i;
+        if (dests_count == PORTS_DESTS_MAX) return -1;
+        PortDest *dest = &dests[dests_count];
+        memset(dest, 0, sizeof(PortDest));
+        if (len > sizeof(dest->addr)) len = sizeof(dest->addr);
+        memcpy(&dest->addr, addr, len);
+        dest->addr_len = len;
+        return dests_count++;
+}
+
+static int get_local_port(int fd) {
+        struct sockaddr_storage local;
+        socklen_t len = sizeof(local);
+        if (my_getsockname(fd, (struct sockaddr *)&local, &len)) return -1;
+        if (local.ss_family == AF_INET)
+                return ntohs(((struct sockaddr_in *)&local)->sin_port);
+        if (local.ss_family == AF_INET6)
+                return ntohs(((struct sockaddr_in6 *)&local)->sin6_port);
+        return -1;
+}
+
+static long time_wait_at(const PortDest *dest, unsigned long sec) {
+        long count = 0;
+        for (int i = 0; i < PORTS_TIME_WAIT_SEC; i++)
+                if (sec - dest->tw_secs[i] < PORTS_TIME_WAIT_SEC)
+                        count += dest->tw_closes[i];
+        return count;
+}
+
+static void check_pressure(PortDest *dest, unsigned long sec) {
+        long time_wait = time_wait_at(dest, sec);
+        if (time_wait > dest->time_wait_peak) dest->time_wait_peak = time_wait;
+        long pressure = dest->open + time_wait;
+        if (pressure > dest->pressure_peak) dest->pressure_peak = pressure;
+
+        long range = range_high - range_low + 1;
+        if (dest->warned || pressure * 100 < range * PORTS_WARN_PERCENT)
+                return;
+        dest->warned = true;
+        char *addr_str = alloc_addr_str((const struct sockaddr *)&dest->addr);
+        LOG(WARN,
+            "%ld connections open or in TIME_WAIT to %s, out of %ld "
+            "ephemeral ports: connect() may soon fail with EADDRNOTAVAIL.",
+            pressure, addr_str ? addr_str : "?", range);
+        free(addr_str);
+}
+
+static void add_active_close(PortDest *dest) {
+        unsigned long sec = get_time_micros() / 1000000;
+        int i = sec % PORTS_TIME_WAIT_SEC;
+        if (dest->tw_secs[i] != sec) {
+                dest->tw_secs[i] = sec;
+                dest->tw_closes[i] = 0;
+        }
+        dest->tw_closes[i]++;
+        dest->active_closes++;
+        check_pressure(dest, sec);
+}
+
+// A connection reset by SO_LINGER with a zero timeout skips TIME_WAIT.
+static bool aborts_on_close(int fd) {
+        struct linger linger;
+        socklen_t len = sizeof(linger);
+        if (!get_sockopt_if_supported(fd, SOL_SOCKET, SO_LINGER, &linger,
+                                      &len))
+                return false;
+        return linger.l_onoff && !linger.l_linger;
+}
+
+static void account_close_order(SockPort *sp, int fd, bool closing) {
+        if (sp->close_known) return;
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+        if (!get_sockopt_if_supported(fd, IPPROTO_TCP, TCP_INFO, &info, &len))
+                return;
+        PortDest *dest = &dests[sp->dest];
+        switch (info.tcpi_state) {
+                case TCP_ESTABLISHED:
+                case TCP_SYN_RECV:
+                case TCP_FIN_WAIT1:
+                case TCP_FIN_WAIT2:
+                        sp->close_known = true;
+                        if (!closing || !aborts_on_close(fd))
+                                add_active_close(dest);
+                        break;
+                case TCP_CLOSE_WAIT:
+                case TCP_LAST_ACK:
+                        sp->close_known = true;
+                        dest->passive_closes++;
+                        break;
+                default:  // Not connected, or reset.
+                        break;
+        }
+}
+
+static char *alloc_dest_line(int i, void *arg) {
+        UNUSED(arg);
+        return alloc_port_dest_json(&dests[i]);
+}
+
+/* Public functions */
+
+void ports_init(SockPort *sp) { sp->dest = -1; }
+
+void ports_on_connect(SockPort *sp, int fd, const struct sockaddr *addr,
+                      socklen_t len, bool bound) {
+        if (sp->dest != -1) return;  // Connected already.
+        int port = get_local_port(fd);
+        if (port <= 0) return;
+
+        mutex_lock(&ports_mutex);
+        read_port_range();
+        int i = get_dest(addr, len);
+        if (i == -1) {
+                dests_dropped++;
+                goto exit;
+        }
+        PortDest *dest = &dests[i];
+        if (!dest->ports_seen)
+                dest->ports_seen =
+                    (unsigned char *)my_calloc(PORTS_BITMAP_SIZE);
+        if (!dest->ports_seen) goto exit;
+
+        sp->dest = i;
+        dest->connects++;
+        dest->open++;
+        if (!bound) dest->implicit_binds++;
+        unsigned char bit = 1 << (port % 8);
+        if (dest->ports_seen[port / 8] & bit) {
+                dest->reuses++;
+        } else {
+                dest->ports_seen[port / 8] |= bit;
+                dest->distinct_ports++;
+        }
+        check_pressure(dest, get_time_micros() / 1000000);
+exit:
+        mutex_unlock(&ports_mutex);
+}
+
+void ports_on_shutdown(SockPort *sp, int fd) {
+        if (sp->dest == -1) return;
+        mutex_lock(&ports_mutex);
+        account_close_order(sp, fd, false);
+        mutex_unlock(&ports_mutex);
+}
+
+void ports_on_close(SockPort *sp, int fd) {
+        if (sp->dest == -1) return;
+        mutex_lock(&ports_mutex);
+        account_close_order(sp, fd, true);
+        dests[sp->dest].open--;
+        sp->dest = -1;
+        mutex_unlock(&ports_mutex);
+}
+
+void dump_all_ports(void) {
+        if (!logs_dir_path) return;
+        mutex_lock(&ports_mutex);
+        if (!dests_count) goto exit;
+
+        LOG_FUNC_INFO;
+        if (dests_dropped)
+                LOG(WARN, "%ld connects to untracked destinations.",
+                    dests_dropped);
+        if (!write_json_lines("ports.json", false, dests_count, alloc_dest_line, NULL))
+                goto error;
+        goto exit;
+error:
+        LOG(ERROR, "Could not write ports usage.");
+        LOG_FUNC_ERROR;
+exit:
+        mutex_unlock(&ports_mutex);
+}
+
+void ports_reset(void) {
+        mutex_init(&ports_mutex);
+        for (int i = 0; i < dests_count; i++) free(dests[i].ports_seen);
+        dests_count = 0;
+        dests_dropped = 0;
+}
+
+void ports_get_range(int *low, int *high) {
+        *low = range_low;
+        *high = range_high;
+}
+
+long ports_time_wait(const PortDest *dest) {
+        return time_wait_at(dest, get_time_micros() / 1000000);
+}
@@ -0,0 +1,69 @@
+#ifndef LOCAL_PORTS_H
+#define LOCAL_PORTS_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+/* Ephemeral port usage of the process. Clients that open and close many
+ * connections to the same destination may run out of local ports: the kernel
+ * needs a unique (local port, destination) pair per connection, and the pair
+ * stays in TIME_WAIT for 60 seconds after the side that closed first.
+ *
+ * tcpsnitch records the local port of each connect(), read with getsockname()
+ * when the kernel bound it implicitly, and which side closed first, from the
+ * TCP state at shutdown() or close(). The TIME_WAIT sockets left by the process
+ * are estimated from its closes of the last 60 seconds. Per destination, the
+ * connections open plus those in TIME_WAIT are compared with the size of
+ * ip_local_port_range, and a warning is logged when they get close to it. */
+
+#define PORTS_DESTS_MAX 64    // Destinations tracked per process.
+#define PORTS_TIME_WAIT_SEC 60  // TCP_TIMEWAIT_LEN on Linux.
+#define PORTS_WARN_PERCENT 80  // Pressure warning threshold.
+
+typedef struct {
+        struct sockaddr_storage addr;
+        socklen_t addr_len;
+        long connects;
+        long implicit_binds;  // Local port chosen by the kernel.
+        long distinct_ports;
+        long reuses;  // Connects from a port already used to this destination.
+        long open;    // Connections not closed yet.
+        long active_closes;   // Closed first by the process: TIME_WAIT here.
+        long passive_closes;  // Closed first by the peer.
+        long time_wait_peak;
+        long pressure_peak;  // Max of open + TIME_WAIT connections.
+        bool warned;
+        // Active closes per second, over the last PORTS_TIME_WAIT_SEC seconds.
+        unsigned int tw_closes[PORTS_TIME_WAIT_SEC];
+        unsigned long tw_secs[PORTS_TIME_WAIT_SEC];
+        unsigned char *ports_seen;  // Bitmap of the local ports used.
+} PortDest;
+
+// Per socket state.
+typedef struct {
+        int dest;  // Index of the destination, -1 if not tracked.
+        bool close_known;  // The side which closed first is accounted.
+} SockPort;
+
+void ports_init(SockPort *sp);
+
+// A connect() succeeded or is in progress on the TCP socket fd.
+void ports_on_connect(SockPort *sp, int fd, const struct sockaddr *addr,
+                      socklen_t len, bool bound);
+
+// shutdown() with SHUT_WR or SHUT_RDWR: accounts for the side which closed
+// first.
+void ports_on_shutdown(SockPort *sp, int fd);
+
+// Called by close() before closing fd.
+void ports_on_close(SockPort *sp, int fd);
+
+void dump_all_ports(void);  // Written to ports.json.
+
+void ports_reset(void);  // Free state (called after fork()).
+
+// For the JSON builder.
+void ports_get_range(int *low, int *high);
+long ports_time_wait(const PortDest *dest);  // Estimated TIME_WAIT sockets.
+
+#endif
@@ -0,0 +1,100 @@
+#define _GNU_SOURCE
+
+#include "nagle_advisor.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/* Private functions */
+
+static int mss(const NagleAdvisor *na) {
+        return na->snd_mss > 0 ? na->snd_mss : DEFAULT_SND_MSS;
+}
+
+static void end_write_burst(NagleAdvisor *na) {
+        if (na->burst_writes >= 2) {
+                na->write_bursts++;
+                na->writev_candidates++;
+                if (na->burst_small_writes == na->burst_writes)
+                        na->small_write_bursts++;
+                // Minimum number of calls to write the burst with full MSS.
+                long needed = (na->burst_bytes + mss(na) - 1) / mss(na);
+                if (needed < 1) needed = 1;
+                if (na->burst_writes > needed)
+                        na->wasted_write_syscalls += na->burst_writes - needed;
+        }
+        na->burst_writes = 0;
+        na->burst_small_writes = 0;
+        na->burst_bytes = 0;
+        na->burst_last_small_uncorked = false;
+}
+
+static void end_tiny_reads_run(NagleAdvisor *na) {
+        if (na->tiny_reads_run >= 2)
+                na->wasted_read_syscalls += na->tiny_reads_run - 1;
+        na->tiny_reads_run = 0;
+}
+
+/* Public functions */
+
+void nagle_on_setsockopt(NagleAdvisor *na, int level, int optname,
+                         const void *optval, size_t optlen) {
+        if (level != IPPROTO_TCP || optlen < sizeof(int)) return;
+        int val = *(const int *)optval;
+        if (optname == TCP_NODELAY) na->nodelay = val;
+#ifdef TCP_CORK
+        if (optname == TCP_CORK) {
+                na->cork = val;
+                if (val) na->cork_used = true;
+        }
+#endif
+}
+
+void nagle_on_write(NagleAdvisor *na, long bytes, int flags,
+                    unsigned long time_usec) {
+        if (bytes <= 0) return;
+        end_tiny_reads_run(na);
+        if (na->burst_writes &&
+            time_usec - na->last_write_usec > NAGLE_BURST_GAP_USEC)
+                end_write_burst(na);
+
+        bool small = bytes < mss(na);
+        bool more = flags & MSG_MORE;
+        na->writes++;
+        if (small) na->small_writes++;
+        if (more) na->msg_more_writes++;
+        if (na->cork) na->corked_writes++;
+
+        na->burst_writes++;
+        if (small) na->burst_small_writes++;
+        na->burst_bytes += bytes;
+        na->burst_last_small_uncorked = small && !more && !na->cork;
+        na->last_write_usec = time_usec;
+}
+
+void nagle_on_read(NagleAdvisor *na, size_t requested, long bytes,
+                   unsigned long time_usec) {
+        if (bytes <= 0) return;
+        if (na->burst_writes >= 2 && na->burst_last_small_uncorked &&
+            !na->nodelay &&
+            time_usec - na->last_write_usec <= NAGLE_BURST_GAP_USEC)
+                na->write_write_read++;
+        end_write_burst(na);
+
+        na->reads++;
+        if (requested < TINY_READ_BYTES) {
+                na->tiny_reads++;
+                na->tiny_reads_run++;
+        } else {
+                end_tiny_reads_run(na);
+        }
+}
+
+void nagle_flush(NagleAdvisor *na) {
+        end_write_burst(na);
+        end_tiny_reads_run(na);
+}
+
+long nagle_wasted_syscalls(const NagleAdvisor *na) {
+        return na->wasted_write_syscalls + na->wasted_read_syscalls;
+}
@@ -0,0 +1,62 @@
+#ifndef NAGLE_ADVISOR_H
+#define NAGLE_ADVISOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Online detection of write/read patterns that interact badly with Nagle's
+ * algorithm and delayed ACKs on a TCP connection:
+ *   - write-write-read: several small writes followed by a read while
+ *     TCP_NODELAY is off. The last write is held by Nagle until the first one
+ *     is ACKed, and the peer delays this ACK.
+ *   - bursts of writes (no read in between, less than NAGLE_BURST_GAP_USEC
+ *     apart) that could have been a single writev() or buffered write.
+ *   - reads with a buffer smaller than TINY_READ_BYTES.
+ * Wasted syscalls are estimated as the number of extra calls compared to
+ * writing the burst in MSS-sized chunks, and to merging runs of tiny reads.*/
+
+#define NAGLE_BURST_GAP_USEC 40000  // Typical delayed ACK timeout.
+#define TINY_READ_BYTES 256
+#define DEFAULT_SND_MSS 536
+
+typedef struct {
+        // Socket configuration
+        bool nodelay;    // TCP_NODELAY currently set.
+        bool cork;       // TCP_CORK currently set.
+        bool cork_used;  // TCP_CORK was set at some point.
+        int snd_mss;     // From tcp_info, 0 if unknown yet, -1 if unavailable.
+        // Counters
+        long writes;
+        long small_writes;  // Writes smaller than snd_mss.
+        long msg_more_writes;
+        long corked_writes;
+        long write_bursts;        // Bursts of at least 2 writes.
+        long small_write_bursts;  // Bursts made only of small writes.
+        long writev_candidates;   // Bursts that could have been 1 writev().
+        long write_write_read;
+        long reads;
+        long tiny_reads;
+        long wasted_write_syscalls;
+        long wasted_read_syscalls;
+        // State of the burst in progress
+        unsigned long last_write_usec;
+        long burst_writes;
+        long burst_small_writes;
+        unsigned long burst_bytes;
+        bool burst_last_small_uncorked;
+        long tiny_reads_run;
+} NagleAdvisor;
+
+void nagle_on_setsockopt(NagleAdvisor *na, int level, int optname,
+                         const void *optval, size_t optlen);
+void nagle_on_write(NagleAdvisor *na, long bytes, int flags,
+                    unsigned long time_usec);
+void nagle_on_read(NagleAdvisor *na, size_t requested, long bytes,
+                   unsigned long time_usec);
+
+// Account for the burst in progress, as if the connection ended now.
+void nagle_flush(NagleAdvisor *na);
+
+long nagle_wasted_syscalls(const NagleAdvisor *na);
+
+#endif
@@ -0,0 +1,289 @@
+#define _GNU_SOURCE
+
+#include "name_resolution.h"
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+/* We remember the last RESOLVED_ADDRS_SIZE addresses returned by the resolver
+ * in a circular buffer. A connect() to one of these addresses is linked to the
+ * resolution that produced it. */
+#define RESOLVED_ADDRS_SIZE 256
+
+typedef struct {
+        struct sockaddr_storage addr;
+        long query_id;
+        unsigned long resolved_usec;
+        unsigned long duration_usec;
+} ResolvedAddr;
+
+static pthread_mutex_t dns_mutex = MUTEX_ERRORCHECK;
+static DnsEventNode *head = NULL;
+static DnsEventNode *tail = NULL;
+static long events_count = 0;
+static ResolvedAddr resolved_addrs[RESOLVED_ADDRS_SIZE];
+static int resolved_addrs_next = 0;
+static int resolved_addrs_count = 0;
+
+/* Private functions */
+
+static char *alloc_str_copy(const char *str) {
+        if (!str) return NULL;
+        int n = strlen(str) + 1;
+        char *copy = (char *)my_malloc(sizeof(char) * n);
+        strncpy(copy, str, n);
+        return copy;
+}
+
+static DnsEvent *alloc_dns_event(DnsEventType type, int ret, bool success,
+                                 int err, unsigned long start_usec) {
+        DnsEvent *ev = (DnsEvent *)my_calloc(sizeof(DnsEvent));
+        unsigned long now = get_time_micros();
+        ev->type = type;
+        ev->timestamp_usec = start_usec;
+        ev->duration_usec = (now > start_usec) ? now - start_usec : 0;
+        ev->return_value = ret;
+        ev->success = success;
+        ev->err = err;
+        ev->thread_id = syscall(SYS_gettid);
+        return ev;
+}
+
+static void free_dns_event(DnsEvent *ev) {
+        free(ev->node);
+        free(ev->service);
+        free(ev);
+}
+
+static void free_dns_events(DnsEventNode *cur) {
+        DnsEventNode *tmp;
+        while (cur != NULL) {
+                free_dns_event(cur->data);
+                tmp = cur;
+                cur = cur->next;
+                free(tmp);
+        }
+}
+
+static bool same_ip(const struct sockaddr *a1, const struct sockaddr *a2) {
+        if (a1->sa_family != a2->sa_family) return false;
+        if (a1->sa_family == AF_INET) {
+                const struct sockaddr_in *v4_1 = (const struct sockaddr_in *)a1;
+                const struct sockaddr_in *v4_2 = (const struct sockaddr_in *)a2;
+                return v4_1->sin_addr.s_addr == v4_2->sin_addr.s_addr;
+        }
+        if (a1->sa_family == AF_INET6) {
+                const struct sockaddr_in6 *v6_1 =
+                    (const struct sockaddr_in6 *)a1;
+                const struct sockaddr_in6 *v6_2 =
+                    (const struct sockaddr_in6 *)a2;
+                return !memcmp(&v6_1->sin6_addr, &v6_2->sin6_addr,
+                               sizeof(struct in6_addr));
+        }
+        return false;
+}
+
+// getaddrinfo() returns an entry per socket type of each address: an address
+// is only counted and kept once.
+static void add_resolved_addr(DnsEvent *ev, const struct sockaddr *addr,
+                              socklen_t len) {
+        for (int i = 0; i < ev->addrs_count; i++)
+                if (same_ip((const struct sockaddr *)&ev->addrs[i], addr))
+                        return;
+        ev->results_count++;
+        if (addr->sa_family == AF_INET)
+                ev->ipv4_count++;
+        else if (addr->sa_family == AF_INET6)
+                ev->ipv6_count++;
+        if (ev->addrs_count < DNS_MAX_ADDRS &&
+            len <= sizeof(struct sockaddr_storage))
+                memcpy(&ev->addrs[ev->addrs_count++], addr, len);
+}
+
+static void add_hostent_addrs(DnsEvent *ev, const struct hostent *h) {
+        for (char **p = h->h_addr_list; p && *p; p++) {
+                struct sockaddr_storage sto;
+                memset(&sto, 0, sizeof(sto));
+                if (h->h_addrtype == AF_INET) {
+                        struct sockaddr_in *v4 = (struct sockaddr_in *)&sto;
+                        v4->sin_family = AF_INET;
+                        memcpy(&v4->sin_addr, *p, sizeof(v4->sin_addr));
+                        add_resolved_addr(ev, (struct sockaddr *)v4,
+                                          sizeof(*v4));
+                } else if (h->h_addrtype == AF_INET6) {
+                        struct sockaddr_in6 *v6 = (struct sockaddr_in6 *)&sto;
+                        v6->sin6_family = AF_INET6;
+                        memcpy(&v6->sin6_addr, *p, sizeof(v6->sin6_addr));
+                        add_resolved_addr(ev, (struct sockaddr *)v6,
+                                          sizeof(*v6));
+                }
+        }
+}
+
+// Must be called with dns_mutex held.
+static void remember_resolved_addrs(const DnsEvent *ev) {
+        unsigned long resolved_usec = ev->timestamp_usec + ev->duration_usec;
+        for (int i = 0; i < ev->addrs_count; i++) {
+                ResolvedAddr *ra = &resolved_addrs[resolved_addrs_next];
+                memcpy(&ra->addr, &ev->addrs[i], sizeof(ra->addr));
+                ra->query_id = ev->id;
+                ra->resolved_usec = resolved_usec;
+                ra->duration_usec = ev->duration_usec;
+                resolved_addrs_next =
+                    (resolved_addrs_next + 1) % RESOLVED_ADDRS_SIZE;
+                if (resolved_addrs_count < RESOLVED_ADDRS_SIZE)
+                        resolved_addrs_count++;
+        }
+}
+
+static void push_dns_event(DnsEvent *ev) {
+        DnsEventNode *node = (DnsEventNode *)my_malloc(sizeof(DnsEventNode));
+        node->data = ev;
+        node->next = NULL;
+
+        mutex_lock(&dns_mutex);
+        ev->id = events_count++;
+        if (!head)
+                head = node;
+        else
+                tail->next = node;
+        tail = node;
+        // Only forward lookups resolve the addresses of later connections: the
+        // address of getnameinfo() is its input.
+        if (ev->success && ev->type != DNS_EV_GETNAMEINFO)
+                remember_resolved_addrs(ev);
+        mutex_unlock(&dns_mutex);
+
+        LOG(INFO, "%s() for %s took %lu usec.",
+            string_from_dns_event_type(ev->type),
+            ev->node ? ev->node : "(null)", ev->duration_usec);
+}
+
+// The lines are the events of a list, arg points to the next one.
+static char *alloc_event_line(int i, void *arg) {
+        UNUSED(i);
+        DnsEventNode **line = (DnsEventNode **)arg;
+        char *json_str = alloc_dns_ev_json((*line)->data);
+        *line = (*line)->next;
+        return json_str;
+}
+
+/* Public functions */
+
+const char *string_from_dns_event_type(DnsEventType type) {
+        static const char *strings[] = {"getaddrinfo",     "getnameinfo",
+                                        "gethostbyname",   "gethostbyname2",
+                                        "gethostbyname_r", "gethostbyname2_r"};
+        assert(sizeof(strings) / sizeof(char *) == DNS_EV_GETHOSTBYNAME2_R + 1);
+        return strings[type];
+}
+
+void dns_ev_getaddrinfo(int ret, const char *node, const char *service,
+                        const struct addrinfo *res, unsigned long start_usec) {
+        init_tcpsnitch();
+        DnsEvent *ev = alloc_dns_event(DNS_EV_GETADDRINFO, ret, ret == 0, ret,
+                                       start_usec);
+        ev->node = alloc_str_copy(node);
+        ev->service = alloc_str_copy(service);
+        if (ret == 0) {
+                for (const struct addrinfo *ai = res; ai; ai = ai->ai_next)
+                        if (ai->ai_addr)
+                                add_resolved_addr(ev, ai->ai_addr,
+                                                  ai->ai_addrlen);
+        }
+        push_dns_event(ev);
+}
+
+void dns_ev_getnameinfo(int ret, const struct sockaddr *addr, socklen_t len,
+                        const char *host, const char *serv,
+                        unsigned long start_usec) {
+        init_tcpsnitch();
+        DnsEvent *ev = alloc_dns_event(DNS_EV_GETNAMEINFO, ret, ret == 0, ret,
+                                       start_usec);
+        if (ret == 0) {
+                ev->node = alloc_str_copy(host);
+                ev->service = alloc_str_copy(serv);
+        }
+        if (addr && len <= sizeof(struct sockaddr_storage)) {
+                memcpy(&ev->addrs[0], addr, len);
+                ev->addrs_count = 1;
+        }
+        push_dns_event(ev);
+}
+
+void dns_ev_gethostbyname(DnsEventType type, const char *name,
+                          const struct hostent *ret, int err,
+                          unsigned long start_usec) {
+        init_tcpsnitch();
+        DnsEvent *ev =
+            alloc_dns_event(type, ret != NULL, ret != NULL, err, start_usec);
+        ev->node = alloc_str_copy(name);
+        if (ret) add_hostent_addrs(ev, ret);
+        push_dns_event(ev);
+}
+
+bool dns_link_addr(const struct sockaddr *addr, DnsLink *link) {
+        link->found = false;
+        if (!addr) return false;
+        if (addr->sa_family != AF_INET && addr->sa_family != AF_INET6)
+                return false;
+
+        mutex_lock(&dns_mutex);
+        // Walk backwards so that the most recent resolution wins.
+        for (int i = 1; i <= resolved_addrs_count; i++) {
+                int idx = (resolved_addrs_next - i + RESOLVED_ADDRS_SIZE) %
+                          RESOLVED_ADDRS_SIZE;
+                ResolvedAddr *ra = &resolved_addrs[idx];
+                if (same_ip((struct sockaddr *)&ra->addr, addr)) {
+                        link->found = true;
+                        link->query_id = ra->query_id;
+                        link->resolved_usec = ra->resolved_usec;
+                        link->duration_usec = ra->duration_usec;
+                        break;
+                }
+        }
+        mutex_unlock(&dns_mutex);
+        return link->found;
+}
+
+void dump_all_dns_events(void) {
+        if (!logs_dir_path) return;
+        mutex_lock(&dns_mutex);
+        DnsEventNode *cur = head;
+        head = NULL;
+        tail = NULL;
+        mutex_unlock(&dns_mutex);
+        if (!cur) return;
+
+        LOG_FUNC_INFO;
+        int count = 0;
+        for (const DnsEventNode *n = cur; n; n = n->next) count++;
+        DnsEventNode *line = cur;
+        if (!write_json_lines("dns.json", true, count, alloc_event_line,
+                              &line)) {
+                LOG(ERROR, "Could not write DNS events.");
+                LOG_FUNC_ERROR;
+        }
+        free_dns_events(cur);
+}
+
+void dns_reset(void) {
+        mutex_init(&dns_mutex);
+        free_dns_events(head);
+        head = NULL;
+        tail = NULL;
+        events_count = 0;
+        resolved_addrs_next = 0;
+        resolved_addrs_count = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef NAME_RESOLUTION_H
+#define NAME_RESOLUTION_H
+
+#include <netdb.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+typedef enum DnsEventType {
+        DNS_EV_GETADDRINFO,
+        DNS_EV_GETNAMEINFO,
+        DNS_EV_GETHOSTBYNAME,
+        DNS_EV_GETHOSTBYNAME2,
+        DNS_EV_GETHOSTBYNAME_R,
+        DNS_EV_GETHOSTBYNAME2_R
+} DnsEventType;
+
+#define DNS_MAX_ADDRS 8  // Max number of resolved addresses kept per event.
+
+typedef struct {
+        DnsEventType type;
+        long id;
+        unsigned long timestamp_usec;  // Time at which the call started.
+        unsigned long duration_usec;
+        int return_value;
+        bool success;
+        int err;  // EAI_* code for getaddrinfo/getnameinfo, h_errno otherwise.
+        pid_t thread_id;
+        char *node;     // Name to resolve, or resolved name for getnameinfo().
+        char *service;  // Service, if any.
+        int results_count;  // Distinct addresses.
+        int ipv4_count;
+        int ipv6_count;
+        int addrs_count;
+        struct sockaddr_storage addrs[DNS_MAX_ADDRS];
+} DnsEvent;
+
+/* Link between a connect() and the name resolution that produced the address
+ * the socket connects to. */
+typedef struct {
+        bool found;
+        long query_id;
+        unsigned long resolved_usec;  // Time at which the resolution returned.
+        unsigned long duration_usec;  // Duration of the resolution.
+} DnsLink;
+
+typedef struct DnsEventNode DnsEventNode;
+struct DnsEventNode {
+        DnsEvent *data;
+        DnsEventNode *next;
+};
+
+const char *string_from_dns_event_type(DnsEventType type);
+
+// Events hooks
+
+void dns_ev_getaddrinfo(int ret, const char *node, const char *service,
+                        const struct addrinfo *res, unsigned long start_usec);
+
+void dns_ev_getnameinfo(int ret, const struct sockaddr *addr, socklen_t len,
+                        const char *host, const char *serv,
+                        unsigned long start_usec);
+
+void dns_ev_gethostbyname(DnsEventType type, const char *name,
+                          const struct hostent *ret, int err,
+                          unsigned long start_usec);
+
+// Returns true and fills link if addr was returned by a recent resolution.
+bool dns_link_addr(const struct sockaddr *addr, DnsLink *link);
+
+void dump_all_dns_events(void);
+
+void dns_reset(void);  // Free state (called after fork()).
+
+#endif
@@ -0,0 +1,85 @@
+#define _GNU_SOURCE
+
+#include "numa_nodes.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+
+#define NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+
+static bool read_done = false;
+static int nodes_count = 1;
+static cpu_set_t node_cpus[NUMA_MAX_NODES];
+static unsigned char cpu_nodes[CPU_SETSIZE];  // Node index per CPU.
+
+/* Private functions */
+
+// Parses a cpulist such as "0-3,8-11".
+static bool parse_cpulist(const char *list, cpu_set_t *set) {
+        CPU_ZERO(set);
+        const char *cur = list;
+        while (*cur && *cur != '\n') {
+                char *end;
+                long first = strtol(cur, &end, 10);
+                if (end == cur) return false;
+                long last = first;
+                if (*end == '-') {
+                        cur = end + 1;
+                        last = strtol(cur, &end, 10);
+                        if (end == cur) return false;
+                }
+                for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+                        if (cpu >= 0) CPU_SET(cpu, set);
+                cur = *end == ',' ? end + 1 : end;
+        }
+        return CPU_COUNT(set) > 0;
+}
+
+static bool read_node(int node_id, cpu_set_t *set) {
+        char path[64];
+        snprintf(path, sizeof(path), NODE_CPULIST, node_id);
+        FILE *fp = fopen(path, "r");
+        if (!fp) return false;
+        char list[1024];
+        bool ok = fgets(list, sizeof(list), fp) && parse_cpulist(list, set);
+        fclose(fp);
+        return ok;
+}
+
+/* Public functions */
+
+void numa_init(void) {
+        if (read_done) return;
+        read_done = true;
+        int count = 0;
+        // Node ids may have holes, e.g. with memory-only nodes.
+        for (int id = 0; id < NUMA_MAX_NODES; id++) {
+                if (!read_node(id, &node_cpus[count])) continue;
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                        if (CPU_ISSET(cpu, &node_cpus[count]))
+                                cpu_nodes[cpu] = count;
+                count++;
+        }
+        nodes_count = count ? count : 1;
+        if (nodes_count > 1) LOG(INFO, "%d NUMA nodes.", nodes_count);
+}
+
+int numa_nodes_count(void) { return nodes_count; }
+
+int numa_node_of_cpu(int cpu) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return 0;
+        return cpu_nodes[cpu];
+}
+
+bool numa_pin_thread(int node) {
+        if (nodes_count < 2 || node < 0 || node >= nodes_count) return false;
+        // 0 is the calling thread.
+        if (sched_setaffinity(0, sizeof(cpu_set_t), &node_cpus[node])) {
+                LOG(WARN, "sched_setaffinity() failed. %s.", strerror(errno));
+                return false;
+        }
+        return true;
+}
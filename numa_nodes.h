@@ -0,0 +1,27 @@
+#ifndef NUMA_NODES_H
+#define NUMA_NODES_H
+
+#include <stdbool.h>
+
+/* NUMA topology of the machine, read once from /sys/devices/system/node, so
+ * that the JSON dumper threads (-t) work on memory of their own node: one
+ * dumper runs per node, pinned to the CPUs of that node, and only dumps the
+ * sockets whose last event was processed on that node. The events themselves
+ * are allocated and first written by the thread making the call, hence on its
+ * node. Without NUMA information (single node, no sysfs), there is a single
+ * node 0 covering all the CPUs, and the dumper is not pinned. */
+
+#define NUMA_MAX_NODES 64
+
+void numa_init(void);
+
+int numa_nodes_count(void);  // At least 1.
+
+// Index of the node of a CPU, in [0, numa_nodes_count()). 0 if unknown.
+int numa_node_of_cpu(int cpu);
+
+// Pins the calling thread to the CPUs of a node. Returns false if not pinned,
+// e.g. on a single node machine.
+bool numa_pin_thread(int node);
+
+#endif
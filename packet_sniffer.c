@@ -18,11 +18,11 @@
 typedef struct {
         pcap_t *handle;
         pcap_dumper_t *dump;
-        bool *switch_flag;
+        CaptureSwitch *capture_switch;
 } CaptureThreadArgs;
 
 typedef struct {
-        bool *switch_flag;
+        CaptureSwitch *capture_switch;
         int delay_ms;
 } DelayStopThreadArgs;
 
@@ -45,24 +45,29 @@ error:
         return NULL;
 }
 
-/* This thread captures packets indefinitely until the boolean pointed by
-   switch_flag is turned to false. */
+/* This thread captures packets indefinitely until the capture switch is turned
+   off. */
 static void *capture_thread(void *params) {
         LOG_FUNC_INFO;
         CaptureThreadArgs *args = (CaptureThreadArgs *)params;
 
-        bool *switch_flag = args->switch_flag;
-        while (*switch_flag) {
+        CaptureSwitch *capture_switch = args->capture_switch;
+        while (capture_switch->on) {
                 if (pcap_dispatch(args->handle, -1, &pcap_dump,
                                   (u_char *)args->dump) == -1) {
                         LOG(ERROR, "pcap_dispatch() failed. %s.",
                             pcap_geterr(args->handle));
                 }
+                if (capture_switch->flush) {
+                        capture_switch->flush = false;
+                        if (pcap_dump_flush(args->dump))
+                                LOG(WARN, "pcap_dump_flush() failed.");
+                }
         }
 
         pcap_close(args->handle);
         pcap_dump_close(args->dump);
-        free(switch_flag);
+        free(capture_switch);
         free(args);
         LOG(INFO, "Capture thread ended.");
         return NULL;
@@ -76,7 +81,7 @@ static void *delayed_stop_thread(void *params) {
         DelayStopThreadArgs *args = (DelayStopThreadArgs *)params;
         struct timespec ns = {0, args->delay_ms * 1000000};
         nanosleep(&ns, NULL);
-        *(args->switch_flag) = false;
+        args->capture_switch->on = false;
         LOG(INFO, "Turned off capture switch.");
         return NULL;
 }
@@ -130,7 +135,7 @@ error_out:
         return NULL;
 }
 
-bool *start_capture(const char *filter_str, const char *path) {
+CaptureSwitch *start_capture(const char *filter_str, const char *path) {
         LOG_FUNC_INFO;
         // Get handle
         pcap_t *handle = get_capture_handle();
@@ -165,24 +170,25 @@ bool *start_capture(const char *filter_str, const char *path) {
                 goto error1;
         }
 
-        // Alloc flag for controlling capture end. This flag can be turned off
-        // at any time by called thread to end the capture.
-        bool *switch_flag = my_malloc(sizeof(bool));
-        (*switch_flag) = true;
+        // Alloc switch for controlling capture end. This switch can be turned
+        // off at any time by called thread to end the capture.
+        CaptureSwitch *capture_switch = my_malloc(sizeof(CaptureSwitch));
+        capture_switch->on = true;
+        capture_switch->flush = false;
 
         // Start capture in another thread.
         CaptureThreadArgs *args =
             (CaptureThreadArgs *)my_malloc(sizeof(CaptureThreadArgs));
         args->handle = handle;
         args->dump = dump;
-        args->switch_flag = switch_flag;
+        args->capture_switch = capture_switch;
 
         pthread_t thread;
         if (my_pthread_create(&thread, NULL, capture_thread, args)) goto error4;
-        return switch_flag;
+        return capture_switch;
 error4:
         free(args);
-        free(switch_flag);
+        free(capture_switch);
         pcap_dump_close(dump);
 error1:
         pcap_close(handle);
@@ -191,18 +197,18 @@ error_out:
         return NULL;
 }
 
-int stop_capture(bool *switch_flag, int delay_ms) {
+int stop_capture(CaptureSwitch *capture_switch, int delay_ms) {
         LOG_FUNC_INFO;
         // Prepare args for thread
         DelayStopThreadArgs *args =
             (DelayStopThreadArgs *)my_malloc(sizeof(DelayStopThreadArgs));
-        args->switch_flag = switch_flag;
+        args->capture_switch = capture_switch;
         args->delay_ms = delay_ms;
 
         // Start thread
         pthread_t thread;
         if (my_pthread_create(&thread, NULL, delayed_stop_thread, args)) {
-                *(switch_flag) = false;
+                capture_switch->on = false;
                 goto error;
         }
         return 0;
@@ -211,3 +217,8 @@ error:
         LOG_FUNC_ERROR;
         return -1;
 }
+
+// The packets are written to file when the capture thread next wakes up.
+void flush_capture(CaptureSwitch *capture_switch) {
+        capture_switch->flush = true;
+}
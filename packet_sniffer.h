@@ -9,7 +9,14 @@
 char *alloc_capture_filter(const struct sockaddr *addr1,
                            const struct sockaddr *addr2);
 
-bool *start_capture(const char *filters, const char *path);
-int stop_capture(bool *switch_flag, int delay_ms);
+// Shared with the capture thread, which frees it at the end of the capture.
+typedef struct {
+        bool on;     // Turned off to end the capture.
+        bool flush;  // Set to write the captured packets to file.
+} CaptureSwitch;
+
+CaptureSwitch *start_capture(const char *filters, const char *path);
+int stop_capture(CaptureSwitch *capture_switch, int delay_ms);
+void flush_capture(CaptureSwitch *capture_switch);
 
 #endif
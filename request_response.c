@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+
+#include "request_response.h"
+
+/* Private functions */
+
+static bool idle_gap_elapsed(const ReqResp *rr, unsigned long time_usec,
+                             unsigned long idle_gap_usec) {
+        return idle_gap_usec && time_usec > rr->last_usec &&
+               time_usec - rr->last_usec > idle_gap_usec;
+}
+
+static void end_request(ReqResp *rr) {
+        histo_add(&rr->request_size, rr->cur_bytes);
+        rr->cur_bytes = 0;
+}
+
+static void end_response(ReqResp *rr) {
+        histo_add(&rr->response_size, rr->cur_bytes);
+        rr->cur_bytes = 0;
+}
+
+static void add_request_data(ReqResp *rr, unsigned long time_usec,
+                             unsigned long idle_gap_usec) {
+        switch (rr->phase) {
+                case RR_RESPONSE:
+                        end_response(rr);
+                        break;
+                case RR_REQUEST:
+                        if (!idle_gap_elapsed(rr, time_usec, idle_gap_usec))
+                                return;
+                        // Silence after the request: consider it lost.
+                        end_request(rr);
+                        rr->unanswered_requests++;
+                        break;
+                case RR_IDLE:
+                        break;
+        }
+        rr->phase = RR_REQUEST;
+}
+
+static void add_response_data(ReqResp *rr, unsigned long time_usec,
+                              unsigned long idle_gap_usec) {
+        switch (rr->phase) {
+                case RR_REQUEST:
+                        histo_add(&rr->response_time,
+                                  (time_usec > rr->last_usec)
+                                      ? time_usec - rr->last_usec
+                                      : 0);
+                        end_request(rr);
+                        rr->exchanges++;
+                        break;
+                case RR_RESPONSE:
+                        if (!idle_gap_elapsed(rr, time_usec, idle_gap_usec))
+                                return;
+                        // Silence, then more data: a new unsolicited message.
+                        end_response(rr);
+                        rr->unsolicited_responses++;
+                        break;
+                case RR_IDLE:
+                        rr->unsolicited_responses++;
+                        break;
+        }
+        rr->phase = RR_RESPONSE;
+}
+
+/* Public functions */
+
+void rr_add_data(ReqResp *rr, bool sent, long bytes, unsigned long time_usec,
+                 unsigned long idle_gap_usec) {
+        if (bytes <= 0) return;
+        bool is_request = (sent != rr->server);
+        if (is_request)
+                add_request_data(rr, time_usec, idle_gap_usec);
+        else
+                add_response_data(rr, time_usec, idle_gap_usec);
+        rr->cur_bytes += bytes;
+        rr->last_usec = time_usec;
+}
+
+void rr_flush(ReqResp *rr) {
+        switch (rr->phase) {
+                case RR_REQUEST:
+                        end_request(rr);
+                        rr->unanswered_requests++;
+                        break;
+                case RR_RESPONSE:
+                        end_response(rr);
+                        break;
+                case RR_IDLE:
+                        break;
+        }
+        rr->phase = RR_IDLE;
+}
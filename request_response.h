@@ -0,0 +1,37 @@
+#ifndef REQUEST_RESPONSE_H
+#define REQUEST_RESPONSE_H
+
+#include <stdbool.h>
+#include "histogram.h"
+
+/* Online inference of application-level request/response exchanges from the
+ * direction changes of the data flow on a socket. On a client socket, the
+ * data sent is the request and the data received is the response. This is
+ * reversed for accepted sockets.
+ *
+ * The response time is the delay between the last call that moved bytes of a
+ * request and the first call that moved bytes of its response. An optional
+ * idle gap splits consecutive messages flowing in the same direction. */
+
+typedef enum { RR_IDLE, RR_REQUEST, RR_RESPONSE } RRPhase;
+
+typedef struct {
+        bool server;  // True if requests are received (accepted socket).
+        RRPhase phase;
+        unsigned long last_usec;  // Time of last data call.
+        unsigned long cur_bytes;  // Bytes of the message in progress.
+        long exchanges;           // Number of request followed by a response.
+        long unanswered_requests;
+        long unsolicited_responses;
+        Histogram response_time;  // In micro-seconds.
+        Histogram request_size;   // In bytes.
+        Histogram response_size;  // In bytes.
+} ReqResp;
+
+void rr_add_data(ReqResp *rr, bool sent, long bytes, unsigned long time_usec,
+                 unsigned long idle_gap_usec);
+
+// Account for the message in progress, as if the connection ended now.
+void rr_flush(ReqResp *rr);
+
+#endif
@@ -9,10 +9,12 @@
 #include "logger.h"
 #include "sock_events.h"
 
+// Locked by each call on the element: each wrapper has its own cache line, so
+// that threads working on different elements do not contend for it.
 typedef struct {
-        ELEM_TYPE elem;
         pthread_mutex_t mutex;
-} ElemWrapper;
+        ELEM_TYPE elem;
+} CACHE_ALIGNED ElemWrapper;
 
 static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
 static ElemWrapper **array = NULL;
@@ -64,7 +66,7 @@ bool ra_put_elem(int index, ELEM_TYPE elem) {
         if (!array && !init(index + 1)) goto error;
         if (index > size - 1 && !double_size(index)) goto error;
 
-        ElemWrapper *ew = (ElemWrapper *)my_malloc(sizeof(ElemWrapper));
+        ElemWrapper *ew = (ElemWrapper *)my_aligned_calloc(sizeof(ElemWrapper));
         mutex_init(&ew->mutex);
         ew->elem = elem;
 
@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+
+#include "retransmissions.h"
+
+/* Private functions */
+
+static RetxSend *pending_at(Retransmissions *retx, int i) {
+        return &retx->pending[(retx->pending_head + i) % RETX_MAX_PENDING];
+}
+
+static unsigned long min_ul(unsigned long a, unsigned long b) {
+        return a < b ? a : b;
+}
+
+static unsigned long max_ul(unsigned long a, unsigned long b) {
+        return a > b ? a : b;
+}
+
+// The same bytes may be retransmitted several times (e.g. after successive
+// timeouts): a call counts each of its bytes once.
+static void attribute(Retransmissions *retx, unsigned long from,
+                      unsigned long bytes) {
+        unsigned long to = from + bytes;
+        for (int i = 0; i < retx->pending_count; i++) {
+                RetxSend *s = pending_at(retx, i);
+                unsigned long end = s->start + s->bytes;
+                if (s->start >= to) break;
+                if (end <= from) continue;
+                unsigned long overlap =
+                    min_ul(end, to) - max_ul(s->start, from);
+                long room = s->bytes - s->retrans_bytes;
+                long added = (long)overlap < room ? (long)overlap : room;
+                s->retrans_bytes += added;
+                retx->attributed_bytes += added;
+        }
+}
+
+// Returns true if the call had retransmitted bytes, and fills report.
+static bool complete(Retransmissions *retx, const RetxSend *s,
+                     unsigned long time_usec, int rtt, RetxReport *report) {
+        unsigned long ack_delay =
+            time_usec > s->call_usec ? time_usec - s->call_usec : 0;
+        if (!s->retrans_bytes) {
+                retx->clean_calls++;
+                histo_add(&retx->clean_ack_delay, ack_delay);
+                return false;
+        }
+        // Without clean calls to compare with, the RTT is the best case.
+        unsigned long baseline = histo_is_empty(&retx->clean_ack_delay)
+                                     ? (unsigned long)rtt
+                                     : histo_mean(&retx->clean_ack_delay);
+        unsigned long added = ack_delay > baseline ? ack_delay - baseline : 0;
+        retx->affected_calls++;
+        histo_add(&retx->retrans_ack_delay, ack_delay);
+        histo_add(&retx->added_delay, added);
+
+        report->send_id = s->send_id;
+        report->bytes = s->bytes;
+        report->retrans_bytes = s->retrans_bytes;
+        report->ack_delay_usec = ack_delay;
+        report->added_delay_usec = added;
+        return true;
+}
+
+/* Public functions */
+
+void retx_on_send(Retransmissions *retx, long send_id, unsigned long call_usec,
+                  long bytes) {
+        if (bytes <= 0) return;
+        unsigned long start = retx->sent;
+        retx->sent += bytes;
+        if (retx->pending_count == RETX_MAX_PENDING) {
+                retx->dropped++;
+                return;
+        }
+        RetxSend *s = pending_at(retx, retx->pending_count++);
+        s->send_id = send_id;
+        s->start = start;
+        s->bytes = bytes;
+        s->call_usec = call_usec;
+        s->retrans_bytes = 0;
+}
+
+int retx_on_snapshot(Retransmissions *retx, const struct tcp_info *info,
+                     int outq, unsigned long time_usec,
+                     RetxReport reports[RETX_MAX_PENDING]) {
+        if (outq < 0) return 0;
+        retx->snapshots++;
+        // The SYN, then the FIN, count in SIOCOUTQ until acknowledged.
+        unsigned long una =
+            retx->sent > (unsigned long)outq ? retx->sent - outq : 0;
+        if (info->tcpi_total_retrans > retx->total_retrans) {
+                unsigned int segs =
+                    info->tcpi_total_retrans - retx->total_retrans;
+                unsigned long bytes = (unsigned long)segs * info->tcpi_snd_mss;
+                retx->segments += segs;
+                retx->bytes += bytes;
+                attribute(retx, retx->snd_una,
+                          min_ul(bytes, retx->snapshot_sent - retx->snd_una));
+        }
+        retx->total_retrans = info->tcpi_total_retrans;
+        retx->snd_una = max_ul(retx->snd_una, una);
+        retx->snapshot_sent = retx->sent;
+
+        int count = 0;
+        while (retx->pending_count) {
+                RetxSend *s = pending_at(retx, 0);
+                if (s->start + s->bytes > retx->snd_una) break;
+                if (complete(retx, s, time_usec, info->tcpi_rtt,
+                             &reports[count]))
+                        count++;
+                retx->pending_head =
+                    (retx->pending_head + 1) % RETX_MAX_PENDING;
+                retx->pending_count--;
+        }
+        return count;
+}
@@ -0,0 +1,72 @@
+#ifndef RETRANSMISSIONS_H
+#define RETRANSMISSIONS_H
+
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include "histogram.h"
+
+/* Attribution of the TCP retransmissions to the send calls of the application.
+ * tcpi_total_retrans counts the segments retransmitted on the connection: when
+ * it grows between two TCP_INFO snapshots (-b or -u), about tcpi_snd_mss bytes
+ * per new segment are attributed to the oldest bytes that were not
+ * acknowledged at the previous snapshot, which is where the kernel
+ * retransmits from after a timeout or a loss detection, up to the bytes
+ * written by then: the later ones were not in flight. The acknowledged
+ * bytes are located in the byte stream of the application with SIOCOUTQ,
+ * which gives the bytes written but not acknowledged yet.
+ *
+ * A send call is complete once a snapshot sees all of its bytes acknowledged.
+ * The calls with retransmitted bytes are reported with the time from the call
+ * to that snapshot, and the delay added compared to the calls without
+ * retransmissions, measured the same way. */
+
+#define RETX_MAX_PENDING 64  // Send calls not acknowledged yet, per socket.
+
+typedef struct {
+        long send_id;         // Id of the send event.
+        unsigned long start;  // Offset of the first byte in the stream.
+        long bytes;
+        unsigned long call_usec;
+        long retrans_bytes;  // Bytes of the call in a retransmitted range.
+} RetxSend;
+
+typedef struct {
+        long send_id;
+        long bytes;
+        long retrans_bytes;
+        unsigned long ack_delay_usec;    // Call -> snapshot seeing it acked.
+        unsigned long added_delay_usec;  // Over the calls not retransmitted.
+} RetxReport;
+
+typedef struct {
+        unsigned long sent;  // Bytes written by the application.
+        RetxSend pending[RETX_MAX_PENDING];
+        int pending_head;
+        int pending_count;
+        unsigned long snd_una;        // Offset acknowledged at last snapshot.
+        unsigned long snapshot_sent;  // Bytes written at the last snapshot.
+        unsigned int total_retrans;   // At the last snapshot.
+        long snapshots;
+        long segments;                // Retransmitted segments.
+        unsigned long bytes;          // Estimated retransmitted bytes.
+        unsigned long attributed_bytes;
+        long affected_calls;  // Completed calls with retransmitted bytes.
+        long clean_calls;     // Completed calls without.
+        long dropped;         // Send calls not tracked, pending list full.
+        Histogram clean_ack_delay;
+        Histogram retrans_ack_delay;
+        Histogram added_delay;
+} Retransmissions;
+
+// A send call wrote bytes on a TCP socket.
+void retx_on_send(Retransmissions *retx, long send_id, unsigned long call_usec,
+                  long bytes);
+
+// A TCP_INFO snapshot, with outq bytes not acknowledged (SIOCOUTQ). Fills
+// reports with the calls completed with retransmitted bytes and returns their
+// number.
+int retx_on_snapshot(Retransmissions *retx, const struct tcp_info *info,
+                     int outq, unsigned long time_usec,
+                     RetxReport reports[RETX_MAX_PENDING]);
+
+#endif
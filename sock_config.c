@@ -0,0 +1,180 @@
+#define _GNU_SOURCE
+
+#include "sock_config.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+static pthread_mutex_t cfg_mutex = MUTEX_ERRORCHECK;
+static CfgEntry entries[CFG_MAX];
+static int entries_count = 0;
+static long entries_dropped = 0;  // Sockets with untracked configurations.
+
+/* Private functions */
+
+static int get_int(int fd, int level, int optname) {
+        int val;
+        return get_int_sockopt_if_supported(fd, level, optname, &val) ? val
+                                                                       : -1;
+}
+
+static void read_socket_level(int fd, SockConfig *cfg) {
+        cfg->sndbuf = get_int(fd, SOL_SOCKET, SO_SNDBUF);
+        cfg->rcvbuf = get_int(fd, SOL_SOCKET, SO_RCVBUF);
+        cfg->keepalive = get_int(fd, SOL_SOCKET, SO_KEEPALIVE);
+        cfg->reuseaddr = get_int(fd, SOL_SOCKET, SO_REUSEADDR);
+        cfg->reuseport = -1;
+#ifdef SO_REUSEPORT
+        cfg->reuseport = get_int(fd, SOL_SOCKET, SO_REUSEPORT);
+#endif
+        cfg->priority = get_int(fd, SOL_SOCKET, SO_PRIORITY);
+
+        struct linger linger;
+        socklen_t len = sizeof(linger);
+        cfg->linger_sec = -1;
+        if (get_sockopt_if_supported(fd, SOL_SOCKET, SO_LINGER, &linger,
+                                     &len) &&
+            linger.l_onoff)
+                cfg->linger_sec = linger.l_linger;
+
+        cfg->max_pacing_rate = -1;
+#ifdef SO_MAX_PACING_RATE
+        // 64 bits on recent kernels, 32 bits before (~0U if unlimited).
+        uint64_t rate = 0;
+        len = sizeof(rate);
+        if (get_sockopt_if_supported(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate,
+                                     &len)) {
+                if (len == sizeof(uint32_t)) {
+                        uint32_t rate32;
+                        memcpy(&rate32, &rate, sizeof(rate32));
+                        rate = rate32;
+                }
+                if (rate != UINT32_MAX && rate != UINT64_MAX)
+                        cfg->max_pacing_rate = rate;
+        }
+#endif
+}
+
+static void read_ip_level(int fd, SockConfig *cfg) {
+        if (cfg->domain == AF_INET)
+                cfg->tos = get_int(fd, IPPROTO_IP, IP_TOS);
+        else if (cfg->domain == AF_INET6)
+                cfg->tos = get_int(fd, IPPROTO_IPV6, IPV6_TCLASS);
+        else
+                cfg->tos = -1;
+}
+
+static void read_tcp_level(int fd, SockConfig *cfg) {
+        bool tcp = cfg->type == SOCK_STREAM;
+        cfg->nodelay = tcp ? get_int(fd, IPPROTO_TCP, TCP_NODELAY) : -1;
+        cfg->cork = tcp ? get_int(fd, IPPROTO_TCP, TCP_CORK) : -1;
+        cfg->keepidle = tcp ? get_int(fd, IPPROTO_TCP, TCP_KEEPIDLE) : -1;
+        cfg->keepintvl = tcp ? get_int(fd, IPPROTO_TCP, TCP_KEEPINTVL) : -1;
+        cfg->keepcnt = tcp ? get_int(fd, IPPROTO_TCP, TCP_KEEPCNT) : -1;
+        cfg->notsent_lowat = -1;
+#ifdef TCP_NOTSENT_LOWAT
+        if (tcp)
+                cfg->notsent_lowat =
+                    get_int(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT);
+#endif
+        cfg->user_timeout = -1;
+#ifdef TCP_USER_TIMEOUT
+        if (tcp)
+                cfg->user_timeout = get_int(fd, IPPROTO_TCP, TCP_USER_TIMEOUT);
+#endif
+        if (!tcp) return;
+        socklen_t len = sizeof(cfg->congestion) - 1;
+        if (!get_sockopt_if_supported(fd, IPPROTO_TCP, TCP_CONGESTION,
+                                      cfg->congestion, &len))
+                memset(cfg->congestion, 0, sizeof(cfg->congestion));
+}
+
+// Open addressing, the table never shrinks.
+static CfgEntry *get_entry(const SockConfig *cfg) {
+        uint32_t hash = hash_bytes(cfg, sizeof(SockConfig));
+        for (int probes = 0; probes < CFG_MAX; probes++) {
+                CfgEntry *entry = &entries[(hash + probes) % CFG_MAX];
+                if (entry->sockets) {
+                        if (entry->hash == hash &&
+                            !memcmp(&entry->config, cfg, sizeof(SockConfig)))
+                                return entry;
+                        continue;
+                }
+                entry->config = *cfg;
+                entry->hash = hash;
+                entry->id = entries_count++;
+                return entry;
+        }
+        return NULL;
+}
+
+static char *alloc_config_line(int id, void *arg) {
+        UNUSED(arg);
+        for (int i = 0; i < CFG_MAX; i++)
+                if (entries[i].sockets && entries[i].id == id)
+                        return alloc_sock_config_json(&entries[i]);
+        return NULL;
+}
+
+/* Public functions */
+
+int cfg_snapshot(int fd, int domain, int type) {
+        // All the options are read before taking the lock.
+        SockConfig cfg;
+        memset(&cfg, 0, sizeof(SockConfig));
+        cfg.domain = domain;
+        cfg.type = type;
+        read_socket_level(fd, &cfg);
+        read_ip_level(fd, &cfg);
+        read_tcp_level(fd, &cfg);
+
+        int id = -1;
+        mutex_lock(&cfg_mutex);
+        CfgEntry *entry = get_entry(&cfg);
+        if (entry) {
+                entry->sockets++;
+                id = entry->id;
+        } else {
+                entries_dropped++;
+        }
+        mutex_unlock(&cfg_mutex);
+        return id;
+}
+
+void dump_all_configs(void) {
+        if (!logs_dir_path) return;
+        mutex_lock(&cfg_mutex);
+        if (!entries_count) goto exit;
+
+        LOG_FUNC_INFO;
+        if (entries_dropped)
+                LOG(WARN, "%ld sockets with untracked configurations.",
+                    entries_dropped);
+        // In the order of the ids.
+        if (!write_json_lines("configs.json", false, entries_count,
+                              alloc_config_line, NULL))
+                goto error;
+        goto exit;
+error:
+        LOG(ERROR, "Could not write socket configurations.");
+        LOG_FUNC_ERROR;
+exit:
+        mutex_unlock(&cfg_mutex);
+}
+
+void cfg_reset(void) {
+        mutex_init(&cfg_mutex);
+        memset(entries, 0, sizeof(entries));
+        entries_count = 0;
+        entries_dropped = 0;
+}
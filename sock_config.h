@@ -0,0 +1,60 @@
+#ifndef SOCK_CONFIG_H
+#define SOCK_CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Configuration of the sockets, read once per connection when connect()
+ * succeeds or is in progress, and on the sockets returned by accept(): buffer
+ * sizes, Nagle, congestion control, keepalive, pacing... that is the options
+ * left to their default or set by the application before that point.
+ *
+ * Most connections of a process share the same configuration, so each distinct
+ * configuration is recorded once for the whole process (configs.json), with
+ * the number of sockets using it. A socket only keeps the id of its
+ * configuration (its fingerprint), reported in its summary. */
+
+#define CFG_MAX 256  // Distinct configurations tracked per process.
+#define CFG_CONGESTION_LEN 16  // TCP_CA_NAME_MAX.
+
+// Each value is -1 if the option is not supported, or does not apply (e.g. TCP
+// options on a UDP socket). The struct is compared with memcmp(): its padding
+// is zeroed.
+typedef struct {
+        int domain;
+        int type;
+        int sndbuf;
+        int rcvbuf;
+        int keepalive;
+        int reuseaddr;
+        int reuseport;
+        int priority;
+        int linger_sec;  // -1 if SO_LINGER is off.
+        int tos;         // IP_TOS or IPV6_TCLASS.
+        int64_t max_pacing_rate;  // Bytes per second, -1 if unlimited.
+        int nodelay;
+        int cork;
+        int keepidle;
+        int keepintvl;
+        int keepcnt;
+        int notsent_lowat;  // 0 if not set.
+        int user_timeout;
+        char congestion[CFG_CONGESTION_LEN];  // Empty if not read.
+} SockConfig;
+
+typedef struct {
+        SockConfig config;
+        uint32_t hash;
+        int id;        // In order of first use, from 0.
+        long sockets;  // Sockets with this configuration, 0 if unused.
+} CfgEntry;
+
+// Reads the configuration of fd and returns its id, or -1 if it could not be
+// recorded.
+int cfg_snapshot(int fd, int domain, int type);
+
+void dump_all_configs(void);  // Written to configs.json.
+
+void cfg_reset(void);  // Free state (called after fork()).
+
+#endif
@@ -6,6 +6,7 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/sockios.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <pcap/pcap.h>
@@ -13,46 +14,203 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include "call_sites.h"
 #include "constants.h"
 #include "init.h"
 #include "json_builder.h"
 #include "lib.h"
 #include "logger.h"
+#include "numa_nodes.h"
 #include "packet_sniffer.h"
 #include "resizable_array.h"
+#include "sock_config.h"
 #include "string_builders.h"
+#include "thread_profile.h"
 #include "verbose_mode.h"
 
-#ifdef __ANDROID__
-#define MUTEX_ERRORCHECK PTHREAD_ERRORCHECK_MUTEX_INITIALIZER
-#else
-#define MUTEX_ERRORCHECK PTHREAD_ERRORCHECK_MUTEX_INITIALIZER_NP
-#endif
-
 void sock_ev_forked_socket(int fd, SockInfo *sock_info);
 void sock_ev_ghost_socket(int fd);
 
 static pthread_mutex_t connections_count_mutex = MUTEX_ERRORCHECK;
 static int connections_count = 0;
 
+// Sockets per NUMA node, so that the dumper of a node only walks its own
+// sockets. Only kept with several nodes. The links are protected by the
+// mutex, the node of a socket by the lock of the socket.
+static pthread_mutex_t node_sockets_mutex = MUTEX_ERRORCHECK;
+static Socket *node_sockets[NUMA_MAX_NODES];
+static int node_sockets_count[NUMA_MAX_NODES];
+
 /* Private functions */
 
 static Socket *alloc_socket(int fd) {
-        Socket *sock = (Socket *)my_calloc(sizeof(Socket));
+        Socket *sock = (Socket *)my_aligned_calloc(sizeof(Socket));
+        sock->cold = (SockCold *)my_calloc(sizeof(SockCold));
         mutex_lock(&connections_count_mutex);
         sock->id = connections_count;
         connections_count++;
         mutex_unlock(&connections_count_mutex);
         sock->fd = fd;
+        ports_init(&sock->port);
+        sock->config_id = -1;
+        sock->node = -1;
         return sock;
 }
 
+static void unlist_socket(Socket *sock) {
+        if (sock->node_prev)
+                sock->node_prev->node_next = sock->node_next;
+        else
+                node_sockets[sock->node] = sock->node_next;
+        if (sock->node_next) sock->node_next->node_prev = sock->node_prev;
+        node_sockets_count[sock->node]--;
+        sock->node_prev = NULL;
+        sock->node_next = NULL;
+}
+
+// Lists the socket under the node of the CPU of its last event. A socket only
+// moves when its threads migrate to another node, which is rare.
+static void list_socket(Socket *sock, int cpu) {
+        if (numa_nodes_count() < 2) return;
+        int node = numa_node_of_cpu(cpu);
+        if (node == sock->node) return;
+        mutex_lock(&node_sockets_mutex);
+        if (sock->node != -1) unlist_socket(sock);
+        sock->node = node;
+        sock->node_next = node_sockets[node];
+        if (sock->node_next) sock->node_next->node_prev = sock;
+        node_sockets[node] = sock;
+        node_sockets_count[node]++;
+        mutex_unlock(&node_sockets_mutex);
+}
+
+// The analyses are allocated on first use (see SockAnalyses).
+#define LAZY_ALLOC(ptr) ((ptr) ? (ptr) : ((ptr) = my_calloc(sizeof(*(ptr)))))
+
+static bool tcp_info_on(void) { return conf_opt_b > 0 || conf_opt_u > 0; }
+
+static ReqResp *sock_rr(Socket *sock) {
+        return LAZY_ALLOC(sock->cold->analyses.rr);
+}
+
+static Wakeups *sock_wakeups(Socket *sock) {
+        return LAZY_ALLOC(sock->cold->analyses.wakeups);
+}
+
+static CpuAffinity *sock_cpu_affinity(Socket *sock) {
+        SockAnalyses *a = &sock->cold->analyses;
+        if (!a->cpu_affinity) {
+                a->cpu_affinity = (CpuAffinity *)my_calloc(sizeof(CpuAffinity));
+                cpu_init(a->cpu_affinity);
+        }
+        return a->cpu_affinity;
+}
+
+static Concurrency *sock_concurrency(Socket *sock) {
+        return LAZY_ALLOC(sock->cold->analyses.concurrency);
+}
+
+// NULL without -x.
+static Timestamping *sock_timestamping(Socket *sock) {
+        if (!conf_opt_x) return NULL;
+        return LAZY_ALLOC(sock->cold->analyses.timestamping);
+}
+
+// NULL without -b or -u, as the following.
+static SockQueuesStats *sock_queues(Socket *sock) {
+        if (!tcp_info_on()) return NULL;
+        return LAZY_ALLOC(sock->cold->analyses.queues);
+}
+
+static Retransmissions *sock_retransmissions(Socket *sock) {
+        if (!tcp_info_on()) return NULL;
+        return LAZY_ALLOC(sock->cold->analyses.retransmissions);
+}
+
+static Anomalies *sock_anomalies(Socket *sock) {
+        if (!tcp_info_on()) return NULL;
+        return LAZY_ALLOC(sock->cold->analyses.anomalies);
+}
+
+static CcStats *sock_cc(Socket *sock) {
+        if (!tcp_info_on()) return NULL;
+        return LAZY_ALLOC(sock->cold->analyses.cc);
+}
+
+// Allocated once the connection is known.
+static Waterfall *sock_waterfall(Socket *sock) {
+        return LAZY_ALLOC(sock->cold->analyses.waterfall);
+}
+
+static void free_analyses(SockAnalyses *a) {
+        free(a->rr);
+        free(a->wakeups);
+        free(a->cpu_affinity);
+        free(a->concurrency);
+        free(a->timestamping);
+        free(a->queues);
+        free(a->retransmissions);
+        free(a->anomalies);
+        free(a->cc);
+        free(a->waterfall);
+        memset(a, 0, sizeof(SockAnalyses));
+}
+
+// Events not created by a call of the application.
+static bool is_fake_event(SockEventType type) {
+        switch (type) {
+                case SOCK_EV_FORKED_SOCKET:
+                case SOCK_EV_GHOST_SOCKET:
+                case SOCK_EV_TCP_INFO:
+                case SOCK_EV_TX_TIMESTAMPS:
+                case SOCK_EV_MEMINFO:
+                case SOCK_EV_ANOMALY:
+                case SOCK_EV_SUMMARY:
+                        return true;
+                default:
+                        return false;
+        }
+}
+
+// Bytes moved by a call, -1 if the call does not move data.
+static long call_bytes(SockEventType type, int return_value) {
+        switch (type) {
+                case SOCK_EV_SEND:
+                case SOCK_EV_RECV:
+                case SOCK_EV_SENDTO:
+                case SOCK_EV_RECVFROM:
+                case SOCK_EV_SENDMSG:
+                case SOCK_EV_RECVMSG:
+                case SOCK_EV_WRITE:
+                case SOCK_EV_READ:
+                case SOCK_EV_WRITEV:
+                case SOCK_EV_READV:
+                case SOCK_EV_SENDFILE:
+                        return return_value < 0 ? -1 : return_value;
+                default:
+                        return -1;
+        }
+}
+
+static void attribute_call_site(SockEvent *ev) {
+        ev->call_site = cs_take(&ev->start_usec);
+        if (!ev->call_site) return;
+        unsigned long latency =
+            ev->start_usec && ev->timestamp_usec > ev->start_usec
+                ? ev->timestamp_usec - ev->start_usec
+                : 0;
+        if (cs_on_call(ev->call_site, ev->type, ev->success,
+                       call_bytes(ev->type, ev->return_value), latency))
+                ev->stack_depth = cs_capture_stack(ev->call_site, &ev->stack);
+}
+
 #define CASE_EV(ev_type_cons, ev_type, err_val)               \
         case ev_type_cons:                                    \
                 ev = (SockEvent *)my_calloc(sizeof(ev_type)); \
@@ -109,6 +267,10 @@ static SockEvent *alloc_event(SockEventType type, int return_value, int err,
                 CASE_EV(SOCK_EV_EPOLL_PWAIT, SockEvEpollPwait, -1);
                 CASE_EV(SOCK_EV_FDOPEN, SockEvFdopen, 0);
                 CASE_EV(SOCK_EV_TCP_INFO, SockEvTcpInfo, -1);
+                CASE_EV(SOCK_EV_TX_TIMESTAMPS, SockEvTxTimestamps, -1);
+                CASE_EV(SOCK_EV_MEMINFO, SockEvMeminfo, -1);
+                CASE_EV(SOCK_EV_ANOMALY, SockEvAnomaly, -1);
+                CASE_EV(SOCK_EV_SUMMARY, SockEvSummary, -1);
         }
         ev->timestamp_usec = get_time_micros();
         ev->type = type;
@@ -117,10 +279,13 @@ static SockEvent *alloc_event(SockEventType type, int return_value, int err,
         ev->err = err;
         ev->id = id;
         ev->thread_id = syscall(SYS_gettid);
+        ev->cpu = get_current_cpu();
+        if (!is_fake_event(type)) attribute_call_site(ev);
         return ev;
 }
 
 static void free_event(SockEvent *ev) {
+        free(ev->stack);
         switch (ev->type) {
                 case SOCK_EV_GETSOCKOPT:
                         free(((SockEvGetsockopt *)ev)->sockopt.optval);
@@ -145,6 +310,16 @@ static void free_event(SockEvent *ev) {
                 case SOCK_EV_FDOPEN:
                         free(((SockEvFdopen *)ev)->mode);
                         break;
+                case SOCK_EV_TCP_INFO:
+                        free(((SockEvTcpInfo *)ev)->retrans);
+                        break;
+                case SOCK_EV_TX_TIMESTAMPS:
+                        free(((SockEvTxTimestamps *)ev)->sends);
+                        break;
+                case SOCK_EV_SUMMARY:
+                        flows_free(&((SockEvSummary *)ev)->flows);
+                        free_analyses(&((SockEvSummary *)ev)->analyses);
+                        break;
                 default:
                         break;
         }
@@ -173,11 +348,50 @@ static void push_event(Socket *sock, SockEvent *ev) {
 
         sock->tail = node;
         sock->events_count++;
+        // The summary is pushed by whichever thread closes or exits.
+        if (ev->type != SOCK_EV_SUMMARY) {
+                cpu_on_event(sock_cpu_affinity(sock), ev->cpu);
+                list_socket(sock, ev->cpu);
+        }
         return;
 }
 
+// Start of the call, or its return if not a call of the application.
+static unsigned long call_start(const SockEvent *ev) {
+        return ev->start_usec ? ev->start_usec : ev->timestamp_usec;
+}
+
+static void account_app_call(Socket *sock, const SockEvent *ev) {
+        if (!ev->call_site) return;  // Not a call of the application.
+        Waterfall *wf = sock->cold->analyses.waterfall;
+        if (wf) wf_on_call(wf, sock->fd, ev->timestamp_usec);
+        prof_on_call(ev->thread_id, ev->type, sock->id, ev->start_usec,
+                     ev->timestamp_usec);
+        Concurrency *conc = sock_concurrency(sock);
+        bool first = !conc_overlaps(conc);
+        if (conc_on_call(conc, ev->thread_id, ev->type,
+                         ev->call_site, ev->start_usec, ev->timestamp_usec) &&
+            first)
+                LOG(WARN, "Concurrent calls on socket %d by different threads.",
+                    sock->id);
+}
+
 #define SOCK_TYPE_MASK 0b1111
-static void fill_sock_info(SockInfo *si, int domain, int type, int protocol) {
+static void fill_sock_identity(SockInfo *si, int fd) {
+#ifdef SO_COOKIE
+        socklen_t optlen = sizeof(si->cookie);
+        if (!get_sockopt_if_supported(fd, SOL_SOCKET, SO_COOKIE, &si->cookie,
+                                      &optlen))
+                si->cookie = 0;
+#else
+        si->cookie = 0;
+#endif
+        struct stat statbuf;
+        si->inode = fstat(fd, &statbuf) ? 0 : statbuf.st_ino;
+}
+
+static void fill_sock_info(SockInfo *si, int fd, int domain, int type,
+                           int protocol) {
         si->domain = domain;
         si->type = type & SOCK_TYPE_MASK;
         si->protocol = protocol;
@@ -188,6 +402,7 @@ static void fill_sock_info(SockInfo *si, int domain, int type, int protocol) {
         si->sock_cloexec = false;
         si->sock_nonblock = false;
 #endif
+        fill_sock_identity(si, fd);
         si->filled = true;
 }
 
@@ -207,6 +422,7 @@ static void fill_sock_info_from_fd(SockInfo *si, int fd) {
         si->sock_cloexec = false;
         si->sock_nonblock = false;
 #endif
+        fill_sock_identity(si, fd);
         si->filled = true;
         return;
 }
@@ -368,12 +584,27 @@ error_out:
         return;
 }
 
+static void fill_sock_queues(int fd, SockQueues *queues) {
+        if (my_ioctl(fd, SIOCOUTQ, &queues->outq) == -1) queues->outq = -1;
+        if (my_ioctl(fd, SIOCOUTQNSD, &queues->outq_nsd) == -1)
+                queues->outq_nsd = -1;
+        if (my_ioctl(fd, SIOCINQ, &queues->inq) == -1) queues->inq = -1;
+}
+
 static void tcp_dump_tcp_info(int fd) {
         struct tcp_info *info =
             (struct tcp_info *)my_malloc(sizeof(struct tcp_info));
         int ret = fill_tcp_info(fd, info);
         int err = errno;
-        sock_ev_tcp_info(fd, ret, err, info);
+        // The queue ioctls fail with EINVAL on listening sockets.
+        SockQueues queues = {-1, -1, -1};
+        CcSample cc;
+        memset(&cc, 0, sizeof(CcSample));
+        if (!ret && info->tcpi_state != TCP_LISTEN) {
+                fill_sock_queues(fd, &queues);
+                cc_fill_sample(fd, &cc);
+        }
+        sock_ev_tcp_info(fd, ret, err, info, &queues, &cc);
 }
 
 static bool should_dump_tcp_info(const Socket *sock) {
@@ -385,6 +616,12 @@ static bool should_dump_tcp_info(const Socket *sock) {
                 if (time_elasped > conf_opt_u) return true;
         }
 
+        const Anomalies *anom = sock->cold->analyses.anomalies;
+        if (anom && anom_is_boosted(anom, get_time_micros())) {
+                long elapsed = get_time_micros() - sock->last_info_dump_micros;
+                if (elapsed > ANOM_BOOST_INTERVAL_USEC) return true;
+        }
+
         if (conf_opt_b > 0) {
                 long cur_bytes = sock->bytes_sent + sock->bytes_received;
                 long bytes_elapsed = cur_bytes - sock->last_info_dump_bytes;
@@ -394,11 +631,310 @@ static bool should_dump_tcp_info(const Socket *sock) {
         return false;
 }
 
+static void dump_meminfo(int fd) {
+        MemSample sample;
+        memset(&sample, 0, sizeof(sample));
+        int ret = mem_fill_sample(fd, &sample) ? 0 : -1;
+        int err = errno;
+        sock_ev_meminfo(fd, ret, err, &sample);
+}
+
+static bool should_sample_meminfo(const Socket *sock) {
+        if (conf_opt_m <= 0 || sock->memory.unsupported) return false;
+        unsigned long elapsed =
+            get_time_micros() - sock->memory.last_sample_usec;
+        return elapsed > (unsigned long)conf_opt_m * 1000;
+}
+
+// For the last sample at close or exit, out of the period of -m.
+static bool can_sample_meminfo(int fd) {
+        if (conf_opt_m <= 0) return false;
+        Socket *sock = ra_get_and_lock_elem(fd);
+        bool ret = sock && !sock->memory.unsupported;
+        ra_unlock_elem(fd);
+        return ret;
+}
+
+static bool is_stream(const Socket *sock) {
+        return sock->sock_info.type == SOCK_STREAM;
+}
+
+static void update_snd_mss(Socket *sock) {
+        struct tcp_info info;
+        if (!fill_tcp_info(sock->fd, &info))
+                sock->nagle.snd_mss = info.tcpi_snd_mss;
+        else
+                sock->nagle.snd_mss = -1;  // Don't try again.
+}
+
+// A poll(), select() or epoll_wait() returned the socket as readable.
+static void account_wakeup(Socket *sock, int epfd, const SockEvent *ev) {
+        wakeup_on_ready(sock_wakeups(sock), ev->thread_id, epfd,
+                        ev->timestamp_usec);
+        if (epfd >= 0) wakeup_epoll_on_ready(epfd, ev->thread_id);
+}
+
+// An accept() or a read-side call settles the pending wakeup of the thread.
+static void account_consume(Socket *sock, const SockEvent *ev) {
+        Wakeups *w = sock->cold->analyses.wakeups;
+        if (!w) return;  // No wakeup yet.
+        int epfd;
+        WakeupOutcome outcome =
+            wakeup_on_consume(w, ev->thread_id, ev->success,
+                              ev->err, ev->timestamp_usec, &epfd);
+        if (epfd >= 0 && outcome != WAKEUP_NONE)
+                wakeup_epoll_on_outcome(epfd, ev->thread_id, outcome);
+}
+
+// Control data of the sendmsg() and recvmsg() events, or of their message msg
+// for sendmmsg() and recvmmsg(). NULL for the others.
+static const struct msghdr *ev_msghdr(const SockEvent *ev, int msg) {
+        const Mmsghdr *vec = NULL;
+        switch (ev->type) {
+                case SOCK_EV_SENDMSG:
+                        return ((const SockEvSendmsg *)ev)->msghdr.msghdr;
+                case SOCK_EV_RECVMSG:
+                        return ((const SockEvRecvmsg *)ev)->msghdr.msghdr;
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 21
+                case SOCK_EV_SENDMMSG:
+                        vec = ((const SockEvSendmmsg *)ev)->mmsghdr_vec;
+                        break;
+                case SOCK_EV_RECVMMSG:
+                        vec = ((const SockEvRecvmmsg *)ev)->mmsghdr_vec;
+                        break;
+#endif
+                default:
+                        return NULL;
+        }
+        return vec ? vec[msg].msghdr.msghdr : NULL;
+}
+
+static void account_udp(Socket *sock, bool sent, int ret, int msg,
+                        const SockEvent *ev) {
+        if (sock->sock_info.type != SOCK_DGRAM || ret == -1) return;
+        if (!msg) udp_on_call(&sock->udp, sent);
+        if (sent)
+                udp_on_send(&sock->udp, ev_msghdr(ev, msg), ret);
+        else
+                udp_on_recv(&sock->udp, ev_msghdr(ev, msg), ret);
+}
+
+// Accounts for a datagram in the flow of its peer. Returns false if the
+// datagram has no peer address, as on a connected socket.
+static bool account_peer(Socket *sock, bool sent, long bytes,
+                         const struct sockaddr *addr, socklen_t len,
+                         const SockEvent *ev) {
+        if (sock->sock_info.type != SOCK_DGRAM || sock->dgram_connected ||
+            !addr || !len || bytes < 0)
+                return false;
+        return flows_on_datagram(&sock->flows, addr, len, sent, bytes,
+                                 ev->timestamp_usec, conf_opt_g * 1000);
+}
+
+// Feed the online analyses with a call that transferred data. sendmmsg() and
+// recvmmsg() feed them with each of their messages, msg being its index: the
+// call itself is accounted with its first message.
+static void account_data(Socket *sock, bool sent, int ret, size_t requested,
+                         int flags, int msg, const SockEvent *ev) {
+        ReqResp *rr = sock_rr(sock);
+        rr->server = sock->accepted;
+        rr_add_data(rr, sent, ret, ev->timestamp_usec, conf_opt_g * 1000);
+        if (!sent && !msg) account_consume(sock, ev);
+        if (!sent && !msg) mem_on_recv_call(&sock->memory);
+        if (ret > 0 && !msg)
+                cpu_on_data(sock_cpu_affinity(sock), sock->fd, ev->cpu);
+        Timestamping *ts = sock->cold->analyses.timestamping;
+        if (sent && ts) ts_on_send(ts, ev->id, ev->timestamp_usec, ret, 1);
+        account_udp(sock, sent, ret, msg, ev);
+
+        if (!is_stream(sock)) return;
+        Waterfall *wf = sock->cold->analyses.waterfall;
+        if (wf) wf_on_data(wf, sent, ret, call_start(ev), ev->timestamp_usec);
+        if (sent) {
+                if (!sock->nagle.snd_mss && ret > 0) update_snd_mss(sock);
+                nagle_on_write(&sock->nagle, ret, flags, ev->timestamp_usec);
+                // Located by the TCP_INFO snapshots.
+                Retransmissions *retx = sock_retransmissions(sock);
+                if (retx)
+                        retx_on_send(retx, ev->id, ev->timestamp_usec, ret);
+        } else {
+                nagle_on_read(&sock->nagle, requested, ret,
+                              ev->timestamp_usec);
+        }
+}
+
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 21
+static size_t msg_bytes(const struct msghdr *msgh) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < (size_t)msgh->msg_iovlen; i++)
+                bytes += msgh->msg_iov[i].iov_len;
+        return bytes;
+}
+
+static void account_mmsg(Socket *sock, bool sent, int ret,
+                         const struct mmsghdr *vmessages, int flags,
+                         const SockEvent *ev) {
+        if (ret <= 0) {
+                account_data(sock, sent, ret, 0, flags, 0, ev);
+                return;
+        }
+        for (int i = 0; i < ret; i++)
+                account_data(sock, sent, vmessages[i].msg_len,
+                             msg_bytes(&vmessages[i].msg_hdr), flags, i, ev);
+}
+#endif
+
+// TCP sockets must be connected or connecting, see ts_enable().
+static void enable_timestamping(Socket *sock) {
+        Timestamping *ts = sock_timestamping(sock);
+        if (!ts || ts->flags) return;
+        if (is_stream(sock))
+                ts_enable(ts, sock->fd, true, conf_opt_x);
+        else if (sock->sock_info.type == SOCK_DGRAM)
+                ts_enable(ts, sock->fd, false, conf_opt_x);
+}
+
+static void snapshot_config(Socket *sock) {
+        if (sock->config_id != -1) return;
+        sock->config_id = cfg_snapshot(sock->fd, sock->sock_info.domain,
+                                       sock->sock_info.type);
+}
+
+static void drain_tx_timestamps(Socket *sock) {
+        Timestamping *ts = sock->cold->analyses.timestamping;
+        if (!ts) return;
+        TsSend done[TS_MAX_PENDING];
+        int count = ts_drain(ts, sock->fd, done);
+        if (!count) return;
+        SockEvTxTimestamps *ev = (SockEvTxTimestamps *)alloc_event(
+            SOCK_EV_TX_TIMESTAMPS, count, 0, sock->events_count);
+        ev->sends_count = count;
+        ev->sends = (TsSend *)my_malloc(count * sizeof(TsSend));
+        if (ev->sends) memcpy(ev->sends, done, count * sizeof(TsSend));
+        push_event(sock, (SockEvent *)ev);
+        output_event((SockEvent *)ev, sock->id);
+}
+
+static void account_retransmissions(Socket *sock, SockEvTcpInfo *ev) {
+        Retransmissions *retx = sock_retransmissions(sock);
+        if (!retx || ev->super.return_value) return;
+        RetxReport reports[RETX_MAX_PENDING];
+        int count = retx_on_snapshot(retx, &ev->info,
+                                     ev->queues.outq, ev->super.timestamp_usec,
+                                     reports);
+        if (!count) return;
+        ev->retrans = (RetxReport *)my_malloc(count * sizeof(RetxReport));
+        if (!ev->retrans) return;
+        memcpy(ev->retrans, reports, count * sizeof(RetxReport));
+        ev->retrans_count = count;
+}
+
+static void detect_anomalies(Socket *sock, const SockEvTcpInfo *ev) {
+        Anomalies *anom = sock_anomalies(sock);
+        if (!anom || ev->super.return_value) return;
+        if (!anom_on_sample(anom, &ev->info, ev->queues.outq_nsd,
+                            ev->super.timestamp_usec))
+                return;
+        if ((conf_opt_w & ANOM_OPT_FLUSH) && sock->cold->capture_switch)
+                flush_capture(sock->cold->capture_switch);
+}
+
+static void push_anomalies(Socket *sock) {
+        Anomalies *anom = sock->cold->analyses.anomalies;
+        if (!anom) return;
+        Anomaly anomalies[ANOM_KINDS];
+        int count = anom_take(anom, anomalies);
+        for (int i = 0; i < count; i++) {
+                SockEvAnomaly *ev = (SockEvAnomaly *)alloc_event(
+                    SOCK_EV_ANOMALY, 0, 0, sock->events_count);
+                ev->anomaly = anomalies[i];
+                push_event(sock, (SockEvent *)ev);
+                output_event((SockEvent *)ev, sock->id);
+        }
+}
+
+static void sample_accept_queue(Socket *sock) {
+        struct tcp_info info;
+        if (fill_tcp_info(sock->fd, &info)) return;
+        aq_add_sample(&sock->accept_queue, info.tcpi_unacked,
+                      info.tcpi_sacked, get_time_micros());
+}
+
+// Appends the socket to the per-process index, to join its trace with the
+// traces of the same kernel socket in other processes.
+static void index_socket(const Socket *sock) {
+        if (!logs_dir_path) return;
+        char *json_str = alloc_sock_index_json(sock);
+        if (!json_str) goto error1;
+        char *path = alloc_concat_path(logs_dir_path, "sockets.json");
+        if (!path) goto error2;
+        // Written with a single write() in append mode, as the sockets of
+        // several threads may be closed at once.
+        size_t len = strlen(json_str);
+        char *line = (char *)my_malloc(len + 2);
+        if (!line) goto error3;
+        memcpy(line, json_str, len);
+        strcpy(line + len, "\n");
+        if (append_string_to_file(line, path)) goto error4;
+        free(line);
+        free(path);
+        free(json_str);
+        return;
+error4:
+        free(line);
+error3:
+        free(path);
+error2:
+        free(json_str);
+error1:
+        LOG(ERROR, "Could not index socket %d.", sock->id);
+        LOG_FUNC_ERROR;
+}
+
+static void push_summary(Socket *sock) {
+        SockEvSummary *ev = (SockEvSummary *)alloc_event(
+            SOCK_EV_SUMMARY, 0, 0, sock->events_count);
+        ev->bytes_sent = sock->bytes_sent;
+        ev->bytes_received = sock->bytes_received;
+        ev->stream = is_stream(sock);
+        ev->nagle = sock->nagle;
+        nagle_flush(&ev->nagle);
+        ev->listening = sock->listening;
+        ev->accept_queue = sock->accept_queue;
+        ev->memory = sock->memory;
+        ev->udp = sock->udp;
+        // The analyses move to the event, which frees them.
+        sock_rr(sock);
+        sock_wakeups(sock);
+        sock_cpu_affinity(sock);
+        sock_concurrency(sock);
+        ev->analyses = sock->cold->analyses;
+        memset(&sock->cold->analyses, 0, sizeof(SockAnalyses));
+        rr_flush(ev->analyses.rr);
+        wakeup_flush(ev->analyses.wakeups);
+        if (ev->analyses.waterfall) wf_aggregate(ev->analyses.waterfall);
+        ev->config_id = sock->config_id;
+        index_socket(sock);
+        // The flows move to the event, which frees them.
+        ev->flows = sock->flows;
+        flows_flush(&ev->flows);
+        memset(&sock->flows, 0, sizeof(UdpFlows));
+        push_event(sock, (SockEvent *)ev);
+}
+
 /* Public functions */
 
 void free_socket(Socket *sock) {
         if (!sock) return;  // NULL
+        if (sock->node != -1) {
+                mutex_lock(&node_sockets_mutex);
+                unlist_socket(sock);
+                mutex_unlock(&node_sockets_mutex);
+        }
         free_events_list(sock->head);
+        flows_free(&sock->flows);
+        if (sock->cold) free_analyses(&sock->cold->analyses);
+        free(sock->cold);
         free(sock);
 }
 
@@ -410,7 +946,8 @@ void sock_start_capture(int fd, const struct sockaddr *addr_to) {
 
         // We force a bind if the socket is not bound. This allows us to know
         // the source port and use a more specific filter for the capture.
-        if (!sock->bound) force_bind(fd, sock, addr_to->sa_family == AF_INET6);
+        if (!sock->cold->bound)
+                force_bind(fd, sock, addr_to->sa_family == AF_INET6);
 
         // Build pcap file path
         char *pcap_file_path = alloc_pcap_path_str(sock);
@@ -418,12 +955,15 @@ void sock_start_capture(int fd, const struct sockaddr *addr_to) {
 
         // Build capture filter
         const struct sockaddr *addr_from =
-            (sock->bound) ? (const struct sockaddr *)&sock->bound_addr : NULL;
+            (sock->cold->bound)
+                ? (const struct sockaddr *)&sock->cold->bound_addr
+                : NULL;
 
         const char *capture_filter = alloc_capture_filter(addr_from, addr_to);
         if (!capture_filter) goto error1;
         // See deadlock note in is_inet_socket.
-        sock->capture_switch = start_capture(capture_filter, pcap_file_path);
+        sock->cold->capture_switch =
+            start_capture(capture_filter, pcap_file_path);
 
         free(pcap_file_path);
         ra_unlock_elem(fd);
@@ -441,10 +981,20 @@ void log_event(LogLevel lvl, int ev_type_cons, int fd, int con_id) {
         LOG(lvl, "%s on connection %d (fd %d).", ev_name, con_id, fd);
 }
 
+void sock_before_close(int fd) {
+        if (!ra_is_present(fd)) return;
+        // Last sample of the memory, with the drops up to the close.
+        if (can_sample_meminfo(fd)) dump_meminfo(fd);
+        Socket *sock = ra_get_and_lock_elem(fd);
+        if (sock) ports_on_close(&sock->port, fd);
+        ra_unlock_elem(fd);
+}
+
 void free_and_dump_socket(int fd) {
         Socket *sock = ra_remove_elem(fd);
-        if (sock->capture_switch != NULL)
-                stop_capture(sock->capture_switch, sock->rtt * 2);
+        if (sock->cold->capture_switch != NULL)
+                stop_capture(sock->cold->capture_switch, sock->rtt * 2);
+        push_summary(sock);
         dump_events_as_json(sock);
         free_socket(sock);
 }
@@ -452,17 +1002,33 @@ void free_and_dump_socket(int fd) {
 // Used for any event that duplicates a socket, such as dup() or accept().
 // We don't have a regular socket() call but we still need to know about the
 // type of socket we are dealing with in the trace. To this purpose, we copy
-// the sock_info of the original socket to the new event & socket.
+// the sock_info of the original socket to the new event & socket, except for
+// the identity of the kernel socket, which differs for accept().
 #define DUP_SOCKET(ev_type_cons, ev_type)                              \
         {                                                              \
                 Socket *new_sock = alloc_socket(ret);                  \
                 memcpy(&new_sock->sock_info, &sock->sock_info,         \
                        sizeof(SockInfo));                              \
+                fill_sock_identity(&new_sock->sock_info, ret);         \
+                new_sock->accepted = sock->accepted ||                 \
+                                     ev_type_cons == SOCK_EV_ACCEPT || \
+                                     ev_type_cons == SOCK_EV_ACCEPT4;  \
+                new_sock->config_id = sock->config_id;                 \
+                new_sock->dgram_connected = sock->dgram_connected;     \
                 log_event(INFO, ev_type_cons, ret, new_sock->id);      \
+                if (ev_type_cons == SOCK_EV_ACCEPT ||                  \
+                    ev_type_cons == SOCK_EV_ACCEPT4) {                 \
+                        enable_timestamping(new_sock);                 \
+                        snapshot_config(new_sock);                     \
+                        wf_on_accept(sock_waterfall(new_sock), ret,    \
+                                     ev->super.timestamp_usec);        \
+                }                                                      \
                 ev_type *new_ev =                                      \
                     (ev_type *)alloc_event(ev_type_cons, ret, err, 0); \
                 memcpy(new_ev, ev, sizeof(ev_type));                   \
-                memcpy(&new_ev->sock_info, &sock->sock_info,           \
+                new_ev->super.stack = NULL;                            \
+                new_ev->super.stack_depth = 0;                         \
+                memcpy(&new_ev->sock_info, &new_sock->sock_info,       \
                        sizeof(SockInfo));                              \
                 push_event(new_sock, (SockEvent *)new_ev);             \
                 ra_unlock_elem(fd);                                    \
@@ -476,15 +1042,32 @@ void free_and_dump_socket(int fd) {
         Socket *sock = ra_get_and_lock_elem(fd);                     \
         log_event(INFO, ev_type_cons, fd, sock->id);                 \
         ev_type *ev = (ev_type *)alloc_event(ev_type_cons, ret, err, \
-                                             sock->events_count);
+                                             sock->events_count);    \
+        account_app_call(sock, (SockEvent *)ev);
+
+// With -o, the datagrams accounted in the flow of their peer are not
+// recorded as events.
+#define DROP_IF_PER_PEER(accounted)                \
+        if ((accounted) && conf_opt_o) {           \
+                free_event((SockEvent *)ev);       \
+                ev = NULL;                         \
+        }
 
 #define SOCK_EV_POSTLUDE(ev_type_cons)                                      \
-        push_event(sock, (SockEvent *)ev);                                  \
-        output_event((SockEvent *)ev);                                      \
+        if (ev) {                                                           \
+                push_event(sock, (SockEvent *)ev);                          \
+                output_event((SockEvent *)ev, sock->id);                    \
+        }                                                                   \
+        if (ev_type_cons != SOCK_EV_CLOSE) drain_tx_timestamps(sock);       \
+        push_anomalies(sock);                                               \
         bool dump_tcp_info =                                                \
             should_dump_tcp_info(sock) && ev_type_cons != SOCK_EV_TCP_INFO; \
+        bool sample_meminfo = ev_type_cons != SOCK_EV_CLOSE &&              \
+                              ev_type_cons != SOCK_EV_MEMINFO &&            \
+                              should_sample_meminfo(sock);                  \
         ra_unlock_elem(fd);                                                 \
-        if (dump_tcp_info) tcp_dump_tcp_info(fd);
+        if (dump_tcp_info) tcp_dump_tcp_info(fd);                           \
+        if (sample_meminfo) dump_meminfo(fd);
 
 const char *string_from_sock_event_type(SockEventType type) {
         static const char *strings[] = {
@@ -532,9 +1115,13 @@ const char *string_from_sock_event_type(SockEventType type) {
                 "epoll_wait",
                 "epoll_pwait",
                 "fdopen",
-                "tcp_info"
+                "tcp_info",
+                "tx_timestamps",
+                "meminfo",
+                "anomaly",
+                "summary"
         };
-        assert(sizeof(strings) / sizeof(char *) == SOCK_EV_TCP_INFO + 1);
+        assert(sizeof(strings) / sizeof(char *) == SOCK_EV_SUMMARY + 1);
         return strings[type];
 }
 
@@ -552,11 +1139,12 @@ void sock_ev_socket(int fd, int domain, int type, int protocol) {
         // We duplicate the sock_info on the Socket itself, as the socket event
         // will be freed as soon as events are dumped to JSON. Placing a copy
         // on the Socket itself is thus convenient to keep track of it.
-        fill_sock_info(&ev->sock_info, domain, type, protocol);
-        fill_sock_info(&sock->sock_info, domain, type, protocol);
+        fill_sock_info(&sock->sock_info, fd, domain, type, protocol);
+        memcpy(&ev->sock_info, &sock->sock_info, sizeof(SockInfo));
         log_event(INFO, SOCK_EV_SOCKET, fd, sock->id);
 
         push_event(sock, (SockEvent *)ev);
+        if (sock->sock_info.type == SOCK_DGRAM) enable_timestamping(sock);
         ra_put_elem(fd, sock);
 }
 
@@ -592,8 +1180,9 @@ void sock_ev_bind(int fd, int ret, int err, const struct sockaddr *addr,
         fill_addr(&(ev->addr), addr, len);
         if (!ret) {
                 // Save bound addr as we will later use it for capture filter.
-                sock->bound = true;
-                memcpy(&sock->bound_addr, &ev->addr.sockaddr_sto, ev->addr.len);
+                sock->cold->bound = true;
+                memcpy(&sock->cold->bound_addr, &ev->addr.sockaddr_sto,
+                       ev->addr.len);
         }
 
         SOCK_EV_POSTLUDE(SOCK_EV_BIND);
@@ -605,6 +1194,20 @@ void sock_ev_connect(int fd, int ret, int err, const struct sockaddr *addr,
         SOCK_EV_PRELUDE(SOCK_EV_CONNECT, SockEvConnect);
 
         fill_addr(&(ev->addr), addr, len);
+        dns_link_addr(addr, &ev->dns);
+        // connect() to AF_UNSPEC dissolves the association.
+        if (!ret && sock->sock_info.type == SOCK_DGRAM)
+                sock->dgram_connected = addr && addr->sa_family != AF_UNSPEC;
+        if (!ret || err == EINPROGRESS) {
+                enable_timestamping(sock);
+                snapshot_config(sock);
+        }
+        if ((!ret || err == EINPROGRESS) && is_stream(sock)) {
+                ports_on_connect(&sock->port, fd, addr, len, sock->cold->bound);
+                wf_on_connect(sock_waterfall(sock), addr, len, &ev->dns, !ret,
+                              err == EINPROGRESS, call_start(&ev->super),
+                              ev->super.timestamp_usec);
+        }
 
         SOCK_EV_POSTLUDE(SOCK_EV_CONNECT);
 }
@@ -615,6 +1218,11 @@ void sock_ev_shutdown(int fd, int ret, int err, int how) {
 
         ev->shut_rd = (how == SHUT_RD) || (how == SHUT_RDWR);
         ev->shut_wr = (how == SHUT_WR) || (how == SHUT_RDWR);
+        if (!ret && ev->shut_wr) {
+                ports_on_shutdown(&sock->port, fd);
+                Waterfall *wf = sock->cold->analyses.waterfall;
+                if (wf) wf_on_shutdown(wf, call_start(&ev->super));
+        }
 
         SOCK_EV_POSTLUDE(SOCK_EV_SHUTDOWN);
 }
@@ -624,6 +1232,11 @@ void sock_ev_listen(int fd, int ret, int err, int backlog) {
         SOCK_EV_PRELUDE(SOCK_EV_LISTEN, SockEvListen);
 
         ev->backlog = backlog;
+        if (!ret && is_stream(sock)) {
+                sock->listening = true;
+                sample_accept_queue(sock);
+                start_listen_sampler_thread();
+        }
 
         SOCK_EV_POSTLUDE(SOCK_EV_LISTEN);
 }
@@ -634,6 +1247,7 @@ void sock_ev_accept(int fd, int ret, int err, struct sockaddr *addr,
         SOCK_EV_PRELUDE(SOCK_EV_ACCEPT, SockEvAccept);
 
         if (ret != -1 && addr) fill_addr(&(ev->addr), addr, *addr_len);
+        account_consume(sock, (SockEvent *)ev);
         if (ret != -1) DUP_SOCKET(SOCK_EV_ACCEPT, SockEvAccept);
 
         SOCK_EV_POSTLUDE(SOCK_EV_ACCEPT);
@@ -646,6 +1260,7 @@ void sock_ev_accept4(int fd, int ret, int err, struct sockaddr *addr,
 
         if (ret != -1 && addr) fill_addr(&(ev->addr), addr, *addr_len);
         ev->flags = flags;
+        account_consume(sock, (SockEvent *)ev);
         if (ret != -1) DUP_SOCKET(SOCK_EV_ACCEPT4, SockEvAccept4);
 
         SOCK_EV_POSTLUDE(SOCK_EV_ACCEPT4);
@@ -667,6 +1282,11 @@ void sock_ev_setsockopt(int fd, int ret, int err, int level, int optname,
         SOCK_EV_PRELUDE(SOCK_EV_SETSOCKOPT, SockEvSetsockopt);
 
         fill_sockopt(&ev->sockopt, level, optname, optval, optlen, false, fd);
+        if (!ret) nagle_on_setsockopt(&sock->nagle, level, optname, optval,
+                                      optlen);
+        Timestamping *ts = sock_timestamping(sock);
+        if (!ret && ts) ts_on_setsockopt(ts, level, optname);
+        if (!ret) udp_on_setsockopt(&sock->udp, level, optname, optval, optlen);
 
         SOCK_EV_POSTLUDE(SOCK_EV_SETSOCKOPT);
 }
@@ -680,6 +1300,7 @@ void sock_ev_send(int fd, int ret, int err, const void *buf, size_t bytes,
         ev->bytes = bytes;
         ev->flags = flags;
         sock->bytes_sent += bytes;
+        account_data(sock, true, ret, bytes, flags, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_SEND);
 }
@@ -693,6 +1314,7 @@ void sock_ev_recv(int fd, int ret, int err, void *buf, size_t bytes,
         ev->bytes = bytes;
         ev->flags = flags;
         sock->bytes_received += bytes;
+        account_data(sock, false, ret, bytes, flags, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_RECV);
 }
@@ -706,7 +1328,10 @@ void sock_ev_sendto(int fd, int ret, int err, const void *buf, size_t bytes,
         ev->bytes = bytes;
         ev->flags = flags;
         sock->bytes_sent += bytes;
+        account_data(sock, true, ret, bytes, flags, 0, (SockEvent *)ev);
         if (addr) fill_addr(&(ev->addr), addr, len);
+        DROP_IF_PER_PEER(account_peer(sock, true, ret, addr, len,
+                                      (SockEvent *)ev));
 
         SOCK_EV_POSTLUDE(SOCK_EV_SENDTO);
 }
@@ -720,7 +1345,10 @@ void sock_ev_recvfrom(int fd, int ret, int err, void *buf, size_t bytes,
         ev->bytes = bytes;
         ev->flags = flags;
         sock->bytes_received += bytes;
+        account_data(sock, false, ret, bytes, flags, 0, (SockEvent *)ev);
         if (ret != -1 && addr) fill_addr(&(ev->addr), addr, *len);
+        DROP_IF_PER_PEER(account_peer(sock, false, ret, addr, len ? *len : 0,
+                                      (SockEvent *)ev));
 
         SOCK_EV_POSTLUDE(SOCK_EV_RECVFROM);
 }
@@ -733,6 +1361,9 @@ void sock_ev_sendmsg(int fd, int ret, int err, const struct msghdr *msg,
         ev->bytes = fill_msghdr(&ev->msghdr, msg);
         ev->flags = flags;
         sock->bytes_sent += ev->bytes;
+        account_data(sock, true, ret, ev->bytes, flags, 0, (SockEvent *)ev);
+        DROP_IF_PER_PEER(account_peer(sock, true, ret, msg->msg_name,
+                                      msg->msg_namelen, (SockEvent *)ev));
 
         SOCK_EV_POSTLUDE(SOCK_EV_SENDMSG);
 }
@@ -745,6 +1376,11 @@ void sock_ev_recvmsg(int fd, int ret, int err, const struct msghdr *msg,
         ev->bytes = fill_msghdr(&ev->msghdr, msg);
         ev->flags = flags;
         sock->bytes_received += ev->bytes;
+        account_data(sock, false, ret, ev->bytes, flags, 0, (SockEvent *)ev);
+        Timestamping *ts = sock_timestamping(sock);
+        if (ts && (flags & MSG_ERRQUEUE)) ts_on_app_errqueue(ts);
+        DROP_IF_PER_PEER(account_peer(sock, false, ret, msg->msg_name,
+                                      msg->msg_namelen, (SockEvent *)ev));
 
         SOCK_EV_POSTLUDE(SOCK_EV_RECVMSG);
 }
@@ -763,6 +1399,15 @@ void sock_ev_sendmmsg(int fd, int ret, int err, const struct mmsghdr *vmessages,
         ev->bytes = fill_mmsghdr_vec(ev->mmsghdr_vec, vmessages, vlen);
 
         sock->bytes_sent += ev->bytes;
+        account_mmsg(sock, true, ret, vmessages, flags, (SockEvent *)ev);
+        bool accounted = false;
+        for (int i = 0; i < ret; i++) {
+                const struct msghdr *h = &vmessages[i].msg_hdr;
+                accounted |= account_peer(sock, true, vmessages[i].msg_len,
+                                          h->msg_name, h->msg_namelen,
+                                          (SockEvent *)ev);
+        }
+        DROP_IF_PER_PEER(accounted);
         SOCK_EV_POSTLUDE(SOCK_EV_SENDMMSG);
 }
 
@@ -781,6 +1426,17 @@ void sock_ev_recvmmsg(int fd, int ret, int err, const struct mmsghdr *vmessages,
         ev->bytes = fill_mmsghdr_vec(ev->mmsghdr_vec, vmessages, vlen);
 
         sock->bytes_received += ev->bytes;
+        account_mmsg(sock, false, ret, vmessages, flags, (SockEvent *)ev);
+        Timestamping *ts = sock_timestamping(sock);
+        if (ts && (flags & MSG_ERRQUEUE)) ts_on_app_errqueue(ts);
+        bool accounted = false;
+        for (int i = 0; i < ret; i++) {
+                const struct msghdr *h = &vmessages[i].msg_hdr;
+                accounted |= account_peer(sock, false, vmessages[i].msg_len,
+                                          h->msg_name, h->msg_namelen,
+                                          (SockEvent *)ev);
+        }
+        DROP_IF_PER_PEER(accounted);
         SOCK_EV_POSTLUDE(SOCK_EV_RECVMMSG);
 }
 
@@ -828,6 +1484,7 @@ void sock_ev_write(int fd, int ret, int err, const void *buf, size_t bytes) {
 
         ev->bytes = bytes;
         sock->bytes_sent += bytes;
+        account_data(sock, true, ret, bytes, 0, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_WRITE);
 }
@@ -839,6 +1496,7 @@ void sock_ev_read(int fd, int ret, int err, void *buf, size_t bytes) {
 
         ev->bytes = bytes;
         sock->bytes_received += bytes;
+        account_data(sock, false, ret, bytes, 0, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_READ);
 }
@@ -846,6 +1504,10 @@ void sock_ev_read(int fd, int ret, int err, void *buf, size_t bytes) {
 void sock_ev_close(int fd, int ret, int err) {
         // Inst. local vars Socket *sock & SockEvClose *ev
         SOCK_EV_PRELUDE(SOCK_EV_CLOSE, SockEvClose);
+        Waterfall *wf = sock->cold->analyses.waterfall;
+        if (wf)
+                wf_on_close(wf, call_start(&ev->super),
+                            ev->super.timestamp_usec);
         SOCK_EV_POSTLUDE(SOCK_EV_CLOSE);
         free_and_dump_socket(fd);
 }
@@ -887,6 +1549,7 @@ void sock_ev_writev(int fd, int ret, int err, const struct iovec *iovec,
 
         ev->bytes = fill_iovec(&ev->iovec, iovec, iovec_count);
         sock->bytes_sent += ev->bytes;
+        account_data(sock, true, ret, ev->bytes, 0, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_WRITEV);
 }
@@ -898,6 +1561,7 @@ void sock_ev_readv(int fd, int ret, int err, const struct iovec *iovec,
 
         ev->bytes = fill_iovec(&ev->iovec, iovec, iovec_count);
         sock->bytes_received += ev->bytes;
+        account_data(sock, false, ret, ev->bytes, 0, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_READV);
 }
@@ -924,6 +1588,7 @@ void sock_ev_sendfile(int fd, int ret, int err, int in_fd, off_t *offset,
 
         ev->bytes = bytes;
         sock->bytes_received += ev->bytes;
+        account_data(sock, true, ret, ev->bytes, 0, 0, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_SENDFILE);
 }
@@ -937,6 +1602,7 @@ void sock_ev_poll(int fd, int ret, int err, short requested_events,
         ev->timeout.nanoseconds = (timeout % 1000) * 1000;
         fill_poll_events(&ev->requested_events, requested_events);
         fill_poll_events(&ev->returned_events, returned_events);
+        if (returned_events & POLLIN) account_wakeup(sock, -1, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_POLL);
 }
@@ -950,6 +1616,7 @@ void sock_ev_ppoll(int fd, int ret, int err, short requested_events,
         ev->timeout.nanoseconds = timeout ? timeout->tv_nsec : 0;
         fill_poll_events(&ev->requested_events, requested_events);
         fill_poll_events(&ev->returned_events, returned_events);
+        if (returned_events & POLLIN) account_wakeup(sock, -1, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_PPOLL);
 }
@@ -968,6 +1635,7 @@ void sock_ev_select(int fd, int ret, int err, bool req_read, bool req_write,
         ev->returned_events.read = ret_read;
         ev->returned_events.write = ret_write;
         ev->returned_events.except = ret_except;
+        if (ret_read) account_wakeup(sock, -1, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_SELECT);
 }
@@ -986,6 +1654,7 @@ void sock_ev_pselect(int fd, int ret, int err, bool req_read, bool req_write,
         ev->returned_events.read = ret_read;
         ev->returned_events.write = ret_write;
         ev->returned_events.except = ret_except;
+        if (ret_read) account_wakeup(sock, -1, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_PSELECT);
 }
@@ -1061,24 +1730,30 @@ void sock_ev_epoll_ctl(int fd, int ret, int err, int op,
         SOCK_EV_POSTLUDE(SOCK_EV_EPOLL_CTL);
 }
 
-void sock_ev_epoll_wait(int fd, int ret, int err, int timeout,
+void sock_ev_epoll_wait(int fd, int ret, int err, int epfd, int timeout,
                         uint32_t returned_events) {
         // Inst. local vars Socket *sock & SockEvEpollWait *ev
         SOCK_EV_PRELUDE(SOCK_EV_EPOLL_WAIT, SockEvEpollWait);
 
+        ev->epfd = epfd;
         ev->returned_events = returned_events;
         ev->timeout = timeout;
+        if (returned_events & EPOLLIN)
+                account_wakeup(sock, epfd, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_EPOLL_WAIT);
 }
 
-void sock_ev_epoll_pwait(int fd, int ret, int err, int timeout,
+void sock_ev_epoll_pwait(int fd, int ret, int err, int epfd, int timeout,
                          uint32_t returned_events) {
         // Inst. local vars Socket *sock & SockEvEpollPwait *ev
         SOCK_EV_PRELUDE(SOCK_EV_EPOLL_PWAIT, SockEvEpollPwait);
 
+        ev->epfd = epfd;
         ev->returned_events = returned_events;
         ev->timeout = timeout;
+        if (returned_events & EPOLLIN)
+                account_wakeup(sock, epfd, (SockEvent *)ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_EPOLL_PWAIT);
 }
@@ -1095,7 +1770,8 @@ void sock_ev_fdopen(int fd, FILE *_ret, int err, const char *mode) {
         SOCK_EV_POSTLUDE(SOCK_EV_FDOPEN);
 }
 
-void sock_ev_tcp_info(int fd, int ret, int err, struct tcp_info *info) {
+void sock_ev_tcp_info(int fd, int ret, int err, struct tcp_info *info,
+                      const SockQueues *queues, const CcSample *cc) {
         // Inst. local vars Socket *sock & SockEvTcpInfo *ev
         SOCK_EV_PRELUDE(SOCK_EV_TCP_INFO, SockEvTcpInfo);
         LOG_FUNC_INFO;
@@ -1104,17 +1780,89 @@ void sock_ev_tcp_info(int fd, int ret, int err, struct tcp_info *info) {
         sock->last_info_dump_bytes = sock->bytes_sent + sock->bytes_received;
         sock->last_info_dump_micros = get_time_micros();
         sock->rtt = info->tcpi_rtt;
+        sock->nagle.snd_mss = info->tcpi_snd_mss;
         free(info);
+        ev->queues = *queues;
+        SockQueuesStats *stats = sock_queues(sock);
+        if (stats && queues->outq >= 0) histo_add(&stats->outq, queues->outq);
+        if (stats && queues->outq_nsd >= 0)
+                histo_add(&stats->outq_nsd, queues->outq_nsd);
+        if (stats && queues->inq >= 0) histo_add(&stats->inq, queues->inq);
+        ev->cc = *cc;
+        CcStats *cc_stats = sock_cc(sock);
+        if (cc_stats) cc_add_sample(cc_stats, cc);
+        account_retransmissions(sock, ev);
+        detect_anomalies(sock, ev);
 
         SOCK_EV_POSTLUDE(SOCK_EV_TCP_INFO);
 }
 
-void dump_all_sock_events(void) {
+void sock_ev_meminfo(int fd, int ret, int err, const MemSample *sample) {
+        // Inst. local vars Socket *sock & SockEvMeminfo *ev
+        SOCK_EV_PRELUDE(SOCK_EV_MEMINFO, SockEvMeminfo);
+
+        ev->sample = *sample;
+        if (!ret) {
+                mem_add_sample(&sock->memory, sample, ev->super.timestamp_usec,
+                               &ev->interval);
+        } else if (!sock->memory.unsupported) {
+                LOG(WARN, "SO_MEMINFO failed. %s.", strerror(err));
+                sock->memory.unsupported = true;
+        }
+
+        SOCK_EV_POSTLUDE(SOCK_EV_MEMINFO);
+}
+
+static void dump_sock_events(int fd, int node) {
+        Socket *socket = ra_get_and_lock_elem(fd);
+        if (socket && (node == -1 || socket->node == node))
+                dump_events_as_json(socket);
+        ra_unlock_elem(fd);
+}
+
+void dump_all_sock_events(int node) {
+        LOG_FUNC_INFO;
+        if (node == -1) {
+                for (long i = 0; i < ra_get_size(); i++)
+                        if (ra_is_present(i)) dump_sock_events(i, node);
+                return;
+        }
+
+        // The sockets are locked after the list, which a socket may leave in
+        // the meantime: copy the fds of the node first.
+        mutex_lock(&node_sockets_mutex);
+        int count = node_sockets_count[node];
+        int *fds = (int *)my_malloc(sizeof(int) * (count + 1));
+        if (!fds) goto error;
+        int i = 0;
+        for (Socket *s = node_sockets[node]; s; s = s->node_next)
+                fds[i++] = s->fd;
+        mutex_unlock(&node_sockets_mutex);
+
+        for (i = 0; i < count; i++) dump_sock_events(fds[i], node);
+        free(fds);
+        return;
+error:
+        mutex_unlock(&node_sockets_mutex);
+        LOG_FUNC_ERROR;
+}
+
+void sample_all_listeners(void) {
+        for (long i = 0; i < ra_get_size(); i++) {
+                if (!ra_is_present(i)) continue;
+                Socket *socket = ra_get_and_lock_elem(i);
+                if (socket && socket->listening) sample_accept_queue(socket);
+                ra_unlock_elem(i);
+        }
+}
+
+void summarize_all_sockets(void) {
         LOG_FUNC_INFO;
         for (long i = 0; i < ra_get_size(); i++) {
                 if (!ra_is_present(i)) continue;
+                if (can_sample_meminfo(i)) dump_meminfo(i);
                 Socket *socket = ra_get_and_lock_elem(i);
-                if (socket) dump_events_as_json(socket);
+                if (socket) push_summary(socket);
                 ra_unlock_elem(i);
         }
 }
@@ -1122,14 +1870,20 @@ void dump_all_sock_events(void) {
 void sock_ev_free(void) {
         ra_free();
         pthread_mutex_destroy(&connections_count_mutex);
+        pthread_mutex_destroy(&node_sockets_mutex);
 }
 
 void sock_ev_reset(void) {
         mutex_init(&connections_count_mutex);
         connections_count = 0;
+        // The lists may have been left half updated by another thread.
+        mutex_init(&node_sockets_mutex);
+        memset(node_sockets, 0, sizeof(node_sockets));
+        memset(node_sockets_count, 0, sizeof(node_sockets_count));
         for (long i = 0; i < ra_get_size(); i++) {
                 if (!ra_is_present(i)) continue;
                 Socket *sock = ra_remove_elem(i);
+                sock->node = -1;  // Not listed anymore.
                 sock_ev_forked_socket(i, &sock->sock_info);
                 free_socket(sock);
         }
@@ -5,10 +5,29 @@
 #include <pcap/pcap.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <time.h>
+#include "accept_queue.h"
+#include "anomalies.h"
+#include "cc_info.h"
+#include "concurrency.h"
+#include "cpu_affinity.h"
+#include "lib.h"
+#include "local_ports.h"
+#include "nagle_advisor.h"
+#include "name_resolution.h"
+#include "packet_sniffer.h"
+#include "request_response.h"
+#include "retransmissions.h"
+#include "sock_memory.h"
+#include "timestamping.h"
+#include "udp_flows.h"
+#include "udp_offload.h"
+#include "wakeups.h"
+#include "waterfall.h"
 
 typedef enum SockEventType {
         SOCK_EV_SOCKET,
@@ -65,7 +84,11 @@ typedef enum SockEventType {
         // stdio.h
         SOCK_EV_FDOPEN,
         // others
-        SOCK_EV_TCP_INFO
+        SOCK_EV_TCP_INFO,
+        SOCK_EV_TX_TIMESTAMPS,
+        SOCK_EV_MEMINFO,
+        SOCK_EV_ANOMALY,
+        SOCK_EV_SUMMARY
 } SockEventType;
 
 typedef struct {
@@ -76,6 +99,11 @@ typedef struct {
         int err;
         long id;
         pid_t thread_id;
+        int cpu;  // CPU on which the call returned, -1 if unknown.
+        const void *call_site;  // Return address in the caller, or NULL.
+        unsigned long start_usec;  // Start of the call, with call_site.
+        void **stack;           // Sampled stack of the call (-r), or NULL.
+        int stack_depth;
 } SockEvent;
 
 typedef struct {
@@ -85,6 +113,11 @@ typedef struct {
         bool sock_cloexec;
         bool sock_nonblock;
         bool filled;
+        // Identity of the kernel socket, shared by the fds of all processes
+        // that refer to it (dup(), fork(), SCM_RIGHTS): SO_COOKIE (0 if not
+        // supported) and inode number (as in /proc/<pid>/fd).
+        uint64_t cookie;
+        unsigned long inode;
 } SockInfo;
 
 typedef struct {
@@ -119,6 +152,7 @@ typedef struct {
 typedef struct {
         SockEvent super;
         Addr addr;
+        DnsLink dns;  // Name resolution that returned addr, if any.
 } SockEvConnect;
 
 typedef struct {
@@ -377,12 +411,14 @@ typedef struct {
 
 typedef struct {
         SockEvent super;
+        int epfd;
         int timeout;
         uint32_t returned_events;
 } SockEvEpollWait;
 
 typedef struct {
         SockEvent super;
+        int epfd;
         int timeout;
         uint32_t returned_events;
 } SockEvEpollPwait;
@@ -392,35 +428,135 @@ typedef struct {
         char *mode;
 } SockEvFdopen;
 
+// Bytes in the socket queues, -1 if unavailable. See tcp(7).
+typedef struct {
+        int outq;      // SIOCOUTQ: bytes not acknowledged yet (incl. unsent).
+        int outq_nsd;  // SIOCOUTQNSD: bytes not sent yet.
+        int inq;       // SIOCINQ: bytes not read yet by the application.
+} SockQueues;
+
+typedef struct {
+        Histogram outq;
+        Histogram outq_nsd;
+        Histogram inq;
+} SockQueuesStats;
+
 typedef struct {
         SockEvent super;
         struct tcp_info info;
+        SockQueues queues;
+        CcSample cc;
+        int retrans_count;
+        RetxReport *retrans;  // Sends completed with retransmitted bytes.
 } SockEvTcpInfo;
 
+/* Fake event pushed when kernel timestamps (-x) complete send calls. */
+typedef struct {
+        SockEvent super;
+        int sends_count;
+        TsSend *sends;
+} SockEvTxTimestamps;
+
+typedef struct {
+        SockEvent super;
+        MemSample sample;
+        MemInterval interval;
+} SockEvMeminfo;
+
+/* Fake event pushed when a TCP_INFO sample reveals a degradation. */
+typedef struct {
+        SockEvent super;
+        Anomaly anomaly;
+} SockEvAnomaly;
+
+/* State of the analyses that take more than a few cache lines. Each is
+ * allocated on first use, and only if its option is on: NULL otherwise. It
+ * moves from the socket to its summary event, which frees it. */
+typedef struct {
+        ReqResp *rr;
+        Wakeups *wakeups;
+        CpuAffinity *cpu_affinity;
+        Concurrency *concurrency;
+        Timestamping *timestamping;        // With -x.
+        SockQueuesStats *queues;           // With -b or -u.
+        Retransmissions *retransmissions;  // TCP, with -b or -u.
+        Anomalies *anomalies;              // TCP, with -b or -u.
+        CcStats *cc;                       // TCP, with -b or -u.
+        Waterfall *waterfall;              // TCP, if connected or accepted.
+} SockAnalyses;
+
+/* Fake event pushed when a socket is closed (or when the process exits) that
+ * holds the per-connection statistics computed online. */
+typedef struct {
+        SockEvent super;
+        unsigned long bytes_sent;
+        unsigned long bytes_received;
+        bool stream;  // SOCK_STREAM socket.
+        NagleAdvisor nagle;
+        bool listening;
+        bool dgram_connected;  // Datagram socket with a default peer.
+        AcceptQueue accept_queue;
+        SockMemory memory;
+        UdpOffload udp;
+        UdpFlows flows;  // Owned by the event.
+        // Owned by the event: rr, wakeups, cpu_affinity and concurrency are
+        // always set.
+        SockAnalyses analyses;
+        int config_id;
+} SockEvSummary;
+
 typedef struct SockEventNode SockEventNode;
 struct SockEventNode {
         SockEvent *data;
         SockEventNode *next;
 };
 
+// Rarely used state of a socket, allocated apart so that it does not dilute
+// the cache lines written by each call.
 typedef struct {
-        // To be freed
-        SockEventNode *head;  // Head for list of events.
+        bool bound;
+        struct sockaddr_storage bound_addr;
+        CaptureSwitch *capture_switch;
+        SockAnalyses analyses;
+} SockCold;
+
+/* A socket is only accessed under its lock (see resizable_array.h), but
+ * threads working on different sockets must not write to the same cache line:
+ * the struct is aligned on a cache line, which it does not share with any
+ * other allocation, and the fields written by most calls come first, followed
+ * by the fields read by most calls. The larger state of the analyses is in
+ * the cold part (see SockAnalyses). */
+typedef struct Socket {
+        // Hot: written by most calls.
+        SockEventNode *head;  // Head for list of events. To be freed.
         SockEventNode *tail;  // Tail for list of events.
-        // Others
-        int id;
-        int fd;
-        SockInfo sock_info;
         long events_count;
         unsigned long bytes_sent;      // Total bytes sent.
         unsigned long bytes_received;  // Total bytes received.
         long last_info_dump_micros;  // Time of last info dump in microseconds.
         long last_info_dump_bytes;   // Total bytes (sent+recv) at last dump.
-        bool bound;
-        struct sockaddr_storage bound_addr;
+        // Read by most calls, written once.
+        int id;
+        int fd;
+        SockInfo sock_info;
+        SockCold *cold;  // To be freed.
+        // Per feature state.
         int rtt;
-        bool *capture_switch;
-} Socket;
+        bool accepted;  // Created by accept() (or dup of such a socket).
+        bool listening;
+        bool dgram_connected;  // Datagram socket with a default peer.
+        AcceptQueue accept_queue;  // Only sampled for listening sockets.
+        NagleAdvisor nagle;
+        SockMemory memory;  // Only sampled with -m.
+        UdpOffload udp;     // Only for datagram sockets.
+        UdpFlows flows;     // Peers of an unconnected datagram socket.
+        SockPort port;      // Ephemeral port usage, if connected.
+        int config_id;  // See sock_config.h, -1 until connected or accepted.
+        // List of the sockets of a NUMA node (see dump_all_sock_events).
+        int node;  // Node of the last event, -1 if not listed.
+        struct Socket *node_prev;
+        struct Socket *node_next;
+} CACHE_ALIGNED Socket;
 
 const char *string_from_sock_event_type(SockEventType type);
 
@@ -430,6 +566,9 @@ void free_socket(Socket *con);
 
 void sock_start_capture(int fd, const struct sockaddr *connect_addr);
 
+// Called by close() before closing a socket, while its state can be read.
+void sock_before_close(int fd);
+
 // Events hooks
 
 void sock_ev_socket(int fd, int domain, int type, int protocol);
@@ -537,17 +676,27 @@ void sock_ev_fcntl(int fd, int ret, int err, int cmd, ...);
 void sock_ev_epoll_ctl(int fd, int ret, int err, int op,
                        uint32_t requested_events);
 
-void sock_ev_epoll_wait(int fd, int ret, int err, int timeout,
+void sock_ev_epoll_wait(int fd, int ret, int err, int epfd, int timeout,
                         uint32_t returned_events);
 
-void sock_ev_epoll_pwait(int fd, int ret, int err, int timeout,
+void sock_ev_epoll_pwait(int fd, int ret, int err, int epfd, int timeout,
                          uint32_t returned_events);
 
 void sock_ev_fdopen(int fd, FILE *ret, int err, const char *mode);
 
-void sock_ev_tcp_info(int fd, int ret, int err, struct tcp_info *info);
+void sock_ev_tcp_info(int fd, int ret, int err, struct tcp_info *info,
+                      const SockQueues *queues, const CcSample *cc);
+
+void sock_ev_meminfo(int fd, int ret, int err, const MemSample *sample);
+
+// Dumps the sockets whose last event was processed on a NUMA node, or all the
+// sockets if node is -1.
+void dump_all_sock_events(int node);
+
+void sample_all_listeners(void);  // Sample accept queues of listeners.
 
-void dump_all_sock_events(void);
+// Push a summary event on every open socket (called at process exit).
+void summarize_all_sockets(void);
 
 void sock_ev_free(void);  // Free state.
 // Free state and restore to default state (called after fork()).
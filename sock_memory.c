@@ -0,0 +1,75 @@
+#define _GNU_SOURCE
+
+#include "sock_memory.h"
+#include <linux/sock_diag.h>
+#include <stdint.h>
+#include <string.h>
+#include "lib.h"
+
+/* Public functions */
+
+bool mem_fill_sample(int fd, MemSample *sample) {
+#ifdef SO_MEMINFO
+        uint32_t meminfo[SK_MEMINFO_VARS];
+        socklen_t len = sizeof(meminfo);
+        memset(meminfo, 0, sizeof(meminfo));
+        if (!get_sockopt_if_supported(fd, SOL_SOCKET, SO_MEMINFO, meminfo,
+                                      &len))
+                return false;
+        sample->rmem_alloc = meminfo[SK_MEMINFO_RMEM_ALLOC];
+        sample->rcvbuf = meminfo[SK_MEMINFO_RCVBUF];
+        sample->wmem_alloc = meminfo[SK_MEMINFO_WMEM_ALLOC];
+        sample->sndbuf = meminfo[SK_MEMINFO_SNDBUF];
+        sample->backlog = meminfo[SK_MEMINFO_BACKLOG];
+        sample->drops = meminfo[SK_MEMINFO_DROPS];
+        return true;
+#else
+        UNUSED(fd);
+        UNUSED(sample);
+        return false;
+#endif
+}
+
+void mem_add_sample(SockMemory *mem, const MemSample *sample,
+                    unsigned long time_usec, MemInterval *interval) {
+        memset(interval, 0, sizeof(MemInterval));
+        if (mem->samples) {
+                interval->interval_usec =
+                    time_usec > mem->last_sample_usec
+                        ? time_usec - mem->last_sample_usec
+                        : 0;
+                interval->new_drops = sample->drops - mem->last.drops;
+                interval->recv_calls =
+                    mem->recv_calls - mem->recv_calls_at_sample;
+                mem->sampled_recv_calls += interval->recv_calls;
+                mem->drops_while_traced += interval->new_drops;
+                if (interval->new_drops) {
+                        mem->drop_intervals++;
+                        mem->drop_intervals_recv_calls += interval->recv_calls;
+                        mem->drop_intervals_usec += interval->interval_usec;
+                }
+        } else {
+                mem->first_sample_usec = time_usec;
+        }
+
+        mem->samples++;
+        mem->last_sample_usec = time_usec;
+        mem->last = *sample;
+        mem->recv_calls_at_sample = mem->recv_calls;
+        if (sample->rmem_alloc > mem->rmem_high_water)
+                mem->rmem_high_water = sample->rmem_alloc;
+        if (sample->wmem_alloc > mem->wmem_high_water)
+                mem->wmem_high_water = sample->wmem_alloc;
+}
+
+void mem_on_recv_call(SockMemory *mem) { mem->recv_calls++; }
+
+double mem_recv_rate(const SockMemory *mem) {
+        unsigned long usec = mem->last_sample_usec - mem->first_sample_usec;
+        return usec ? mem->sampled_recv_calls * 1000000.0 / usec : 0;
+}
+
+double mem_drop_intervals_recv_rate(const SockMemory *mem) {
+        unsigned long usec = mem->drop_intervals_usec;
+        return usec ? mem->drop_intervals_recv_calls * 1000000.0 / usec : 0;
+}
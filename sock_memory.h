@@ -0,0 +1,60 @@
+#ifndef SOCK_MEMORY_H
+#define SOCK_MEMORY_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+/* Memory of a socket, sampled with SO_MEMINFO every -m milliseconds, and
+ * datagrams dropped because the receive buffer was full. The drops are counted
+ * by the kernel (SK_MEMINFO_DROPS). SO_RXQ_OVFL would report them too, but in
+ * a control message added to the recvmsg() of the application. Drops are
+ * related to the rate of the receive calls of the application: drops with a
+ * low call rate point to a reader too slow, or stalled. */
+
+typedef struct {
+        unsigned int rmem_alloc;  // Bytes in the receive queue (truesize).
+        unsigned int rcvbuf;
+        unsigned int wmem_alloc;  // Bytes in the send queue (truesize).
+        unsigned int sndbuf;
+        unsigned int backlog;  // Bytes in the backlog, while the socket is
+                               // owned by a thread.
+        unsigned int drops;    // Drops since the creation of the socket.
+} MemSample;
+
+// Between a sample and the previous one.
+typedef struct {
+        unsigned long interval_usec;  // 0 for the first sample.
+        unsigned int new_drops;
+        long recv_calls;
+} MemInterval;
+
+typedef struct {
+        long samples;
+        unsigned long first_sample_usec;
+        unsigned long last_sample_usec;
+        MemSample last;
+        unsigned int rmem_high_water;
+        unsigned int wmem_high_water;
+        long recv_calls;            // Receive calls, sampled or not.
+        long recv_calls_at_sample;  // recv_calls at the last sample.
+        long sampled_recv_calls;    // Receive calls between the samples.
+        long drop_intervals;        // Intervals with new drops.
+        long drop_intervals_recv_calls;
+        unsigned long drop_intervals_usec;
+        unsigned long drops_while_traced;  // New drops between the samples.
+        bool unsupported;        // SO_MEMINFO failed, stop sampling.
+} SockMemory;
+
+bool mem_fill_sample(int fd, MemSample *sample);
+
+void mem_add_sample(SockMemory *mem, const MemSample *sample,
+                    unsigned long time_usec, MemInterval *interval);
+
+void mem_on_recv_call(SockMemory *mem);
+
+// Receive calls per second, over the sampled time or over the intervals with
+// drops.
+double mem_recv_rate(const SockMemory *mem);
+double mem_drop_intervals_recv_rate(const SockMemory *mem);
+
+#endif
@@ -296,6 +296,18 @@ error:
 #endif
 }
 
+// Same as alloc_str_opt() for an optional string: NULL if unset or empty.
+char *alloc_str_opt_or_null(const char *opt) {
+#ifdef __ANDROID__
+        char prop[PROP_VALUE_MAX + 1];
+        if (!__system_property_get(opt, prop)) return NULL;
+        return strdup(prop);
+#else
+        char *env_val = get_str_env(opt);
+        return env_val ? strdup(env_val) : NULL;
+#endif
+}
+
 char *alloc_iface_name(int fd, int iface_index) {
         struct ifreq ifr;
         ifr.ifr_ifindex = iface_index;
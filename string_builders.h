@@ -29,5 +29,7 @@ char *alloc_property(const char *property);
 
 char *alloc_str_opt(const char *opt);
 
+char *alloc_str_opt_or_null(const char *opt);
+
 char *alloc_iface_name(int fd, int iface_index);
 #endif
@@ -0,0 +1,320 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <jansson.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "columnar.h"
+
+/* Converts the JSON traces of a process (the <n>.json files of its directory)
+ * into a columnar table per event type, <type>.tcol (see columnar.h). Each
+ * row is an event, with a "socket" column holding the number of its trace.
+ *
+ * The traces are read line by line and never loaded as a whole. Worker threads
+ * take whole traces in turn: each buffers the events of each type up to the
+ * size of a row group, encodes the row group, and appends it to the table of
+ * the type under the lock of that table. The row groups of the traces are
+ * thus interleaved in the tables, and the memory used is bounded by the number
+ * of workers times the number of types times the size of a row group. */
+
+#define TYPES_MAX 128
+#define TYPE_LEN 32
+#define DEFAULT_ROWS 8192
+
+typedef struct {
+        char type[TYPE_LEN];
+        FILE *fp;
+        long rows;
+        bool failed;
+        pthread_mutex_t mutex;
+} Output;
+
+typedef struct {
+        char type[TYPE_LEN];
+        ColTable table;
+} Pending;
+
+typedef struct {
+        pthread_t thread;
+        Pending pending[TYPES_MAX];
+        int pending_count;
+        ColBuf buf;
+        long events;
+        long errors;   // Lines that are not events.
+        long dropped;  // Rows of the tables that could not be opened.
+} Worker;
+
+static const char *in_dir;
+static const char *out_dir;
+static int rows_per_group = DEFAULT_ROWS;
+
+static int *traces;
+static int traces_count = 0;
+static int next_trace = 0;
+static pthread_mutex_t traces_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static Output outputs[TYPES_MAX];
+static int outputs_count = 0;
+static pthread_mutex_t outputs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Private functions */
+
+static void usage(const char *name) {
+        fprintf(stderr,
+                "Usage: %s [-j <threads>] [-r <rows>] <trace_dir> <out_dir>\n"
+                "Converts the JSON traces of <trace_dir>, the directory of "
+                "a process, into\na columnar table per event type in "
+                "<out_dir>.\n"
+                "  -j <threads>  number of worker threads (default: CPUs)\n"
+                "  -r <rows>     rows per row group (default: %d)\n",
+                name, DEFAULT_ROWS);
+}
+
+static bool parse_int(const char *str, int *val) {
+        char *end;
+        errno = 0;
+        long l = strtol(str, &end, 10);
+        if (errno || end == str || *end || l <= 0 || l > 1 << 24) return false;
+        *val = (int)l;
+        return true;
+}
+
+// Event types are also file names.
+static bool is_valid_type(const char *type) {
+        size_t len = strlen(type);
+        if (!len || len >= TYPE_LEN) return false;
+        for (size_t i = 0; i < len; i++)
+                if (!(type[i] >= 'a' && type[i] <= 'z') && type[i] != '_' &&
+                    !(type[i] >= '0' && type[i] <= '9'))
+                        return false;
+        return true;
+}
+
+static int compare_ints(const void *a, const void *b) {
+        return *(const int *)a - *(const int *)b;
+}
+
+// Lists the <n>.json files, in order.
+static bool list_traces(void) {
+        DIR *dir = opendir(in_dir);
+        if (!dir) goto error;
+        int cap = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+                int id;
+                char end[8];
+                if (sscanf(entry->d_name, "%d%7s", &id, end) != 2 ||
+                    strcmp(end, ".json") || id < 0)
+                        continue;
+                if (traces_count == cap) {
+                        cap = cap ? cap * 2 : 64;
+                        traces = (int *)realloc(traces, cap * sizeof(int));
+                        if (!traces) abort();
+                }
+                traces[traces_count++] = id;
+        }
+        closedir(dir);
+        qsort(traces, traces_count, sizeof(int), compare_ints);
+        return true;
+error:
+        fprintf(stderr, "opendir(%s) failed. %s.\n", in_dir, strerror(errno));
+        return false;
+}
+
+static Output *get_output(const char *type) {
+        Output *out = NULL;
+        pthread_mutex_lock(&outputs_mutex);
+        for (int i = 0; i < outputs_count; i++)
+                if (!strcmp(outputs[i].type, type)) {
+                        out = &outputs[i];
+                        goto exit;
+                }
+        if (outputs_count == TYPES_MAX) goto exit;
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s.tcol", out_dir, type);
+        FILE *fp = fopen(path, "w");
+        if (!fp) {
+                fprintf(stderr, "fopen(%s) failed. %s.\n", path,
+                        strerror(errno));
+                goto exit;
+        }
+        out = &outputs[outputs_count++];
+        strcpy(out->type, type);
+        out->fp = fp;
+        out->rows = 0;
+        pthread_mutex_init(&out->mutex, NULL);
+
+        ColBuf header = {0};
+        col_buf_header(&header);
+        out->failed = fwrite(header.data, 1, header.len, fp) != header.len;
+        col_buf_free(&header);
+exit:
+        pthread_mutex_unlock(&outputs_mutex);
+        return out;
+}
+
+static void write_row_group(Worker *worker, Pending *pending) {
+        int rows = pending->table.count;
+        if (!rows) return;
+        worker->buf.len = 0;
+        col_table_encode(&pending->table, &worker->buf);
+        Output *out = get_output(pending->type);
+        if (!out) {
+                worker->dropped += rows;
+                return;
+        }
+        pthread_mutex_lock(&out->mutex);
+        if (fwrite(worker->buf.data, 1, worker->buf.len, out->fp) !=
+            worker->buf.len)
+                out->failed = true;
+        out->rows += rows;
+        pthread_mutex_unlock(&out->mutex);
+}
+
+static Pending *get_pending(Worker *worker, const char *type) {
+        for (int i = 0; i < worker->pending_count; i++)
+                if (!strcmp(worker->pending[i].type, type))
+                        return &worker->pending[i];
+        if (worker->pending_count == TYPES_MAX) return NULL;
+        Pending *pending = &worker->pending[worker->pending_count++];
+        strcpy(pending->type, type);
+        return pending;
+}
+
+static void add_event(Worker *worker, json_t *ev, int trace) {
+        const char *type = json_string_value(json_object_get(ev, "type"));
+        if (!type || !is_valid_type(type)) goto error;
+        Pending *pending = get_pending(worker, type);
+        if (!pending) goto error;
+        json_object_set_new(ev, "socket", json_integer(trace));
+        col_table_add(&pending->table, ev);
+        worker->events++;
+        if (pending->table.count >= rows_per_group)
+                write_row_group(worker, pending);
+        return;
+error:
+        worker->errors++;
+        json_decref(ev);
+}
+
+static void convert_trace(Worker *worker, int trace) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%d.json", in_dir, trace);
+        FILE *fp = fopen(path, "r");
+        if (!fp) {
+                fprintf(stderr, "fopen(%s) failed. %s.\n", path,
+                        strerror(errno));
+                worker->errors++;
+                return;
+        }
+        char *line = NULL;
+        size_t cap = 0;
+        while (getline(&line, &cap, fp) != -1) {
+                if (line[0] == '\n' || line[0] == '\0') continue;
+                json_error_t error;
+                json_t *ev = json_loads(line, 0, &error);
+                // The last line may be cut if the process was killed.
+                if (!ev || json_typeof(ev) != JSON_OBJECT) {
+                        worker->errors++;
+                        json_decref(ev);
+                        continue;
+                }
+                add_event(worker, ev, trace);
+        }
+        free(line);
+        fclose(fp);
+}
+
+static void *worker_thread(void *arg) {
+        Worker *worker = (Worker *)arg;
+        while (true) {
+                pthread_mutex_lock(&traces_mutex);
+                int i = next_trace < traces_count ? next_trace++ : -1;
+                pthread_mutex_unlock(&traces_mutex);
+                if (i == -1) break;
+                convert_trace(worker, traces[i]);
+        }
+        for (int i = 0; i < worker->pending_count; i++) {
+                write_row_group(worker, &worker->pending[i]);
+                col_table_free(&worker->pending[i].table);
+        }
+        col_buf_free(&worker->buf);
+        return NULL;
+}
+
+/* Public functions */
+
+int main(int argc, char **argv) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int threads = cpus > 0 ? (int)cpus : 1;
+        int opt;
+        while ((opt = getopt(argc, argv, "j:r:h")) != -1) {
+                switch (opt) {
+                        case 'j':
+                                if (!parse_int(optarg, &threads)) goto usage;
+                                break;
+                        case 'r':
+                                if (!parse_int(optarg, &rows_per_group))
+                                        goto usage;
+                                break;
+                        default:
+                                goto usage;
+                }
+        }
+        if (argc - optind != 2) goto usage;
+        in_dir = argv[optind];
+        out_dir = argv[optind + 1];
+
+        if (mkdir(out_dir, 0755) && errno != EEXIST) {
+                fprintf(stderr, "mkdir(%s) failed. %s.\n", out_dir,
+                        strerror(errno));
+                return EXIT_FAILURE;
+        }
+        if (!list_traces()) return EXIT_FAILURE;
+        if (threads > traces_count) threads = traces_count ? traces_count : 1;
+
+        Worker *workers = (Worker *)calloc(threads, sizeof(Worker));
+        if (!workers) abort();
+        for (int i = 0; i < threads; i++)
+                if (pthread_create(&workers[i].thread, NULL, worker_thread,
+                                   &workers[i])) {
+                        fprintf(stderr, "pthread_create() failed.\n");
+                        return EXIT_FAILURE;
+                }
+
+        long events = 0, errors = 0;
+        bool failed = false;
+        for (int i = 0; i < threads; i++) {
+                pthread_join(workers[i].thread, NULL);
+                events += workers[i].events;
+                errors += workers[i].errors;
+                if (workers[i].dropped) failed = true;
+        }
+        free(workers);
+        free(traces);
+
+        for (int i = 0; i < outputs_count; i++) {
+                if (fclose(outputs[i].fp) == EOF || outputs[i].failed)
+                        failed = true;
+                printf("%s: %ld rows\n", outputs[i].type, outputs[i].rows);
+        }
+        printf("%ld events of %d traces", events, traces_count);
+        if (errors) printf(", %ld lines skipped", errors);
+        printf(".\n");
+        if (failed) {
+                fprintf(stderr, "Could not write the tables.\n");
+                return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+usage:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+}
@@ -0,0 +1,56 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55559);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(sock, 1) < 0) {
+    fprintf(stderr, "listen() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  for (int i = 0; i < 2; i++) {
+    int client;
+    if ((client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+      fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    if (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+  usleep(300000);
+
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,52 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55555);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  struct pollfd fds = { .fd = sock, .events = POLLIN };
+  if (poll(&fds, 1, 100) != 0) {
+    fprintf(stderr, "poll() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 50000 };
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  char buf[16];
+  if (recv(sock, buf, sizeof(buf), 0) != -1 || errno != EAGAIN) {
+    fprintf(stderr, "recv() did not time out.\n");
+    return(EXIT_FAILURE);
+  }
+
+  return(EXIT_SUCCESS);
+}
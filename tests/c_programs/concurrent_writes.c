@@ -0,0 +1,71 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+static int shared_sock;
+
+static void *blocked_write(void *arg) {
+  static char buf[1 << 22];
+  (void)arg;
+  if (write(shared_sock, buf, sizeof(buf)) < 0 && errno != EAGAIN)
+    fprintf(stderr, "write() failed: %s\n.", strerror(errno));
+  return NULL;
+}
+
+int main(void) {
+  int listener;
+  if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55560);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(listener, 1) < 0) {
+    fprintf(stderr, "listen() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if ((shared_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(shared_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 200000 };
+  setsockopt(shared_sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  pthread_t threads[2];
+  for (int i = 0; i < 2; i++)
+    pthread_create(&threads[i], NULL, blocked_write, NULL);
+  for (int i = 0; i < 2; i++)
+    pthread_join(threads[i], NULL);
+
+  return(EXIT_SUCCESS);
+}
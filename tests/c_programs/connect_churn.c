@@ -0,0 +1,48 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(8000);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  for (int i = 0; i < 5; i++) {
+    int sock;
+    if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+      fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    if (i >= 3) {
+  char *req = "GET / HTTP/1.0\r\n\r\n";
+  send(sock, req, sizeof(char)*strlen(req), 0);
+
+      char buf[512];
+      while (recv(sock, buf, sizeof(buf), 0) > 0);
+    }
+    close(sock);
+  }
+
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,71 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55556);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(sock, 10) < 0) {
+    fprintf(stderr, "listen() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int client;
+  if ((client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int efd = epoll_create1(0);
+  struct epoll_event event;
+  event.data.fd = sock;
+  event.events = EPOLLIN;
+  if (epoll_ctl(efd, EPOLL_CTL_ADD, sock, &event) < 0) {
+    fprintf(stderr, "epoll_ctl() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct epoll_event events[1];
+  if (epoll_wait(efd, events, 1, 1000) != 1) {
+    fprintf(stderr, "epoll_wait() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  if (accept(sock, NULL, NULL) < 0) {
+    fprintf(stderr, "accept() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  return(EXIT_SUCCESS);
+}
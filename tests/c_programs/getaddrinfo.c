@@ -0,0 +1,43 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  struct addrinfo hints, *res;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo("localhost", "8000", &hints, &res) != 0) {
+    fprintf(stderr, "getaddrinfo() failed.\n");
+    return(EXIT_FAILURE);
+  }
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  if (connect(sock, res->ai_addr, res->ai_addrlen) < 0) {
+    fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  freeaddrinfo(res);
+
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,89 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <linux/filter.h>
+
+static struct sock_filter drop_code[] = { BPF_STMT(BPF_RET | BPF_K, 0) };
+static struct sock_fprog drop_all = { 1, drop_code };
+
+int main(void) {
+  int listener;
+  if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55562);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(listener, 1) < 0) {
+    fprintf(stderr, "listen() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int peer;
+  if ((peer = accept(listener, NULL, NULL)) < 0) {
+    fprintf(stderr, "accept() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (setsockopt(peer, SOL_SOCKET, SO_ATTACH_FILTER, &drop_all,
+                 sizeof(drop_all)) < 0) {
+    fprintf(stderr, "setsockopt() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char buf[1000];
+  memset(buf, 'x', sizeof(buf));
+  if (send(sock, buf, sizeof(buf), 0) < 0) {
+    fprintf(stderr, "send() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  // The first retransmission comes after 200 ms or more, and the next one
+  // after twice as long.
+  usleep(300000);
+  setsockopt(peer, SOL_SOCKET, SO_DETACH_FILTER, &optval, sizeof(optval));
+  usleep(700000);
+  for (int i = 0; i < 3; i++) {
+    if (send(sock, buf, 10, 0) < 0) {
+      fprintf(stderr, "send() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    usleep(50000);
+  }
+  close(sock);
+  close(peer);
+  close(listener);
+
+  return(EXIT_SUCCESS);
+}
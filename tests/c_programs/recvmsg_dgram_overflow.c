@@ -0,0 +1,76 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55555);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  int rcvbuf = 1024;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  char buf[512];
+  memset(buf, 'a', sizeof(buf));
+  for (int i = 0; i < 100; i++)
+    sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+           sizeof(addr));
+  char iovec_buf0[20];
+  char iovec_buf1[30];
+  char iovec_buf2[40];
+  struct iovec iovec[3];
+
+  iovec[0].iov_base = iovec_buf0;
+  iovec[0].iov_len = sizeof(iovec_buf0);
+  iovec[1].iov_base = iovec_buf1;
+  iovec[1].iov_len = sizeof(iovec_buf1);
+  iovec[2].iov_base = iovec_buf2;
+  iovec[2].iov_len = sizeof(iovec_buf2);
+
+  struct msghdr msg;
+  memset(&msg, '\0', sizeof(msg));
+  msg.msg_iov = iovec;
+  msg.msg_iovlen = sizeof(iovec)/sizeof(struct iovec);
+
+  char control[256];
+  msg.msg_control = control;
+  // The datagram queued after the drops carries their count.
+  for (int i = 0; i < 2; i++) {
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &msg, 0) < 0) {
+      fprintf(stderr, "recvmsg() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+           sizeof(addr));
+  }
+
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,90 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#define THREADS 8
+#define CONNECTIONS 128
+#define ROUNDS 500
+
+static int clients[CONNECTIONS];
+static int servers[CONNECTIONS];
+
+// Thread i uses the connections i, i + THREADS, i + 2 * THREADS...
+static void *send_recv(void *arg) {
+  long first = (long)arg;
+  char c = 'x';
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = first; i < CONNECTIONS; i += THREADS) {
+      if (send(clients[i], &c, 1, 0) != 1 || recv(servers[i], &c, 1, 0) != 1) {
+        fprintf(stderr, "send/recv failed: %s\n.", strerror(errno));
+        return NULL;
+      }
+    }
+  }
+  return NULL;
+}
+
+int main(void) {
+  int listener;
+  if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55561);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(listener, CONNECTIONS) < 0) {
+    fprintf(stderr, "listen() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  for (int i = 0; i < CONNECTIONS; i++) {
+    if ((clients[i] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0 ||
+        connect(clients[i], (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (servers[i] = accept(listener, NULL, NULL)) < 0) {
+      fprintf(stderr, "connection failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++)
+    pthread_create(&threads[i], NULL, send_recv, (void *)i);
+  for (int i = 0; i < THREADS; i++)
+    pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double sec = (end.tv_sec - start.tv_sec) +
+               (end.tv_nsec - start.tv_nsec) / 1e9;
+  long calls = 2L * CONNECTIONS * ROUNDS;
+  printf("%d threads, %d connections: %ld calls in %.3f s, %.0f calls/s\n",
+         THREADS, CONNECTIONS, calls, sec, calls / sec);
+
+  return(EXIT_SUCCESS);
+}
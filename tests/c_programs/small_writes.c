@@ -0,0 +1,55 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(8000);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  char *req_line = "GET / HTTP/1.0\r\n";
+  char *req_end = "\r\n";
+  if (write(sock, req_line, strlen(req_line)) < 0)
+    return(EXIT_FAILURE);
+  if (write(sock, req_end, strlen(req_end)) < 0)
+    return(EXIT_FAILURE);
+  char buf[16];
+  if (read(sock, &buf, sizeof(buf)) < 0) {
+    fprintf(stderr, "read() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (read(sock, &buf, sizeof(buf)) < 0) {
+    fprintf(stderr, "read() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,76 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55555);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  int client;
+  if ((client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct sockaddr_in client_addr = addr;
+  client_addr.sin_port = htons(55556);
+  if (bind(client, (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(sock, (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char buf[64];
+  memset(buf, 'a', sizeof(buf));
+  if (sendto(client, buf, 10, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "sendto() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct sockaddr_in peer;
+  socklen_t peer_len = sizeof(peer);
+  if (recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&peer,
+               &peer_len) < 0) {
+    fprintf(stderr, "recvfrom() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (sendto(sock, buf, 20, 0, (struct sockaddr *)&peer, peer_len) < 0) {
+    fprintf(stderr, "sendto() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (recv(client, buf, sizeof(buf), 0) < 0) {
+    fprintf(stderr, "recv() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  return(EXIT_SUCCESS);
+}
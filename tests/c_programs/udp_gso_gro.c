@@ -0,0 +1,98 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/unistd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(void) {
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  struct sockaddr_in addr;
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(55555);
+  inet_aton("127.0.0.1", &addr.sin_addr);
+
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+  int gso_size = 100;
+  if (setsockopt(sock, IPPROTO_UDP, UDP_SEGMENT, &gso_size,
+                 sizeof(gso_size)) < 0) {
+    fprintf(stderr, "setsockopt() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int on = 1;
+  if (setsockopt(sock, IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) < 0) {
+    fprintf(stderr, "setsockopt() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char buf[450];
+  memset(buf, 'a', sizeof(buf));
+  if (sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+             sizeof(addr)) < 0) {
+    fprintf(stderr, "sendto() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  // The control message overrides the socket option.
+  struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+  char control[CMSG_SPACE(sizeof(uint16_t))];
+  memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &addr;
+  msg.msg_namelen = sizeof(addr);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = IPPROTO_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  *(uint16_t *)CMSG_DATA(cmsg) = 200;
+  if (sendmsg(sock, &msg, 0) < 0) {
+    fprintf(stderr, "sendmsg() failed: %s\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char rcv_control[256];
+  for (int i = 0; i < 2; i++) {
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_len = sizeof(buf);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = rcv_control;
+    msg.msg_controllen = sizeof(rcv_control);
+    if (recvmsg(sock, &msg, 0) < 0) {
+      fprintf(stderr, "recvmsg() failed: %s\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,90 @@
+# Reader of the columnar tables of tcpsnitch_columnar (see columnar.h).
+# Returns a hash of the columns of a table, each column being an array with
+# nil for the null rows. Only the given columns are decoded, if any.
+
+COL_INT = 0
+COL_DOUBLE = 1
+COL_BOOL = 2
+COL_STRING = 3
+COL_DELTA = 1
+
+def read_tcol(path, only = nil)
+  data = File.binread(path)
+  raise "#{path}: not a table" unless data[0, 4] == "TCOL"
+  pos = 5
+  table = Hash.new { |h, k| h[k] = [] }
+  total = 0
+  while pos < data.bytesize
+    rows, columns = data.unpack("@#{pos}L<S<")
+    pos += 6
+    seen = []
+    columns.times do
+      name_len = data.unpack1("@#{pos}S<")
+      name = data.byteslice(pos + 2, name_len).force_encoding('UTF-8')
+      pos += 2 + name_len
+      kind, encoding, nullable = data.unpack("@#{pos}CCC")
+      pos += 3
+      valid = nil
+      if nullable == 1
+        valid = bitmap(data, pos, rows)
+        pos += (rows + 7) / 8
+      end
+      len = data.unpack1("@#{pos}Q<")
+      pos += 8
+      if only.nil? || only.include?(name)
+        values = decode_column(data, pos, rows, kind, encoding)
+        values = values.each_with_index.map { |v, i| valid[i] ? v : nil } if valid
+        table[name].fill(nil, table[name].size...total)
+        table[name].concat(values)
+        seen << name
+      end
+      pos += len
+    end
+    total += rows
+    table.each { |name, col| col.fill(nil, col.size...total) unless seen.include?(name) }
+  end
+  table
+end
+
+def bitmap(data, pos, rows)
+  data.byteslice(pos, (rows + 7) / 8).unpack1('b*')[0, rows].chars.map { |c| c == '1' }
+end
+
+def decode_column(data, pos, rows, kind, encoding)
+  case kind
+  when COL_INT
+    if encoding == COL_DELTA
+      prev = 0
+      Array.new(rows) do
+        val, pos = read_varint(data, pos)
+        prev += (val >> 1) ^ -(val & 1)
+      end
+    else
+      data.unpack("@#{pos}q<#{rows}")
+    end
+  when COL_DOUBLE then data.unpack("@#{pos}E#{rows}")
+  when COL_BOOL then bitmap(data, pos, rows)
+  when COL_STRING
+    count = data.unpack1("@#{pos}L<")
+    pos += 4
+    dict = Array.new(count) do
+      len = data.unpack1("@#{pos}L<")
+      str = data.byteslice(pos + 4, len).force_encoding('UTF-8')
+      pos += 4 + len
+      str
+    end
+    data.unpack("@#{pos}L<#{rows}").map { |i| dict[i] }
+  end
+end
+
+def read_varint(data, pos)
+  val = 0
+  shift = 0
+  loop do
+    byte = data.getbyte(pos)
+    pos += 1
+    val |= (byte & 0x7f) << shift
+    shift += 7
+    return [val, pos] if byte < 0x80
+  end
+end
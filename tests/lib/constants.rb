@@ -1,10 +1,21 @@
 EXECUTABLE="../bin/tcpsnitch"
+COLUMNAR="../bin/tcpsnitch_columnar"
 LD_PRELOAD="LD_PRELOAD=../libtcpsnitch.so.1.0"
 TEST_DIR="/tmp/netspy"
+COLUMNAR_DIR="/tmp/netspy_columnar"
 
 # LOGS
 PROCESS_DIR_REGEX="*.out*"
 LOG_FILE="logs.txt"
+DNS_FILE="dns.json"
+EPOLL_FILE="epoll.json"
+PORTS_FILE="ports.json"
+CALL_SITES_FILE="call_sites.json"
+MAPS_FILE="maps.txt"
+THREADS_FILE="threads.json"
+CONFIGS_FILE="configs.json"
+WATERFALL_FILE="waterfall.json"
+SOCKETS_FILE="sockets.json"
 LOG_LABEL_ERROR="ERROR"
 LOG_LABEL_WARN="WARN"
 LOG_LABEL_INFO="INFO"
@@ -69,6 +80,10 @@ SOCK_EV_EPOLL_PWAIT="epoll_pwait"
 SOCK_EV_FDOPEN="fdopen"
 
 SOCK_EV_TCP_INFO="tcp_info"
+SOCK_EV_TX_TIMESTAMPS="tx_timestamps"
+SOCK_EV_MEMINFO="meminfo"
+SOCK_EV_ANOMALY="anomaly"
+SOCK_EV_SUMMARY="summary"
 
 SOCKET_SYSCALLS = [
   SOCK_EV_SOCKET,
@@ -2,9 +2,11 @@ class CProg
   @@programs_path = "./c_programs/"
   @@count = 0
 
-  def initialize(instructions, name)
+  # globals are written before main(), e.g. for the functions of threads.
+  def initialize(instructions, name, globals = nil)
     @instructions = instructions
     @name = name
+    @globals = globals
     write_to_file
     @@count += 1
   end
@@ -14,6 +16,7 @@ class CProg
 #define _GNU_SOURCE
 #include <arpa/inet.h>
 #include <errno.h>
+#include <netdb.h>
 #include <netinet/in.h>
 #include <poll.h>
 #include <stdio.h>
@@ -30,7 +33,7 @@ class CProg
 #include <sys/wait.h>
 #include <unistd.h>
 
-int main(void) {
+#{@globals ? @globals + "\n" : ""}int main(void) {
 #{@instructions}
   return(EXIT_SUCCESS);
 }
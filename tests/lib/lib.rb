@@ -63,6 +63,42 @@ def pcap_file_str(con_id=0)
   dir_str+"/#{con_id}.pcap"
 end
 
+def dns_file_str
+  dir_str+"/"+DNS_FILE
+end
+
+def epoll_file_str
+  dir_str+"/"+EPOLL_FILE
+end
+
+def ports_file_str
+  dir_str+"/"+PORTS_FILE
+end
+
+def call_sites_file_str
+  dir_str+"/"+CALL_SITES_FILE
+end
+
+def maps_file_str
+  dir_str+"/"+MAPS_FILE
+end
+
+def threads_file_str
+  dir_str+"/"+THREADS_FILE
+end
+
+def configs_file_str
+  dir_str+"/"+CONFIGS_FILE
+end
+
+def waterfall_file_str
+  dir_str+"/"+WATERFALL_FILE
+end
+
+def sockets_file_str
+  dir_str+"/"+SOCKETS_FILE
+end
+
 def read_json_trace(con_id=0)
   File.read(json_file_str(con_id))
 end
@@ -76,6 +112,38 @@ def read_json_as_array(con_id=0)
   wrap_as_array(read_json_trace(con_id))
 end
 
+def read_dns_as_array
+  wrap_as_array(File.read(dns_file_str))
+end
+
+def read_epoll_as_array
+  wrap_as_array(File.read(epoll_file_str))
+end
+
+def read_ports_as_array
+  wrap_as_array(File.read(ports_file_str))
+end
+
+def read_call_sites_as_array
+  wrap_as_array(File.read(call_sites_file_str))
+end
+
+def read_threads_as_array
+  wrap_as_array(File.read(threads_file_str))
+end
+
+def read_configs_as_array
+  wrap_as_array(File.read(configs_file_str))
+end
+
+def read_waterfall_as_array
+  wrap_as_array(File.read(waterfall_file_str))
+end
+
+def read_sockets_as_array
+  wrap_as_array(File.read(sockets_file_str))
+end
+
 ##################
 # Others helpers #
 ##################
@@ -97,6 +165,12 @@ def run_c_program(name, opts='')
   tcpsnitch("-d #{TEST_DIR} #{opts}", "./c_programs/#{name}.out")
 end
 
+# Converts the traces of the last process to columnar tables.
+def run_columnar(opts='')
+  rmdir(COLUMNAR_DIR)
+  system("#{COLUMNAR} #{opts} #{dir_str} #{COLUMNAR_DIR} >/dev/null 2>&1")
+end
+
 def run_curl
   run_exec("curl -s google.com", "NETSPY_DEV=enp0s3")
 #  system("#{LD_PRELOAD} NETSPY_DEV=enp0s3 curl -s google.com > /dev/null 2>&1")
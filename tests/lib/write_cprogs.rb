@@ -982,6 +982,17 @@ FCNTL_FAIL  = CProg.new(<<-EOT, 'fcntl_fail')
     return(EXIT_FAILURE);
 EOT
 
+# More events than the queue of -v/-j holds (see verbose_mode.c)
+FCNTL_BURST = CProg.new(<<-EOT, 'fcntl_burst')
+#{SOCKET}
+  for (int i = 0; i < 5000; i++) {
+    if (fcntl(sock, F_GETFL) < 0) {
+      fprintf(stderr, "fcntl() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+EOT
+
 EPOLL_CTL = CProg.new(<<-EOT, 'epoll_ctl')
 #{SOCKET}
   int efd = epoll_create1(0);
@@ -1108,3 +1119,573 @@ CONCURRENT_CONNECTIONS = CProg.new(<<-EOT, 'concurrent_connections')
   close(sock1);
   close(sock2);
 EOT
+
+GETADDRINFO = CProg.new(<<-EOT, 'getaddrinfo')
+  struct addrinfo hints, *res;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo("localhost", "#{WebServer::PORT}", &hints, &res) != 0) {
+    fprintf(stderr, "getaddrinfo() failed.\\n");
+    return(EXIT_FAILURE);
+  }
+#{SOCKET}
+  if (connect(sock, res->ai_addr, res->ai_addrlen) < 0) {
+    fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  freeaddrinfo(res);
+EOT
+
+GETADDRINFO_FAIL = CProg.new(<<-EOT, 'getaddrinfo_fail')
+  struct addrinfo hints, *res;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_flags = AI_NUMERICHOST;
+  if (getaddrinfo("not.a.numeric.host", NULL, &hints, &res) == 0)
+    return(EXIT_FAILURE);
+EOT
+
+GETNAMEINFO_CONNECT = CProg.new(<<-EOT, 'getnameinfo_connect')
+#{sockaddr_in(WebServer::PORT)}
+  char host[NI_MAXHOST], serv[NI_MAXSERV];
+  getnameinfo((struct sockaddr *)&addr, sizeof(addr), host, sizeof(host),
+              serv, sizeof(serv), 0);
+#{SOCKET}
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+EOT
+
+SMALL_WRITES = CProg.new(<<-EOT, 'small_writes')
+#{CONNECT}
+  char *req_line = "GET / HTTP/1.0\\r\\n";
+  char *req_end = "\\r\\n";
+  if (write(sock, req_line, strlen(req_line)) < 0)
+    return(EXIT_FAILURE);
+  if (write(sock, req_end, strlen(req_end)) < 0)
+    return(EXIT_FAILURE);
+  char buf[16];
+  if (read(sock, &buf, sizeof(buf)) < 0) {
+    fprintf(stderr, "read() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (read(sock, &buf, sizeof(buf)) < 0) {
+    fprintf(stderr, "read() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+EOT
+
+# Small writes with the congestion control algorithm of $CC_ALGORITHM. Without
+# privileges, only the algorithms of tcp_allowed_congestion_control can be set.
+CONGESTION_CONTROL = CProg.new(<<-EOT, 'congestion_control', <<-EOG)
+#{CONNECT}
+  const char *algorithm = getenv("CC_ALGORITHM");
+  if (algorithm)
+    setsockopt(sock, IPPROTO_TCP, TCP_CONGESTION, algorithm, strlen(algorithm));
+  char *req_line = "GET / HTTP/1.0\\r\\n";
+  char *req_end = "\\r\\n";
+  if (write(sock, req_line, strlen(req_line)) < 0)
+    return(EXIT_FAILURE);
+  if (write(sock, req_end, strlen(req_end)) < 0)
+    return(EXIT_FAILURE);
+  char buf[16];
+  if (read(sock, &buf, sizeof(buf)) < 0) {
+    fprintf(stderr, "read() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+EOT
+#include <netinet/tcp.h>
+EOG
+
+# A non-blocking listening socket reported readable by epoll_wait()
+def epoll_listen_ready(port)
+  <<-EOT
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+#{sockaddr_in(port)}
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(sock, 10) < 0) {
+    fprintf(stderr, "listen() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int client;
+  if ((client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int efd = epoll_create1(0);
+  struct epoll_event event;
+  event.data.fd = sock;
+  event.events = EPOLLIN;
+  if (epoll_ctl(efd, EPOLL_CTL_ADD, sock, &event) < 0) {
+    fprintf(stderr, "epoll_ctl() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct epoll_event events[1];
+  if (epoll_wait(efd, events, 1, 1000) != 1) {
+    fprintf(stderr, "epoll_wait() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  EOT
+end
+
+EPOLL_ACCEPT = CProg.new(<<-EOT, 'epoll_accept')
+#{epoll_listen_ready(55_556)}
+  if (accept(sock, NULL, NULL) < 0) {
+    fprintf(stderr, "accept() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+EOT
+
+SPURIOUS_WAKEUP = CProg.new(<<-EOT, 'spurious_wakeup')
+#{epoll_listen_ready(55_557)}
+  int other = dup(sock);
+  if (accept(other, NULL, NULL) < 0) {
+    fprintf(stderr, "accept() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (accept(sock, NULL, NULL) != -1 || errno != EAGAIN)
+    return(EXIT_FAILURE);
+EOT
+
+ACCEPT_QUEUE_FULL = CProg.new(<<-EOT, 'accept_queue_full')
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+#{sockaddr_in(55_559)}
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(sock, 1) < 0) {
+    fprintf(stderr, "listen() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  for (int i = 0; i < 2; i++) {
+    int client;
+    if ((client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+      fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    if (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+  usleep(300000);
+EOT
+
+RECVMSG_CONTROL = CProg.new(<<-EOT, 'recvmsg_control')
+#{CONNECT}
+#{send_http_get}
+#{recv_msghdr}
+  char control[256];
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (recvmsg(sock, &msg, 0) < 0) {
+    fprintf(stderr, "recvmsg() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+EOT
+
+RECVMSG_DGRAM_OVERFLOW = CProg.new(<<-EOT, 'recvmsg_dgram_overflow')
+#{BIND_DGRAM}
+  int rcvbuf = 1024;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  char buf[512];
+  memset(buf, 'a', sizeof(buf));
+  for (int i = 0; i < 100; i++)
+    sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+           sizeof(addr));
+#{recv_msghdr}
+  char control[256];
+  msg.msg_control = control;
+  // The datagram queued after the drops carries their count.
+  for (int i = 0; i < 2; i++) {
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &msg, 0) < 0) {
+      fprintf(stderr, "recvmsg() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+           sizeof(addr));
+  }
+EOT
+
+UDP_GSO_GRO = CProg.new(<<-EOT, 'udp_gso_gro')
+#{BIND_DGRAM}
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+  int gso_size = 100;
+  if (setsockopt(sock, IPPROTO_UDP, UDP_SEGMENT, &gso_size,
+                 sizeof(gso_size)) < 0) {
+    fprintf(stderr, "setsockopt() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int on = 1;
+  if (setsockopt(sock, IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) < 0) {
+    fprintf(stderr, "setsockopt() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char buf[450];
+  memset(buf, 'a', sizeof(buf));
+  if (sendto(sock, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+             sizeof(addr)) < 0) {
+    fprintf(stderr, "sendto() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  // The control message overrides the socket option.
+  struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+  char control[CMSG_SPACE(sizeof(uint16_t))];
+  memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &addr;
+  msg.msg_namelen = sizeof(addr);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = IPPROTO_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  *(uint16_t *)CMSG_DATA(cmsg) = 200;
+  if (sendmsg(sock, &msg, 0) < 0) {
+    fprintf(stderr, "sendmsg() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char rcv_control[256];
+  for (int i = 0; i < 2; i++) {
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_len = sizeof(buf);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = rcv_control;
+    msg.msg_controllen = sizeof(rcv_control);
+    if (recvmsg(sock, &msg, 0) < 0) {
+      fprintf(stderr, "recvmsg() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+EOT
+
+UDP_PEERS = CProg.new(<<-EOT, 'udp_peers')
+#{BIND_DGRAM}
+  int clients[2];
+  for (int i = 0; i < 2; i++) {
+    if ((clients[i] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+      fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+  char buf[64];
+  memset(buf, 'a', sizeof(buf));
+  // Each client sends 3 requests of 10 bytes, answered with 20 bytes.
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 2; i++) {
+      if (sendto(clients[i], buf, 10, 0, (struct sockaddr *)&addr,
+                 sizeof(addr)) < 0) {
+        fprintf(stderr, "sendto() failed: %s\\n.", strerror(errno));
+        return(EXIT_FAILURE);
+      }
+      struct sockaddr_in peer;
+      socklen_t peer_len = sizeof(peer);
+      if (recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&peer,
+                   &peer_len) < 0) {
+        fprintf(stderr, "recvfrom() failed: %s\\n.", strerror(errno));
+        return(EXIT_FAILURE);
+      }
+      if (sendto(sock, buf, 20, 0, (struct sockaddr *)&peer, peer_len) < 0) {
+        fprintf(stderr, "sendto() failed: %s\\n.", strerror(errno));
+        return(EXIT_FAILURE);
+      }
+      if (recv(clients[i], buf, sizeof(buf), 0) < 0) {
+        fprintf(stderr, "recv() failed: %s\\n.", strerror(errno));
+        return(EXIT_FAILURE);
+      }
+    }
+  }
+EOT
+
+# The bound socket is connected to its single peer.
+UDP_CONNECTED_PEER = CProg.new(<<-EOT, 'udp_connected_peer')
+#{BIND_DGRAM}
+  int client;
+  if ((client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct sockaddr_in client_addr = addr;
+  client_addr.sin_port = htons(55556);
+  if (bind(client, (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(sock, (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char buf[64];
+  memset(buf, 'a', sizeof(buf));
+  if (sendto(client, buf, 10, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "sendto() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct sockaddr_in peer;
+  socklen_t peer_len = sizeof(peer);
+  if (recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&peer,
+               &peer_len) < 0) {
+    fprintf(stderr, "recvfrom() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (sendto(sock, buf, 20, 0, (struct sockaddr *)&peer, peer_len) < 0) {
+    fprintf(stderr, "sendto() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (recv(client, buf, sizeof(buf), 0) < 0) {
+    fprintf(stderr, "recv() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+EOT
+
+# 3 connections closed first by the client, then 2 closed first by the server.
+CONNECT_CHURN = CProg.new(<<-EOT, 'connect_churn')
+#{sockaddr_in(WebServer::PORT)}
+  for (int i = 0; i < 5; i++) {
+    int sock;
+    if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+      fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    if (i >= 3) {
+#{send_http_get}
+      char buf[512];
+      while (recv(sock, buf, sizeof(buf), 0) > 0);
+    }
+    close(sock);
+  }
+EOT
+
+# Blocked 100 ms in poll(), then 50 ms in a recv() timing out.
+BLOCKED_CALLS = CProg.new(<<-EOT, 'blocked_calls')
+#{BIND_DGRAM}
+  struct pollfd fds = { .fd = sock, .events = POLLIN };
+  if (poll(&fds, 1, 100) != 0) {
+    fprintf(stderr, "poll() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 50000 };
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  char buf[16];
+  if (recv(sock, buf, sizeof(buf), 0) != -1 || errno != EAGAIN) {
+    fprintf(stderr, "recv() did not time out.\\n");
+    return(EXIT_FAILURE);
+  }
+EOT
+
+# Two threads blocked in write() on the same socket, whose peer never reads.
+CONCURRENT_WRITES = CProg.new(<<-EOT, 'concurrent_writes', <<-EOG)
+  int listener;
+  if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+#{sockaddr_in(55_560)}
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(listener, 1) < 0) {
+    fprintf(stderr, "listen() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if ((shared_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(shared_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 200000 };
+  setsockopt(shared_sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  pthread_t threads[2];
+  for (int i = 0; i < 2; i++)
+    pthread_create(&threads[i], NULL, blocked_write, NULL);
+  for (int i = 0; i < 2; i++)
+    pthread_join(threads[i], NULL);
+EOT
+#include <pthread.h>
+
+static int shared_sock;
+
+static void *blocked_write(void *arg) {
+  static char buf[1 << 22];
+  (void)arg;
+  if (write(shared_sock, buf, sizeof(buf)) < 0 && errno != EAGAIN)
+    fprintf(stderr, "write() failed: %s\\n.", strerror(errno));
+  return NULL;
+}
+EOG
+
+# Microbenchmark of the tracer under contention (rake bench): threads sending
+# and receiving on many loopback connections, the sockets of a thread being
+# interleaved with those of the others.
+SEND_RECV_THREADS = CProg.new(<<-EOT, 'send_recv_threads', <<-EOG)
+  int listener;
+  if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+#{sockaddr_in(55_561)}
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(listener, CONNECTIONS) < 0) {
+    fprintf(stderr, "listen() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  for (int i = 0; i < CONNECTIONS; i++) {
+    if ((clients[i] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0 ||
+        connect(clients[i], (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (servers[i] = accept(listener, NULL, NULL)) < 0) {
+      fprintf(stderr, "connection failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+  }
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_t threads[THREADS];
+  for (long i = 0; i < THREADS; i++)
+    pthread_create(&threads[i], NULL, send_recv, (void *)i);
+  for (int i = 0; i < THREADS; i++)
+    pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double sec = (end.tv_sec - start.tv_sec) +
+               (end.tv_nsec - start.tv_nsec) / 1e9;
+  long calls = 2L * CONNECTIONS * ROUNDS;
+  printf("%d threads, %d connections: %ld calls in %.3f s, %.0f calls/s\\n",
+         THREADS, CONNECTIONS, calls, sec, calls / sec);
+EOT
+#include <pthread.h>
+#include <time.h>
+
+#define THREADS 8
+#define CONNECTIONS 128
+#define ROUNDS 500
+
+static int clients[CONNECTIONS];
+static int servers[CONNECTIONS];
+
+// Thread i uses the connections i, i + THREADS, i + 2 * THREADS...
+static void *send_recv(void *arg) {
+  long first = (long)arg;
+  char c = 'x';
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = first; i < CONNECTIONS; i += THREADS) {
+      if (send(clients[i], &c, 1, 0) != 1 || recv(servers[i], &c, 1, 0) != 1) {
+        fprintf(stderr, "send/recv failed: %s\\n.", strerror(errno));
+        return NULL;
+      }
+    }
+  }
+  return NULL;
+}
+EOG
+
+# The peer drops the segments of the first send() for a while: they are
+# retransmitted after a timeout. A few send() calls without losses follow.
+LOST_SEND = CProg.new(<<-EOT, 'lost_send', <<-EOG)
+  int listener;
+  if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int optval = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+#{sockaddr_in(55_562)}
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "bind() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (listen(listener, 1) < 0) {
+    fprintf(stderr, "listen() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int sock;
+  if ((sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+    fprintf(stderr, "socket() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "connect() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  int peer;
+  if ((peer = accept(listener, NULL, NULL)) < 0) {
+    fprintf(stderr, "accept() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  if (setsockopt(peer, SOL_SOCKET, SO_ATTACH_FILTER, &drop_all,
+                 sizeof(drop_all)) < 0) {
+    fprintf(stderr, "setsockopt() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  char buf[1000];
+  memset(buf, 'x', sizeof(buf));
+  if (send(sock, buf, sizeof(buf), 0) < 0) {
+    fprintf(stderr, "send() failed: %s\\n.", strerror(errno));
+    return(EXIT_FAILURE);
+  }
+  // The first retransmission comes after 200 ms or more, and the next one
+  // after twice as long.
+  usleep(300000);
+  setsockopt(peer, SOL_SOCKET, SO_DETACH_FILTER, &optval, sizeof(optval));
+  usleep(700000);
+  for (int i = 0; i < 3; i++) {
+    if (send(sock, buf, 10, 0) < 0) {
+      fprintf(stderr, "send() failed: %s\\n.", strerror(errno));
+      return(EXIT_FAILURE);
+    }
+    usleep(50000);
+  }
+  close(sock);
+  close(peer);
+  close(listener);
+EOT
+#include <linux/filter.h>
+
+static struct sock_filter drop_code[] = { BPF_STMT(BPF_RET | BPF_K, 0) };
+static struct sock_fprog drop_all = { 1, drop_code };
+EOG
@@ -0,0 +1,37 @@
+# Purpose: test the attribution of the calls to their call sites (call_sites.json).
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require 'json'
+require './lib/lib.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+describe "call_sites.c" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  it "should attribute each call to its call site" do
+    run_c_program('small_writes')
+    events = JSON.parse(read_json_as_array)[0..-2]
+    sites = JSON.parse(read_call_sites_as_array)
+    assert events.all? { |e| e['call_site'] =~ /\A0x\h+\z/ }
+    assert_equal events.map { |e| e['call_site'] }.uniq.sort,
+                 sites.map { |s| s['call_site'] }.sort
+    writes = sites.select { |s| s['function'] == SOCK_EV_WRITE }
+    assert_equal 2, writes.map { |s| s['calls'] }.reduce(:+)
+    assert_equal 18, writes.map { |s| s['bytes'] }.reduce(:+)
+    assert File.exist?(maps_file_str)
+  end
+
+  it "should sample the stacks with -r" do
+    run_c_program('small_writes', '-r 1')
+    events = JSON.parse(read_json_as_array)[0..-2]
+    assert events.all? { |e| e['stack'][0] == e['call_site'] }
+  end
+
+  it "should not sample the stacks by default" do
+    run_c_program('small_writes')
+    refute JSON.parse(read_json_as_array).any? { |e| e.key?('stack') }
+  end
+end
@@ -0,0 +1,63 @@
+# Purpose: test the conversion of the traces to columnar tables.
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require 'json'
+require './lib/lib.rb'
+require './lib/columnar.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+def events_of_type(type)
+  JSON.parse(read_json_as_array).select { |ev| ev['type'] == type }
+end
+
+def table(type, columns = nil)
+  read_tcol("#{COLUMNAR_DIR}/#{type}.tcol", columns)
+end
+
+# The traces are converted in parallel: the order of the rows of several
+# sockets is not defined.
+def rows(table)
+  (0...table['socket'].size).map { |i|
+    table.transform_values { |col| col[i] }
+  }.sort_by { |row| [row['socket'], row['timestamp_usec']] }
+end
+
+describe "tcpsnitch_columnar" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  it "should write a table per event type" do
+    run_c_program(SOCK_EV_SEND)
+    assert run_columnar
+    types = JSON.parse(read_json_as_array).map { |ev| ev['type'] }
+    tables = Dir.glob("#{COLUMNAR_DIR}/*.tcol").map { |f| File.basename(f, '.tcol') }
+    assert_equal types.uniq.sort, tables.sort
+    types.uniq.each do |type|
+      assert_equal types.count(type), table(type, ['socket'])['socket'].size
+    end
+  end
+
+  it "should keep the values of the events" do
+    run_c_program(SOCK_EV_SEND)
+    assert run_columnar
+    events = events_of_type(SOCK_EV_SEND)
+    send = table(SOCK_EV_SEND)
+    assert_equal events.map { |ev| ev['timestamp_usec'] }, send['timestamp_usec']
+    assert_equal events.map { |ev| ev['return_value'] }, send['return_value']
+    assert_equal events.map { |ev| ev['success'] }, send['success']
+    assert_equal [0] * events.size, send['socket']
+    connect = table(SOCK_EV_CONNECT)
+    assert_equal events_of_type(SOCK_EV_CONNECT).map { |ev| ev['details']['addr']['ip'] },
+                 connect['details.addr.ip']
+  end
+
+  it "should write the same rows with several threads and row groups" do
+    run_c_program('connect_churn')
+    assert run_columnar
+    expected = rows(table(SOCK_EV_SUMMARY))
+    assert run_columnar('-j 4 -r 1')
+    assert_equal expected, rows(table(SOCK_EV_SUMMARY))
+  end
+end
@@ -0,0 +1,35 @@
+# Purpose: test the usage of the ephemeral ports (ports.json).
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require './lib/lib.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+describe "local_ports.c" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  it "should track the ephemeral ports and the side closing first" do
+    run_c_program('connect_churn')
+    pattern = [
+      {
+        addr: { port: WebServer::PORT.to_s }.ignore_extra_keys!,
+        connects: 5,
+        implicit_binds: 5,
+        distinct_ports: 5,
+        open: 0,
+        active_closes: 3,
+        passive_closes: 2,
+        time_wait: 3,
+        port_range: { low: Integer, high: Integer }
+      }.ignore_extra_keys!
+    ]
+    assert_json_match(pattern, read_ports_as_array)
+  end
+
+  it "should not write ports.json without connect()" do
+    run_c_program('bind_dgram')
+    refute File.exist?(ports_file_str)
+  end
+end
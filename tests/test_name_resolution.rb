@@ -0,0 +1,99 @@
+# Purpose: test the tracing of name resolution calls (dns.json).
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require 'json'
+require './lib/lib.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+describe "name_resolution.c" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  describe "when calling getaddrinfo()" do
+    it "should not crash" do
+      assert run_c_program('getaddrinfo')
+    end
+
+    it "should log no ERROR" do
+      run_c_program('getaddrinfo')
+      assert !errors_in_log?
+    end
+
+    it "should write the resolution in dns.json" do
+      run_c_program('getaddrinfo')
+      pattern = [
+        {
+          type: 'getaddrinfo',
+          id: 0,
+          timestamp_usec: Integer,
+          duration_usec: Integer,
+          return_value: 0,
+          success: true,
+          thread_id: Integer,
+          details: {
+            node: 'localhost',
+            service: WebServer::PORT.to_s,
+            results_count: Integer,
+            families: {
+              AF_INET: Integer,
+              AF_INET6: 0
+            },
+            addrs: ['127.0.0.1'].ignore_extra_values!
+          }
+        }
+      ]
+      assert_json_match(pattern, read_dns_as_array)
+    end
+
+    it "should link the connect() to the resolution" do
+      run_c_program('getaddrinfo')
+      pattern = [
+        {
+          type: SOCK_EV_CONNECT,
+          details: {
+            dns: {
+              query_id: 0,
+              resolved_usec: Integer,
+              duration_usec: Integer
+            }
+          }.ignore_extra_keys!
+        }.ignore_extra_keys!
+      ].ignore_extra_values!
+      assert_json_match(pattern, read_json_as_array)
+    end
+  end
+
+  describe "when calling getnameinfo()" do
+    it "should not link a connect() to the reverse lookup" do
+      run_c_program('getnameinfo_connect')
+      connect = JSON.parse(read_json_as_array).find { |ev|
+        ev['type'] == SOCK_EV_CONNECT
+      }
+      refute connect['details'].key?('dns')
+    end
+  end
+
+  describe "when getaddrinfo() fails" do
+    it "should not crash" do
+      assert run_c_program('getaddrinfo_fail')
+    end
+
+    it "should report the error in dns.json" do
+      run_c_program('getaddrinfo_fail')
+      pattern = [
+        {
+          type: 'getaddrinfo',
+          success: false,
+          error: String,
+          details: {
+            node: 'not.a.numeric.host',
+            results_count: 0
+          }.ignore_extra_keys!
+        }.ignore_extra_keys!
+      ]
+      assert_json_match(pattern, read_dns_as_array)
+    end
+  end
+end
@@ -49,6 +49,7 @@ describe 'tcp_spy' do
     return_value: Integer,
     success: Boolean,
     thread_id: Integer,
+    cpu: Integer,
     fake_call: Boolean,
     timestamp_usec: Integer,
     type: String
@@ -63,7 +64,9 @@ describe 'tcp_spy' do
   end
 
   sock_info = {
+    cookie: Integer,
     domain: String,
+    inode: Integer,
     protocol: String,
     SOCK_CLOEXEC: Boolean,
     SOCK_NONBLOCK: Boolean,
@@ -290,10 +293,12 @@ describe 'tcp_spy' do
       requested_events: epoll_events
     },
     SOCK_EV_EPOLL_WAIT => {
+      epfd: Integer,
       timeout: Integer,
       returned_events: epoll_events
     },
     SOCK_EV_EPOLL_PWAIT => {
+      epfd: Integer,
       timeout: Integer,
       returned_events: epoll_events
     },
@@ -332,7 +337,12 @@ describe 'tcp_spy' do
       reordering: Integer,
       rcv_rtt: Integer,
       rcv_space: Integer,
-      total_retrans: Integer
+      total_retrans: Integer,
+      queues: {
+        outq: Integer,
+        outq_nsd: Integer,
+        inq: Integer
+      }
     }
   }
 
@@ -0,0 +1,36 @@
+# Purpose: test the index of the sockets by kernel socket (sockets.json).
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require 'json'
+require './lib/lib.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+describe "sockets.json" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  it "should index the sockets by kernel socket" do
+    run_c_program('dup')
+    pattern = [
+      { socket: 0, fd: Integer, cookie: Integer, inode: Integer,
+        accepted: false },
+      { socket: 1, fd: Integer, cookie: Integer, inode: Integer,
+        accepted: false }
+    ]
+    assert_json_match(pattern, read_sockets_as_array)
+    sockets = JSON.parse(read_sockets_as_array)
+    assert_equal sockets[0]['inode'], sockets[1]['inode']
+    assert_equal sockets[0]['cookie'], sockets[1]['cookie']
+    first = JSON.parse(read_json_as_array)[0]
+    assert_equal sockets[0]['inode'], first['details']['sock_info']['inode']
+  end
+
+  it "should give accepted sockets their own identity" do
+    run_c_program('epoll_accept')
+    sockets = JSON.parse(read_sockets_as_array)
+    assert_equal 3, sockets.map { |s| s['inode'] }.uniq.size
+    assert_equal 1, sockets.count { |s| s['accepted'] }
+  end
+end
@@ -0,0 +1,545 @@
+# Purpose: test the summary event pushed at the end of each socket trace.
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require 'json'
+require './lib/lib.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+def summary_event(con_id=0)
+  JSON.parse(read_json_as_array(con_id)).find { |ev| ev['type'] == SOCK_EV_SUMMARY }
+end
+
+describe "summary event" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  histogram = {
+    count: Integer
+  }.ignore_extra_keys!
+
+  it "should be pushed when the socket is closed" do
+    run_c_program(SOCK_EV_CLOSE)
+    pattern = [
+      { type: SOCK_EV_CLOSE }.ignore_extra_keys!,
+      {
+        type: SOCK_EV_SUMMARY,
+        fake_call: true,
+        details: {
+          bytes_sent: Integer,
+          bytes_received: Integer,
+          request_response: {
+            role: 'client',
+            exchanges: 0,
+            unanswered_requests: 0,
+            unsolicited_responses: 0,
+            response_time_usec: histogram,
+            request_bytes: histogram,
+            response_bytes: histogram
+          },
+          wakeups: {
+            wakeups: 0,
+            productive: 0,
+            spurious: 0,
+            lost_races: 0,
+            unconsumed: 0,
+            spurious_ratio: Float,
+            threads: [],
+            advice: []
+          }
+        }.ignore_extra_keys!
+      }.ignore_extra_keys!
+    ].ignore_extra_values!
+    assert_json_match(pattern, read_json_as_array)
+  end
+
+  it "should be pushed at exit for sockets left open" do
+    run_c_program(SOCK_EV_SOCKET)
+    pattern = [
+      { type: SOCK_EV_SOCKET }.ignore_extra_keys!,
+      { type: SOCK_EV_SUMMARY }.ignore_extra_keys!
+    ]
+    assert_json_match(pattern, read_json_as_array)
+  end
+
+  describe "request_response" do
+    it "should infer the response time of a request" do
+      run_c_program(SOCK_EV_RECV)
+      rr = summary_event['details']['request_response']
+      assert_equal 1, rr['exchanges']
+      assert_equal 1, rr['response_time_usec']['count']
+      assert_equal "GET / HTTP/1.0\r\n\r\n".size, rr['request_bytes']['max']
+      assert_equal 1, rr['response_bytes']['count']
+    end
+
+    it "should not crash with an idle gap" do
+      assert run_c_program(SOCK_EV_RECV, "-g 1")
+    end
+  end
+
+  describe "nagle" do
+    it "should detect a write-write-read pattern" do
+      run_c_program('small_writes')
+      nagle = summary_event['details']['nagle']
+      assert_equal false, nagle['TCP_NODELAY']
+      assert_equal 2, nagle['small_writes']
+      assert_equal 1, nagle['write_write_read']
+      assert_equal 1, nagle['writev_candidates']
+      assert nagle['wasted_syscalls'] >= 1
+      refute_empty nagle['advice']
+    end
+
+    it "should not be present for datagram sockets" do
+      run_c_program('setsockopt_dgram')
+      assert_nil summary_event['details']['nagle']
+    end
+  end
+
+  describe "wakeups" do
+    it "should count a wakeup followed by accept() as productive" do
+      run_c_program('epoll_accept')
+      wakeups = summary_event['details']['wakeups']
+      assert_equal 1, wakeups['wakeups']
+      assert_equal 1, wakeups['productive']
+      assert_equal 0, wakeups['spurious']
+    end
+
+    it "should give the accept() batch sizes" do
+      run_c_program('epoll_accept')
+      batches = summary_event['details']['wakeups']['calls_per_wakeup']
+      assert_equal 1, batches['count']
+      assert_equal 1, batches['max']
+    end
+
+    it "should count a wakeup followed by EAGAIN as spurious" do
+      run_c_program('spurious_wakeup')
+      wakeups = summary_event['details']['wakeups']
+      assert_equal 1, wakeups['spurious']
+      assert_equal 0, wakeups['lost_races']
+      assert_equal 1.0, wakeups['spurious_ratio']
+    end
+
+    it "should write the per epoll fd wakeups in epoll.json" do
+      run_c_program('spurious_wakeup')
+      pattern = [
+        {
+          epfd: Integer,
+          wakeups: {
+            wakeups: 1,
+            productive: 0,
+            spurious: 1,
+            lost_races: 0,
+            threads: [{ thread_id: Integer }.ignore_extra_keys!]
+          }.ignore_extra_keys!
+        }
+      ]
+      assert_json_match(pattern, read_epoll_as_array)
+    end
+  end
+
+  describe "waterfall" do
+    it "should give the phases of a connection" do
+      run_c_program('small_writes')
+      wf = summary_event['details']['waterfall']
+      assert wf['connect_usec'] >= 0
+      assert wf['first_byte_sent_usec'] >= 0
+      assert wf['first_byte_received_usec'] >= wf['first_byte_sent_usec']
+      assert wf['transfer_usec'] >= 0
+      assert_equal 0, wf['idle_gaps']
+    end
+
+    it "should aggregate the phases per destination" do
+      run_c_program('connect_churn')
+      pattern = [
+        {
+          addr: { port: WebServer::PORT.to_s }.ignore_extra_keys!,
+          accepted: false,
+          connections: 5,
+          connect_usec: { count: 5 }.ignore_extra_keys!,
+          close_usec: { count: 5 }.ignore_extra_keys!
+        }.ignore_extra_keys!
+      ]
+      assert_json_match(pattern, read_waterfall_as_array)
+    end
+
+    it "should not write waterfall.json without connection" do
+      run_c_program('bind_dgram')
+      refute File.exist?(waterfall_file_str)
+    end
+  end
+
+  describe "configs" do
+    it "should record a configuration shared by the connections once" do
+      run_c_program('connect_churn')
+      pattern = [
+        {
+          id: 0,
+          sockets: 5,
+          domain: "AF_INET",
+          type: "SOCK_STREAM",
+          sndbuf: Integer,
+          nodelay: 0,
+          congestion: String
+        }.ignore_extra_keys!
+      ]
+      assert_json_match(pattern, read_configs_as_array)
+      (0..4).each do |i|
+        assert_equal 0, summary_event(i)['details']['config_id']
+      end
+    end
+
+    it "should not write configs.json without connect() or accept()" do
+      run_c_program('bind_dgram')
+      refute File.exist?(configs_file_str)
+    end
+  end
+
+  describe "concurrency" do
+    it "should detect two threads writing the socket at once" do
+      run_c_program('concurrent_writes')
+      conc = summary_event(1)['details']['concurrency']
+      assert_equal 1, conc['write_overlaps']
+      overlap = conc['reports'].find { |r| r['kind'] == 'write_overlap' }
+      refute_equal overlap['first']['thread_id'],
+                   overlap['second']['thread_id']
+      assert_equal overlap['first']['call_site'],
+                   overlap['second']['call_site']
+      assert overlap['overlap_usec'] >= 100_000
+    end
+
+    it "should not report the calls of a single thread" do
+      run_c_program('small_writes')
+      pattern = {
+        read_overlaps: 0,
+        write_overlaps: 0,
+        close_overlaps: 0,
+        handoffs: 0,
+        rapid_handoffs: 0,
+        reports: []
+      }
+      assert_json_match(pattern, summary_event['details']['concurrency'])
+    end
+  end
+
+  describe "cpu" do
+    it "should count the events per CPU" do
+      run_c_program('small_writes')
+      cpu = summary_event['details']['cpu']
+      events = JSON.parse(read_json_as_array).size - 1
+      assert_equal events, cpu['events']
+      assert_equal events, cpu['cpus'].map { |c| c[1] }.reduce(:+)
+      assert cpu['migrations'] < events
+    end
+
+    it "should read the incoming CPU at the first data call" do
+      run_c_program('small_writes')
+      cpu = summary_event['details']['cpu']
+      assert cpu['incoming_cpu'] >= 0
+      assert_equal 4, cpu['data_calls']
+    end
+  end
+
+  describe "accept_queue" do
+    it "should be sampled at listen()" do
+      run_c_program(SOCK_EV_LISTEN)
+      aq = summary_event['details']['accept_queue']
+      assert_equal 10, aq['backlog']
+      assert aq['samples'] >= 1
+      assert_equal 0, aq['high_water']
+    end
+
+    it "should not be present for other sockets" do
+      run_c_program(SOCK_EV_CONNECT)
+      assert_nil summary_event['details']['accept_queue']
+    end
+
+    it "should report the saturation of the queue" do
+      run_c_program('accept_queue_full', '-s 50')
+      aq = summary_event['details']['accept_queue']
+      assert_equal 1, aq['backlog']
+      assert_equal 2, aq['high_water']
+      assert aq['saturated_samples'] >= 1
+      assert aq['saturated_usec'] > 0
+    end
+
+    it "should not be sampled periodically with -s 0" do
+      run_c_program('accept_queue_full', '-s 0')
+      assert_equal 1, summary_event['details']['accept_queue']['samples']
+    end
+  end
+
+  describe "queues" do
+    it "should be sampled along with TCP_INFO" do
+      run_c_program('small_writes', '-u 1')
+      queues = summary_event['details']['queues']
+      %w(outq outq_nsd inq).each do |q|
+        assert queues[q]['count'] >= 1
+      end
+    end
+
+    it "should not be present without TCP_INFO" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['queues']
+    end
+  end
+
+  describe "retransmissions" do
+    it "should not be present without TCP_INFO" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['retransmissions']
+    end
+
+    it "should follow the send calls with the TCP_INFO snapshots" do
+      run_c_program('small_writes', '-u 1')
+      retx = summary_event['details']['retransmissions']
+      assert retx['snapshots'] >= 1
+      assert_equal 2, retx['clean_calls'] + retx['affected_calls'] +
+                      retx['incomplete']
+      assert_equal retx['clean_calls'], retx['clean_ack_delay_usec']['count']
+      assert_equal 0, retx['dropped']
+    end
+
+    it "should attribute the retransmissions to the send calls" do
+      run_c_program('lost_send', '-u 1')
+      retx = summary_event(1)['details']['retransmissions']
+      assert retx['segments'] >= 1
+      assert_equal 1, retx['affected_calls']
+      assert_equal 4, retx['clean_calls'] + retx['affected_calls'] +
+                      retx['incomplete']
+      events = JSON.parse(read_json_as_array(1))
+      reports = events.select { |ev| ev['type'] == SOCK_EV_TCP_INFO }
+                      .flat_map { |ev| ev['details']['retransmitted_sends'] || [] }
+      assert_equal 1, reports.size
+      assert_equal events.index { |ev| ev['type'] == SOCK_EV_SEND },
+                   reports[0]['send_id']
+      assert_equal 1000, reports[0]['retrans_bytes']
+      # Retransmitted after a timeout of 200 ms or more.
+      assert reports[0]['added_delay_usec'] >= 200_000
+      assert_equal reports[0]['added_delay_usec'],
+                   retx['added_delay_usec']['max']
+    end
+  end
+
+  describe "anomalies" do
+    it "should not be present without TCP_INFO" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['anomalies']
+    end
+
+    it "should detect the zero window of a peer that does not read" do
+      run_c_program('concurrent_writes', '-u 1000')
+      anomalies = JSON.parse(read_json_as_array(1)).select do |ev|
+        ev['type'] == SOCK_EV_ANOMALY
+      end
+      assert_includes anomalies.map { |ev| ev['details']['kind'] },
+                      'zero_window'
+      anom = summary_event(1)['details']['anomalies']
+      assert anom['samples'] >= 1
+      assert_equal 1, anom['zero_window']
+    end
+  end
+
+  describe "congestion_control" do
+    it "should not be present without TCP_INFO" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['congestion_control']
+    end
+
+    it "should decode TCP_CC_INFO along with TCP_INFO" do
+      run_c_program('small_writes', '-b 1')
+      algorithm = File.read('/proc/sys/net/ipv4/tcp_congestion_control').strip
+      cc = summary_event['details']['congestion_control']
+      infos = JSON.parse(read_json_as_array).select do |ev|
+        ev['type'] == SOCK_EV_TCP_INFO
+      end
+      if algorithm.start_with?('bbr')
+        assert_equal algorithm, cc['algorithm']
+        assert_equal infos.size, cc['samples']
+        assert cc['max_bw'] > 0
+        assert infos.all? { |ev| ev['details']['cc']['pacing_gain'] > 0 }
+      elsif %w(cubic reno).include?(algorithm)
+        assert_nil cc
+        assert infos.none? { |ev| ev['details'].key?('cc') }
+      end
+    end
+
+    vegas = %w(enabled rtt_count rtt min_rtt)
+    {
+      'bbr' => %w(bw min_rtt pacing_gain cwnd_gain),
+      'dctcp' => %w(enabled ce_state alpha ecn_bytes total_bytes),
+      'vegas' => vegas,
+      'westwood' => vegas,
+      'illinois' => vegas,
+      'cubic' => []
+    }.each do |algorithm, keys|
+      it "should decode the TCP_CC_INFO of #{algorithm}" do
+        ENV['CC_ALGORITHM'] = algorithm
+        run_c_program('congestion_control', '-b 1')
+        ENV.delete('CC_ALGORITHM')
+        events = JSON.parse(read_json_as_array)
+        set = events.find { |ev| ev['type'] == SOCK_EV_SETSOCKOPT }
+        skip "#{algorithm} is not allowed on this host" unless set['success']
+        infos = events.drop(events.index(set)).select do |ev|
+          ev['type'] == SOCK_EV_TCP_INFO
+        end
+        cc = summary_event['details']['congestion_control']
+        if keys.empty?
+          assert_nil cc
+          assert infos.none? { |ev| ev['details'].key?('cc') }
+        else
+          assert_equal algorithm, cc['algorithm']
+          assert_equal infos.size, cc['samples']
+          infos.each do |ev|
+            assert_equal ['algorithm'] + keys, ev['details']['cc'].keys
+          end
+        end
+      end
+    end
+  end
+
+  describe "timestamping" do
+    it "should not be present without -x" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['timestamping']
+    end
+
+    it "should match the TX timestamps with the send calls" do
+      run_c_program('small_writes', '-x 1')
+      events = JSON.parse(read_json_as_array)
+      sends = events.select { |ev| ev['type'] == SOCK_EV_TX_TIMESTAMPS }
+                    .flat_map { |ev| ev['details']['sends'] }
+      writes = events.each_index.select do |i|
+        events[i]['type'] == SOCK_EV_WRITE
+      end
+      assert_equal writes, sends.map { |s| s['send_id'] }
+      sends.each { |s| assert s['ack_delay_usec'] >= 0 }
+      ts = summary_event['details']['timestamping']
+      assert ts['tx']
+      assert_equal writes.size, ts['completed']
+      assert_equal writes.size, ts['ack_delay']['count']
+    end
+
+    it "should timestamp the datagrams" do
+      run_c_program('sendmsg_dgram', '-x 1')
+      ts = summary_event['details']['timestamping']
+      assert_equal 1, ts['completed']
+      assert_equal 0, ts['ack_delay']['count']
+    end
+
+    it "should not add control messages to recvmsg()" do
+      run_c_program('recvmsg_control', '-x 1')
+      recvmsg = JSON.parse(read_json_as_array).find do |ev|
+        ev['type'] == SOCK_EV_RECVMSG
+      end
+      assert_empty recvmsg['details']['msghdr']['control_data']
+      assert summary_event['details']['timestamping']['tx']
+    end
+  end
+
+  describe "memory" do
+    it "should not be present without -m" do
+      run_c_program('recvmsg_dgram_overflow')
+      assert_nil summary_event['details']['memory']
+    end
+
+    it "should sample the memory and count the drops" do
+      run_c_program('recvmsg_dgram_overflow', '-m 1')
+      samples = JSON.parse(read_json_as_array).select do |ev|
+        ev['type'] == SOCK_EV_MEMINFO
+      end
+      assert samples.size >= 2
+      mem = summary_event['details']['memory']
+      assert_equal samples.size, mem['samples']
+      assert mem['drops'] > 0
+      assert_equal mem['drops'], mem['drops_while_traced']
+      assert_equal 1, mem['drop_intervals']
+      assert_equal 2, mem['recv_calls']
+    end
+
+    it "should not add control messages to recvmsg()" do
+      run_c_program('recvmsg_dgram_overflow', '-m 1')
+      recvmsg = JSON.parse(read_json_as_array).select do |ev|
+        ev['type'] == SOCK_EV_RECVMSG
+      end
+      recvmsg.each { |ev| assert_empty ev['details']['msghdr']['control_data'] }
+      assert summary_event['details']['memory']['drops'] > 0
+    end
+  end
+
+  describe "udp" do
+    it "should not be present for TCP sockets" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['udp']
+    end
+
+    it "should count one datagram per call without offload" do
+      run_c_program('sendto_dgram')
+      udp = summary_event['details']['udp']
+      assert_equal 1, udp['send_calls']
+      assert_equal 1, udp['datagrams_sent']
+      assert_equal 0, udp['gso_calls']
+    end
+
+    it "should count the segments of UDP_SEGMENT and UDP_GRO" do
+      run_c_program('udp_gso_gro')
+      udp = summary_event['details']['udp']
+      assert_equal 100, udp['gso_size']
+      assert udp['gro']
+      assert_equal 2, udp['send_calls']
+      assert_equal 8, udp['datagrams_sent'] # 5 of 100 bytes, 3 of 200 bytes.
+      assert_equal 2, udp['gso_calls']
+      assert_equal 4.0, udp['datagrams_per_send']
+      assert_equal 8, udp['datagrams_received']
+    end
+
+    it "should decode the UDP_SEGMENT and UDP_GRO control data" do
+      run_c_program('udp_gso_gro')
+      events = JSON.parse(read_json_as_array)
+      sendmsg = events.find { |ev| ev['type'] == SOCK_EV_SENDMSG }
+      assert_equal 200, sendmsg['details']['msghdr']['control_data'].first['gso_size']
+      recvmsg = events.find { |ev| ev['type'] == SOCK_EV_RECVMSG }
+      assert_equal 100, recvmsg['details']['msghdr']['control_data'].first['gro_size']
+    end
+  end
+
+  describe "flows" do
+    it "should not be present for TCP sockets" do
+      run_c_program('small_writes')
+      assert_nil summary_event['details']['flows']
+    end
+
+    it "should keep a flow per peer of an unconnected socket" do
+      run_c_program('udp_peers')
+      flows = summary_event['details']['flows']
+      assert_equal 2, flows['peers']
+      assert_equal 0, flows['untracked_datagrams']
+      flows['list'].each do |flow|
+        assert_equal 3, flow['packets_received']
+        assert_equal 3, flow['packets_sent']
+        assert_equal 30, flow['bytes_received']
+        assert_equal 60, flow['bytes_sent']
+        assert_equal 2, flow['inter_arrival_usec']['count']
+        rr = flow['request_response']
+        assert_equal 'server', rr['role']
+        assert_equal 3, rr['exchanges']
+      end
+    end
+
+    it "should not record the datagram events with -o" do
+      run_c_program('udp_peers', '-o')
+      types = JSON.parse(read_json_as_array).map { |ev| ev['type'] }
+      refute_includes types, SOCK_EV_SENDTO
+      refute_includes types, SOCK_EV_RECVFROM
+      assert_equal 2, summary_event['details']['flows']['peers']
+    end
+
+    it "should record the datagram events of a connected socket with -o" do
+      run_c_program('udp_connected_peer', '-o')
+      types = JSON.parse(read_json_as_array).map { |ev| ev['type'] }
+      assert_includes types, SOCK_EV_RECVFROM
+      assert_includes types, SOCK_EV_SENDTO
+      assert_nil summary_event['details']['flows']
+    end
+  end
+end
@@ -2,10 +2,32 @@
 require 'minitest/autorun'
 require 'minitest/spec'
 require 'minitest/reporters'
+require 'json'
+require 'tmpdir'
 require './lib/lib.rb'
 
 Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
 
+# Runs cmd with -j on a FIFO, read after delay seconds. Returns the output of
+# tcpsnitch and the streamed events.
+def stream_output(options, cmd, delay=0)
+  reset_dir(TEST_DIR)
+  Dir.mktmpdir do |dir|
+    fifo = "#{dir}/events"
+    File.mkfifo(fifo)
+    # The FIFO must have a reader before tcpsnitch opens it. A writer is kept
+    # open until tcpsnitch exits, so that the reader does not see EOF before.
+    reader = File.open(fifo, File::RDONLY | File::NONBLOCK)
+    writer = File.open(fifo, 'w')
+    lines = Thread.new { sleep delay; reader.read }
+    out = tcpsnitch_output("-d #{TEST_DIR} -j #{fifo} #{options}", cmd)
+    writer.close
+    events = lines.value.split("\n").map { |line| JSON.parse(line) }
+    reader.close
+    [out, events]
+  end
+end
+
 describe "tcpsnitch" do
   before do WebServer.start end
   MiniTest::Unit.after_tests { WebServer.stop }
@@ -25,7 +47,7 @@ describe "tcpsnitch" do
     end
   end
 
-  ["-b", "-f", "-l", "-t", "-u"].each do |opt|
+  ["-b", "-f", "-g", "-l", "-m", "-r", "-s", "-t", "-u", "-w", "-x"].each do |opt|
     describe "when #{opt} is set" do
       it "should report 'invalid #{opt} argument'" do
         assert_match(/invalid #{opt} argument/, tcpsnitch_output("#{opt} -42", cmd))
@@ -92,6 +114,42 @@ describe "tcpsnitch" do
     it "should show verbose output" do
       assert_match(/[pid \d*] [a-z]*()/, tcpsnitch_output("-v", cmd))
     end
+
+    it "should only show the events matching -e" do
+      cprog = "./c_programs/small_writes.out"
+      out = tcpsnitch_output("-v -e type=write", cprog)
+      assert_match(/\] write\(\)=/, out)
+      refute_match(/\] (connect|read)\(\)=/, out)
+      refute_match(/\] write\(\)=/, tcpsnitch_output("-v -e errors", cprog))
+    end
+
+    it "should count the events over the rate of -e" do
+      out = tcpsnitch_output("-v -e rate=1", "./c_programs/small_writes.out")
+      assert_match(/event\(s\) dropped, [1-9]\d* rate-limited/, out)
+    end
+  end
+
+  describe "when -j is set" do
+    it "should stream the events to a FIFO" do
+      _, events = stream_output("-e type=fcntl", "./c_programs/fcntl.out")
+      assert_equal 1, events.size
+      assert_json_match({
+        pid: Integer,
+        socket: 0,
+        event: { type: SOCK_EV_FCNTL, success: true }.ignore_extra_keys!
+      }, events.first.to_json)
+    end
+
+    it "should count the events dropped when the queue is full" do
+      # The reader waits: the FIFO, then the queue, fill up.
+      out, events = stream_output("-v -e type=fcntl",
+                                  "./c_programs/fcntl_burst.out", 1)
+      dropped = out[/(\d+) event\(s\) dropped/, 1].to_i
+      assert_operator dropped, :>, 0
+      assert_equal out.scan(/\] fcntl=/).size, events.size
+      traced = JSON.parse(read_json_as_array).count { |ev| ev['type'] == SOCK_EV_FCNTL }
+      assert_equal traced, events.size + dropped
+    end
   end
 
   describe "when --version is set" do
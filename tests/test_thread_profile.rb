@@ -0,0 +1,29 @@
+# Purpose: test the profile of the time threads spend blocked (threads.json).
+require 'minitest/autorun'
+require 'minitest/spec'
+require 'minitest/reporters'
+require 'json'
+require './lib/lib.rb'
+
+Minitest::Reporters.use! Minitest::Reporters::SpecReporter.new
+
+describe "thread_profile.c" do
+  before do WebServer.start end
+  MiniTest::Unit.after_tests { WebServer.stop }
+
+  it "should profile the time blocked per function and socket" do
+    run_c_program('blocked_calls')
+    threads = JSON.parse(read_threads_as_array)
+    assert_equal 1, threads.size
+    t = threads[0]
+    assert_equal 'blocked_calls.out'[0, 15], t['name']
+    poll = t['by_function'].find { |f| f['function'] == SOCK_EV_POLL }
+    recv = t['by_function'].find { |f| f['function'] == SOCK_EV_RECV }
+    assert poll['blocked_usec'] >= 100_000
+    assert recv['blocked_usec'] >= 50_000
+    assert_equal poll['blocked_usec'], t['multiplexed']['blocked_usec']
+    socket = t['by_socket'].find { |s| s['socket'] == 0 }
+    assert socket['blocked_usec'] >= recv['blocked_usec']
+    assert t['blocked_ratio'] > 0.9
+  end
+end
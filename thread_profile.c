@@ -0,0 +1,160 @@
+#define _GNU_SOURCE
+
+#include "thread_profile.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+#define PROF_MAX_EPFDS 64  // Epoll fds watching sockets, per process.
+
+// Protects the registration of the threads and of the epoll fds. Each thread
+// then writes its own slot without lock.
+static pthread_mutex_t prof_mutex = MUTEX_ERRORCHECK;
+static ProfThread threads[PROF_MAX_THREADS];
+static int threads_count = 0;
+static atomic_long threads_dropped;  // Calls of threads beyond the max.
+static int epfds[PROF_MAX_EPFDS];
+static atomic_int epfds_count;  // Published after epfds[epfds_count].
+
+static __thread ProfThread *thread_slot;
+static __thread bool thread_unslotted;  // Beyond PROF_MAX_THREADS.
+
+/* Private functions */
+
+static void read_thread_name(char *name) {
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 26
+        if (pthread_getname_np(pthread_self(), name, PROF_NAME_LEN))
+                name[0] = '\0';
+#else
+        name[0] = '\0';
+#endif
+}
+
+// Called by the thread itself, so that its name can be read, with its id or 0
+// to look it up. Registered once, under the mutex. NULL beyond
+// PROF_MAX_THREADS.
+static ProfThread *get_thread(pid_t thread_id) {
+        if (thread_slot || thread_unslotted) return thread_slot;
+        mutex_lock(&prof_mutex);
+        if (threads_count < PROF_MAX_THREADS) {
+                thread_slot = &threads[threads_count++];
+                memset(thread_slot, 0, sizeof(ProfThread));
+                thread_slot->thread_id =
+                    thread_id ? thread_id : syscall(SYS_gettid);
+                read_thread_name(thread_slot->name);
+        } else {
+                thread_unslotted = true;
+        }
+        mutex_unlock(&prof_mutex);
+        return thread_slot;
+}
+
+static void add_time(ProfTime *time, unsigned long usec) {
+        time->calls++;
+        time->blocked_usec += usec;
+}
+
+static ProfTime *get_socket_time(ProfThread *t, long sock_id) {
+        for (int i = 0; i < t->sockets_count; i++)
+                if (t->sockets[i].sock_id == sock_id)
+                        return &t->sockets[i].time;
+        if (t->sockets_count == PROF_MAX_SOCKETS) return &t->other_sockets;
+        ProfSocket *s = &t->sockets[t->sockets_count++];
+        s->sock_id = sock_id;
+        return &s->time;
+}
+
+static void account(pid_t thread_id, SockEventType type, long sock_id,
+                    unsigned long start_usec, unsigned long end_usec) {
+        unsigned long usec = end_usec > start_usec ? end_usec - start_usec : 0;
+        ProfThread *t = get_thread(thread_id);
+        if (!t) {
+                atomic_fetch_add_explicit(&threads_dropped, 1,
+                                          memory_order_relaxed);
+                return;
+        }
+        if (!t->total.calls) t->first_call_usec = start_usec;
+        if (end_usec > t->last_call_usec) t->last_call_usec = end_usec;
+        add_time(&t->total, usec);
+        histo_add(&t->blocked, usec);
+        if (type < SOCK_EV_SUMMARY) add_time(&t->by_type[type], usec);
+        add_time(sock_id < 0 ? &t->multiplexed : get_socket_time(t, sock_id),
+                 usec);
+}
+
+static bool is_watched_epfd(int epfd) {
+        int count = atomic_load_explicit(&epfds_count, memory_order_acquire);
+        for (int i = 0; i < count; i++)
+                if (epfds[i] == epfd) return true;
+        return false;
+}
+
+static char *alloc_thread_line(int i, void *arg) {
+        UNUSED(arg);
+        return alloc_thread_profile_json(&threads[i]);
+}
+
+/* Public functions */
+
+void prof_on_call(pid_t thread_id, SockEventType type, long sock_id,
+                  unsigned long start_usec, unsigned long end_usec) {
+        account(thread_id, type, sock_id, start_usec, end_usec);
+}
+
+void prof_on_wait(SockEventType type, unsigned long start_usec,
+                  unsigned long end_usec) {
+        account(0, type, -1, start_usec, end_usec);
+}
+
+void prof_watch_epfd(int epfd) {
+        if (is_watched_epfd(epfd)) return;
+        mutex_lock(&prof_mutex);
+        int count = atomic_load_explicit(&epfds_count, memory_order_relaxed);
+        if (!is_watched_epfd(epfd) && count < PROF_MAX_EPFDS) {
+                epfds[count] = epfd;
+                atomic_store_explicit(&epfds_count, count + 1,
+                                      memory_order_release);
+        }
+        mutex_unlock(&prof_mutex);
+}
+
+bool prof_is_watched_epfd(int epfd) { return is_watched_epfd(epfd); }
+
+void dump_all_thread_profiles(void) {
+        if (!logs_dir_path) return;
+        mutex_lock(&prof_mutex);
+        if (!threads_count) goto exit;
+
+        LOG_FUNC_INFO;
+        // The threads may still be running: their calls in progress are
+        // missed.
+        long dropped = atomic_load(&threads_dropped);
+        if (dropped) LOG(WARN, "%ld calls from untracked threads.", dropped);
+        if (!write_json_lines("threads.json", false, threads_count, alloc_thread_line, NULL))
+                goto error;
+        goto exit;
+error:
+        LOG(ERROR, "Could not write thread profiles.");
+        LOG_FUNC_ERROR;
+exit:
+        mutex_unlock(&prof_mutex);
+}
+
+void prof_reset(void) {
+        mutex_init(&prof_mutex);
+        threads_count = 0;
+        thread_slot = NULL;
+        thread_unslotted = false;
+        atomic_store(&threads_dropped, 0);
+        atomic_store(&epfds_count, 0);
+}
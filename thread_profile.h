@@ -0,0 +1,62 @@
+#ifndef THREAD_PROFILE_H
+#define THREAD_PROFILE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "histogram.h"
+#include "sock_events.h"
+
+/* Off-CPU profile of the threads of the process: the wall time each thread
+ * spends blocked in socket calls, per call type and per socket. Calls on a
+ * single socket (recv(), connect(), accept()...) are charged to that socket,
+ * waits on several sockets at once (poll(), select(), epoll_wait()) to the
+ * multiplexed bucket. The blocked time is compared with the time over which
+ * the thread was seen making socket calls: a thread blocked most of that time
+ * waits on its peers, which is what sizes a thread pool. */
+
+#define PROF_MAX_THREADS 256  // Threads tracked per process.
+#define PROF_MAX_SOCKETS 16   // Sockets tracked per thread.
+#define PROF_NAME_LEN 16      // Including the NULL byte, as for pthreads.
+
+typedef struct {
+        long calls;
+        unsigned long blocked_usec;
+} ProfTime;
+
+typedef struct {
+        long sock_id;
+        ProfTime time;
+} ProfSocket;
+
+typedef struct {
+        pid_t thread_id;  // 0 if unused.
+        char name[PROF_NAME_LEN];  // At first sight, empty if unknown.
+        unsigned long first_call_usec;  // Start of the first call.
+        unsigned long last_call_usec;   // End of the last call.
+        ProfTime total;
+        Histogram blocked;  // Time per call, in micro-seconds.
+        ProfTime by_type[SOCK_EV_SUMMARY];
+        int sockets_count;
+        ProfSocket sockets[PROF_MAX_SOCKETS];
+        ProfTime other_sockets;  // Sockets beyond PROF_MAX_SOCKETS.
+        ProfTime multiplexed;    // poll(), select() and epoll_wait().
+} ProfThread;
+
+// thread_id spent start_usec..end_usec in a call on the socket sock_id. Called
+// by that thread, which writes its own profile without lock.
+void prof_on_call(pid_t thread_id, SockEventType type, long sock_id,
+                  unsigned long start_usec, unsigned long end_usec);
+
+// The current thread waited on several sockets from start_usec to end_usec.
+void prof_on_wait(SockEventType type, unsigned long start_usec,
+                  unsigned long end_usec);
+
+// epfd watches an Internet socket, its waits are thus network waits.
+void prof_watch_epfd(int epfd);
+bool prof_is_watched_epfd(int epfd);
+
+void dump_all_thread_profiles(void);  // Written to threads.json.
+
+void prof_reset(void);  // Free state (called after fork()).
+
+#endif
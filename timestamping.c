@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+
+#include "timestamping.h"
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include "lib.h"
+
+#define TS_MAX_REPORTS 256  // Reports read from the error queue per drain.
+// SOF_TIMESTAMPING_OPT_RX_FILTER, from Linux 6.12 on. Without it, the received
+// data also carries a timestamp if another socket of the host stamps its own.
+#define SOF_RX_FILTER (1 << 17)
+
+/* Private functions */
+
+static unsigned long delay(unsigned long from, unsigned long to) {
+        return to > from ? to - from : 0;
+}
+
+// Keys wrap around after 4 GB on TCP.
+static bool key_covers(uint32_t report_key, uint32_t send_key) {
+        return (int32_t)(report_key - send_key) >= 0;
+}
+
+static void on_report(Timestamping *ts, int type, uint32_t key,
+                      unsigned long tstamp) {
+        // A report covers the send calls up to its key: the kernel stamps the
+        // last byte of a send, and bytes are scheduled, sent and acknowledged
+        // in order.
+        for (int i = 0; i < ts->pending_count; i++) {
+                TsSend *s = &ts->pending[(ts->pending_head + i) %
+                                         TS_MAX_PENDING];
+                if (!key_covers(key, s->key)) break;
+                unsigned long *field;
+                switch (type) {
+                        case SCM_TSTAMP_SCHED:
+                                field = &s->sched_usec;
+                                break;
+                        case SCM_TSTAMP_SND:
+                                field = &s->sent_usec;
+                                break;
+                        case SCM_TSTAMP_ACK:
+                                field = &s->ack_usec;
+                                break;
+                        default:
+                                return;
+                }
+                if (!*field) *field = tstamp;
+        }
+}
+
+static void read_report(Timestamping *ts, struct msghdr *msgh) {
+        unsigned long tstamp = 0;
+        struct sock_extended_err serr;
+        bool has_serr = false;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msgh); cmsg;
+             cmsg = CMSG_NXTHDR(msgh, cmsg)) {
+                if ((cmsg->cmsg_level == SOL_IP &&
+                     cmsg->cmsg_type == IP_RECVERR) ||
+                    (cmsg->cmsg_level == SOL_IPV6 &&
+                     cmsg->cmsg_type == IPV6_RECVERR)) {
+                        memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+                        has_serr = true;
+                } else if (!tstamp) {
+                        tstamp = ts_from_cmsg(cmsg);
+                }
+        }
+        if (!has_serr) return;
+        if (serr.ee_errno != ENOMSG ||
+            serr.ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+                ts->foreign++;
+                return;
+        }
+        if (tstamp) on_report(ts, serr.ee_info, serr.ee_data, tstamp);
+}
+
+static bool is_complete(const Timestamping *ts, const TsSend *s) {
+        return ts->tcp ? s->ack_usec : s->sent_usec;
+}
+
+static void account_completed(Timestamping *ts, const TsSend *s) {
+        ts->completed++;
+        if (s->sched_usec)
+                histo_add(&ts->sched_delay,
+                          delay(s->call_usec, s->sched_usec));
+        if (s->sched_usec && s->sent_usec)
+                histo_add(&ts->qdisc_delay,
+                          delay(s->sched_usec, s->sent_usec));
+        if (s->sent_usec && s->ack_usec)
+                histo_add(&ts->ack_delay, delay(s->sent_usec, s->ack_usec));
+}
+
+static int pop_completed(Timestamping *ts, TsSend done[TS_MAX_PENDING]) {
+        int count = 0;
+        while (ts->pending_count) {
+                TsSend *s = &ts->pending[ts->pending_head];
+                if (!is_complete(ts, s)) break;
+                account_completed(ts, s);
+                done[count++] = *s;
+                ts->pending_head = (ts->pending_head + 1) % TS_MAX_PENDING;
+                ts->pending_count--;
+        }
+        return count;
+}
+
+static bool read_outq(int fd, int *outq) {
+        return my_ioctl(fd, SIOCOUTQ, outq) != -1;
+}
+
+/* Public functions */
+
+bool ts_enable(Timestamping *ts, int fd, bool tcp, long opt) {
+        int flags = opt & TS_OPT_TX;
+        if (!flags) return false;
+
+        int val = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_TX_SCHED |
+                  SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+                  SOF_TIMESTAMPING_OPT_TSONLY | SOF_RX_FILTER;
+        if (tcp) val |= SOF_TIMESTAMPING_TX_ACK;
+
+        // On TCP, the keys count from snd_una at the time of setsockopt().
+        // SIOCOUTQ gives the bytes not acknowledged yet (1 while the SYN is
+        // not), which locates snd_una in the byte stream of the application.
+        int outq = 0, outq_after = 0;
+        if (tcp && !read_outq(fd, &outq)) return false;
+        if (!set_int_sockopt_if_supported(fd, SOL_SOCKET, SO_TIMESTAMPING,
+                                          val)) {
+                val &= ~SOF_RX_FILTER;  // Older kernel.
+                if (my_setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &val,
+                                  sizeof(val)))
+                        return false;
+        }
+        if (tcp && (!read_outq(fd, &outq_after) || outq_after != outq)) {
+                // An ACK moved snd_una meanwhile: the keys can't be located.
+                val = 0;
+                my_setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &val,
+                              sizeof(val));
+                return false;
+        }
+
+        ts->flags = flags;
+        ts->tcp = tcp;
+        ts->tx_base = ts->tx_count - outq;
+        return true;
+}
+
+bool ts_is_active(const Timestamping *ts) {
+        return ts->flags && !ts->app_owned;
+}
+
+void ts_on_app_errqueue(Timestamping *ts) { ts->app_owned = true; }
+
+void ts_on_setsockopt(Timestamping *ts, int level, int optname) {
+        if ((level == SOL_SOCKET && optname == SO_TIMESTAMPING) ||
+#ifdef SO_ZEROCOPY
+            (level == SOL_SOCKET && optname == SO_ZEROCOPY) ||
+#endif
+            (level == IPPROTO_IP && optname == IP_RECVERR) ||
+            (level == IPPROTO_IPV6 && optname == IPV6_RECVERR))
+                ts_on_app_errqueue(ts);
+}
+
+void ts_on_send(Timestamping *ts, long send_id, unsigned long call_usec,
+                long bytes, int count) {
+        if (!ts_is_active(ts) || !(ts->flags & TS_OPT_TX)) return;
+        if (ts->tcp && bytes > 0)
+                ts->tx_count += bytes;
+        else if (!ts->tcp && bytes >= 0 && count > 0)
+                ts->tx_count += count;
+        else
+                return;
+
+        if (ts->pending_count == TS_MAX_PENDING) {
+                ts->dropped++;
+                return;
+        }
+        TsSend *s = &ts->pending[(ts->pending_head + ts->pending_count) %
+                                 TS_MAX_PENDING];
+        memset(s, 0, sizeof(TsSend));
+        s->send_id = send_id;
+        s->key = (uint32_t)(ts->tx_count - 1 - ts->tx_base);
+        s->bytes = bytes;
+        s->call_usec = call_usec;
+        ts->pending_count++;
+}
+
+int ts_drain(Timestamping *ts, int fd, TsSend done[TS_MAX_PENDING]) {
+        if (!ts_is_active(ts) || !(ts->flags & TS_OPT_TX)) return 0;
+        char control[256];
+        for (int i = 0; i < TS_MAX_REPORTS; i++) {
+                struct msghdr msgh;
+                memset(&msgh, 0, sizeof(msgh));
+                msgh.msg_control = control;
+                msgh.msg_controllen = sizeof(control);
+                if (my_recvmsg(fd, &msgh, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                        break;
+                read_report(ts, &msgh);
+        }
+        return pop_completed(ts, done);
+}
+
+unsigned long ts_from_cmsg(const struct cmsghdr *cmsg) {
+        if (cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_TIMESTAMPING)
+                return 0;
+        struct scm_timestamping tss;
+        memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+        return tss.ts[0].tv_sec * (unsigned long)1000000 +
+               tss.ts[0].tv_nsec / 1000;
+}
@@ -0,0 +1,81 @@
+#ifndef TIMESTAMPING_H
+#define TIMESTAMPING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include "histogram.h"
+
+/* Kernel timestamping (SO_TIMESTAMPING) of the sent data, enabled with -x 1.
+ * The kernel reports when the last byte of a send call enters the packet
+ * scheduler (SCHED), is handed to the driver (SND) and, for TCP, is
+ * acknowledged by the peer (ACK). The reports are queued on the error queue of
+ * the socket, where tcpsnitch reads them, and carry the offset of that byte
+ * (TCP) or the index of the datagram (UDP) thanks to SOF_TIMESTAMPING_OPT_ID.
+ *
+ * While reports wait in the error queue, poll(), select() and epoll_wait()
+ * signal an error on the socket to the application. The received data is not
+ * timestamped: the timestamps would be passed in the ancillary data of the
+ * recvmsg() of the application. */
+
+#define TS_OPT_TX 1  // -x bit: timestamp the sent data.
+
+#define TS_MAX_PENDING 64  // Send calls awaiting their timestamps, per socket.
+
+typedef struct {
+        long send_id;  // Id of the send event.
+        uint32_t key;  // Offset of the last byte, or index of the datagram.
+        long bytes;
+        unsigned long call_usec;
+        // Kernel timestamps, 0 until reported.
+        unsigned long sched_usec;
+        unsigned long sent_usec;
+        unsigned long ack_usec;
+} TsSend;
+
+typedef struct {
+        int flags;  // TS_OPT_* bits enabled on the socket, 0 if none.
+        bool tcp;
+        bool app_owned;  // The application uses the error queue itself.
+        // TCP: offset of the first byte sent after enabling, minus the OPT_ID
+        // key base. UDP: index of the next datagram.
+        long tx_base;
+        unsigned long tx_count;  // Bytes (TCP) or datagrams (UDP) sent.
+        TsSend pending[TS_MAX_PENDING];
+        int pending_head;
+        int pending_count;
+        long dropped;     // Send calls not tracked, pending list full.
+        long foreign;     // Non-timestamp errors read from the error queue.
+        long completed;   // Send calls with all their timestamps.
+        Histogram sched_delay;  // Call -> SCHED: waiting in the send buffer.
+        Histogram qdisc_delay;  // SCHED -> SND: waiting in the qdisc/driver.
+        Histogram ack_delay;    // SND -> ACK: network and peer.
+} Timestamping;
+
+// Enables SO_TIMESTAMPING on fd with the TS_OPT_* bits of opt. TCP sockets
+// must be connected or connecting. Returns false if not enabled.
+bool ts_enable(Timestamping *ts, int fd, bool tcp, long opt);
+
+bool ts_is_active(const Timestamping *ts);
+
+// The application reads the error queue (recvmsg() with MSG_ERRQUEUE):
+// tcpsnitch stops reading it so as not to steal its notifications.
+void ts_on_app_errqueue(Timestamping *ts);
+
+// Same for the options that make the application read the error queue:
+// SO_TIMESTAMPING, SO_ZEROCOPY, IP_RECVERR and IPV6_RECVERR.
+void ts_on_setsockopt(Timestamping *ts, int level, int optname);
+
+// A send call transferred bytes over count datagrams (count is ignored for
+// TCP).
+void ts_on_send(Timestamping *ts, long send_id, unsigned long call_usec,
+                long bytes, int count);
+
+// Reads the pending reports of the error queue of fd. Fills done with the send
+// calls completed and returns their number.
+int ts_drain(Timestamping *ts, int fd, TsSend done[TS_MAX_PENDING]);
+
+// Software timestamp of an SCM_TIMESTAMPING control message, 0 if none.
+unsigned long ts_from_cmsg(const struct cmsghdr *cmsg);
+
+#endif
@@ -0,0 +1,140 @@
+#define _GNU_SOURCE
+
+#include "udp_flows.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+
+#define FLOWS_MIN_BUCKETS 64
+
+/* Private functions */
+
+static bool fill_key(FlowKey *key, const struct sockaddr *addr,
+                     socklen_t len) {
+        memset(key, 0, sizeof(FlowKey));
+        key->family = addr->sa_family;
+        if (addr->sa_family == AF_INET &&
+            len >= sizeof(struct sockaddr_in)) {
+                const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+                key->port = in->sin_port;
+                memcpy(key->ip, &in->sin_addr, sizeof(in->sin_addr));
+                return true;
+        }
+        if (addr->sa_family == AF_INET6 &&
+            len >= sizeof(struct sockaddr_in6)) {
+                const struct sockaddr_in6 *in6 =
+                    (const struct sockaddr_in6 *)addr;
+                key->port = in6->sin6_port;
+                memcpy(key->ip, &in6->sin6_addr, sizeof(in6->sin6_addr));
+                return true;
+        }
+        return false;
+}
+
+static unsigned int hash_key(const FlowKey *key) {
+        return hash_bytes(key, sizeof(FlowKey));
+}
+
+static bool resize(UdpFlows *flows, int buckets_count) {
+        UdpFlow **buckets =
+            (UdpFlow **)my_calloc(buckets_count * sizeof(UdpFlow *));
+        if (!buckets) return false;
+        for (UdpFlow *flow = flows->first; flow; flow = flow->next) {
+                unsigned int i = hash_key(&flow->key) % buckets_count;
+                flow->bucket_next = buckets[i];
+                buckets[i] = flow;
+        }
+        free(flows->buckets);
+        flows->buckets = buckets;
+        flows->buckets_count = buckets_count;
+        return true;
+}
+
+static UdpFlow *find(const UdpFlows *flows, const FlowKey *key) {
+        if (!flows->buckets) return NULL;
+        unsigned int i = hash_key(key) % flows->buckets_count;
+        for (UdpFlow *flow = flows->buckets[i]; flow;
+             flow = flow->bucket_next)
+                if (!memcmp(&flow->key, key, sizeof(FlowKey))) return flow;
+        return NULL;
+}
+
+static UdpFlow *insert(UdpFlows *flows, const FlowKey *key,
+                       const struct sockaddr *addr, socklen_t len) {
+        if (flows->count >= FLOWS_MAX) return NULL;
+        if (!flows->buckets && !resize(flows, FLOWS_MIN_BUCKETS)) return NULL;
+        if (flows->count >= 2 * flows->buckets_count)
+                resize(flows, 2 * flows->buckets_count);
+
+        UdpFlow *flow = (UdpFlow *)my_calloc(sizeof(UdpFlow));
+        if (!flow) return NULL;
+        flow->key = *key;
+        if (len > sizeof(flow->addr)) len = sizeof(flow->addr);
+        memcpy(&flow->addr, addr, len);
+        flow->addr_len = len;
+
+        unsigned int i = hash_key(key) % flows->buckets_count;
+        flow->bucket_next = flows->buckets[i];
+        flows->buckets[i] = flow;
+        if (flows->last)
+                flows->last->next = flow;
+        else
+                flows->first = flow;
+        flows->last = flow;
+        flows->count++;
+        return flow;
+}
+
+/* Public functions */
+
+bool flows_on_datagram(UdpFlows *flows, const struct sockaddr *addr,
+                       socklen_t len, bool sent, long bytes,
+                       unsigned long time_usec, unsigned long idle_gap_usec) {
+        FlowKey key;
+        if (!fill_key(&key, addr, len)) return false;
+
+        UdpFlow *flow = find(flows, &key);
+        if (!flow) {
+                flow = insert(flows, &key, addr, len);
+                if (!flow) {
+                        flows->untracked++;
+                        return true;
+                }
+                flow->first_seen_usec = time_usec;
+                flow->rr.server = !sent;
+        }
+
+        flow->last_seen_usec = time_usec;
+        if (sent) {
+                flow->packets_sent++;
+                flow->bytes_sent += bytes;
+        } else {
+                if (flow->last_recv_usec)
+                        histo_add(&flow->inter_arrival,
+                                  time_usec > flow->last_recv_usec
+                                      ? time_usec - flow->last_recv_usec
+                                      : 0);
+                flow->last_recv_usec = time_usec;
+                flow->packets_received++;
+                flow->bytes_received += bytes;
+        }
+        rr_add_data(&flow->rr, sent, bytes, time_usec, idle_gap_usec);
+        return true;
+}
+
+void flows_flush(UdpFlows *flows) {
+        for (UdpFlow *flow = flows->first; flow; flow = flow->next)
+                rr_flush(&flow->rr);
+}
+
+void flows_free(UdpFlows *flows) {
+        UdpFlow *flow = flows->first;
+        while (flow) {
+                UdpFlow *next = flow->next;
+                free(flow);
+                flow = next;
+        }
+        free(flows->buckets);
+        memset(flows, 0, sizeof(UdpFlows));
+}
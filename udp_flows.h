@@ -0,0 +1,63 @@
+#ifndef UDP_FLOWS_H
+#define UDP_FLOWS_H
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include "histogram.h"
+#include "request_response.h"
+
+/* Per-peer view of an unconnected datagram socket. The datagrams sent with
+ * sendto() or sendmsg() and received with recvfrom() or recvmsg() carry the
+ * address of the peer, which keys a table of flows. Each flow counts the
+ * datagrams and bytes both ways, and infers request/response exchanges with
+ * the peer, as for a connected socket. The peer which sends the first datagram
+ * is the client. */
+
+#define FLOWS_MAX 4096  // Peers tracked per socket.
+
+typedef struct {
+        sa_family_t family;
+        in_port_t port;
+        unsigned char ip[16];
+} FlowKey;
+
+typedef struct UdpFlow UdpFlow;
+struct UdpFlow {
+        FlowKey key;
+        struct sockaddr_storage addr;
+        socklen_t addr_len;
+        long packets_sent;
+        long packets_received;
+        unsigned long bytes_sent;
+        unsigned long bytes_received;
+        unsigned long first_seen_usec;
+        unsigned long last_seen_usec;
+        unsigned long last_recv_usec;  // 0 until a datagram is received.
+        Histogram inter_arrival;       // Between received datagrams, in usec.
+        ReqResp rr;
+        UdpFlow *bucket_next;
+        UdpFlow *next;  // In order of first datagram.
+};
+
+typedef struct {
+        UdpFlow **buckets;  // NULL until the first flow.
+        int buckets_count;
+        int count;
+        UdpFlow *first;
+        UdpFlow *last;
+        long untracked;  // Datagrams of the peers beyond FLOWS_MAX.
+} UdpFlows;
+
+// Accounts for a datagram exchanged with the peer addr. Returns false if the
+// address is not an inet one.
+bool flows_on_datagram(UdpFlows *flows, const struct sockaddr *addr,
+                       socklen_t len, bool sent, long bytes,
+                       unsigned long time_usec, unsigned long idle_gap_usec);
+
+// Accounts for the messages in progress, as if the socket was closed now.
+void flows_flush(UdpFlows *flows);
+
+void flows_free(UdpFlows *flows);
+
+#endif
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+
+#include "udp_offload.h"
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Private functions */
+
+// Size of the segments in the control data of msgh, 0 if none.
+static int cmsg_segment_size(const struct msghdr *msgh,
+                             int (*from_cmsg)(const struct cmsghdr *)) {
+        if (!msgh) return 0;
+        // CMSG_NXTHDR() takes a non-const msghdr.
+        struct msghdr copy = *msgh;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&copy); cmsg;
+             cmsg = CMSG_NXTHDR(&copy, cmsg)) {
+                int size = from_cmsg(cmsg);
+                if (size) return size;
+        }
+        return 0;
+}
+
+static long segments(long bytes, int size) {
+        if (size <= 0 || bytes <= size) return 1;
+        return (bytes + size - 1) / size;
+}
+
+/* Public functions */
+
+void udp_on_setsockopt(UdpOffload *udp, int level, int optname,
+                       const void *optval, socklen_t optlen) {
+        if (level != SOL_UDP || !optval || optlen < sizeof(int)) return;
+        int val;
+        memcpy(&val, optval, sizeof(val));
+#ifdef UDP_SEGMENT
+        if (optname == UDP_SEGMENT) udp->gso_size = val;
+#endif
+#ifdef UDP_GRO
+        if (optname == UDP_GRO) udp->gro = val;
+#endif
+}
+
+void udp_on_call(UdpOffload *udp, bool sent) {
+        if (sent)
+                udp->send_calls++;
+        else
+                udp->recv_calls++;
+}
+
+void udp_on_send(UdpOffload *udp, const struct msghdr *msgh, long bytes) {
+        if (bytes < 0) return;
+        // The control message overrides the socket option.
+        int size = cmsg_segment_size(msgh, udp_gso_from_cmsg);
+        if (!size) size = udp->gso_size;
+        long count = segments(bytes, size);
+        if (count > 1) udp->gso_calls++;
+        udp->datagrams_sent += count;
+        udp->bytes_sent += bytes;
+}
+
+void udp_on_recv(UdpOffload *udp, const struct msghdr *msgh, long bytes) {
+        if (bytes < 0) return;
+        int size = cmsg_segment_size(msgh, udp_gro_from_cmsg);
+        long count = segments(bytes, size);
+        if (count > 1) udp->gro_calls++;
+        udp->datagrams_received += count;
+        udp->bytes_received += bytes;
+}
+
+int udp_gso_from_cmsg(const struct cmsghdr *cmsg) {
+#ifdef UDP_SEGMENT
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_SEGMENT) {
+                uint16_t size;
+                memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+                return size;
+        }
+#endif
+        return 0;
+}
+
+int udp_gro_from_cmsg(const struct cmsghdr *cmsg) {
+#ifdef UDP_GRO
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int size;
+                memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+                return size;
+        }
+#endif
+        return 0;
+}
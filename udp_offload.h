@@ -0,0 +1,44 @@
+#ifndef UDP_OFFLOAD_H
+#define UDP_OFFLOAD_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+/* Segmentation offload of UDP sockets. With UDP_SEGMENT (GSO), a single send
+ * call carries a buffer that the kernel splits into datagrams of gso_size
+ * bytes, the last one possibly shorter. The size is set with the socket option
+ * or per call with a control message. With UDP_GRO, the kernel coalesces
+ * received datagrams of the same flow and returns them in a single receive
+ * call, with their size in a control message. Counting the datagrams rather
+ * than the calls shows how well an application amortizes its system calls. */
+
+typedef struct {
+        int gso_size;  // UDP_SEGMENT socket option, 0 if not set.
+        bool gro;      // UDP_GRO socket option enabled.
+        long send_calls;  // Successful send calls.
+        long datagrams_sent;
+        long bytes_sent;
+        long gso_calls;  // Send calls split into several datagrams.
+        long recv_calls;  // Successful receive calls.
+        long datagrams_received;
+        long bytes_received;
+        long gro_calls;  // Receive calls returning coalesced datagrams.
+} UdpOffload;
+
+void udp_on_setsockopt(UdpOffload *udp, int level, int optname,
+                       const void *optval, socklen_t optlen);
+
+// A successful send or receive call, which transferred one or several
+// messages (sendmmsg() and recvmmsg()).
+void udp_on_call(UdpOffload *udp, bool sent);
+
+// A message of bytes was sent or received. msgh is NULL for the calls
+// without ancillary data.
+void udp_on_send(UdpOffload *udp, const struct msghdr *msgh, long bytes);
+void udp_on_recv(UdpOffload *udp, const struct msghdr *msgh, long bytes);
+
+// Segment size of an UDP_SEGMENT or UDP_GRO control message, 0 if none.
+int udp_gso_from_cmsg(const struct cmsghdr *cmsg);
+int udp_gro_from_cmsg(const struct cmsghdr *cmsg);
+
+#endif
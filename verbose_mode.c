@@ -4,37 +4,361 @@
 #ifdef __ANDROID__
 #include <android/log.h>
 #endif
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 #include "constants.h"
 #include "init.h"
+#include "json_builder.h"
 #include "lib.h"
 #include "logger.h"
 
+/* The events are formatted on the thread of the application, then pushed to a
+ * bounded lock-free queue (multiple producers, one consumer, after D. Vyukov).
+ * A printer thread drains the queue every VERBOSE_FLUSH_MS and writes the
+ * lines in batches: the application never waits on the terminal or on the
+ * reader of the live stream. When the queue is full, events are dropped and
+ * counted. */
+
+#define VERBOSE_QUEUE_SIZE 1024  // Power of 2.
+#define VERBOSE_LINE_MAX 128
+#define VERBOSE_BATCH_MAX 16384
+#define VERBOSE_FLUSH_MS 50
+
+typedef struct {
+        atomic_size_t seq;
+        int sock_id;
+        char line[VERBOSE_LINE_MAX];  // Empty without -v.
+        char *json;                   // Only with -j.
+} Slot;
+
+typedef struct {
+        long sock_id;  // -1 for all sockets.
+        bool types[SOCK_EV_SUMMARY + 1];
+        bool errors_only;
+        long rate;  // Events per second, 0 for no limit.
+} Filter;
+
+typedef struct {
+        char buf[VERBOSE_BATCH_MAX];
+        size_t len;
+} Batch;
+
+static Slot slots[VERBOSE_QUEUE_SIZE];
+static atomic_size_t enqueue_pos;
+static atomic_size_t dequeue_pos;
+static atomic_long dropped;       // Queue full.
+static atomic_long rate_limited;  // Over the rate of the filter.
+static atomic_ulong rate_window_sec;
+static atomic_long rate_window_count;
+
+static Filter filter;
+static bool enabled = false;
+static pid_t pid;
+static int stream_fd = -1;
+static bool stream_is_socket;
+
+static pthread_mutex_t printer_mutex = MUTEX_ERRORCHECK;  // Consumer side.
+static bool printer_started = false;
+static Batch out_batch;
+static Batch stream_batch;
+
+// Line being formatted by the thread, in its slot.
+static __thread char *out_line;
+
+#define OUTPUT_EV(format, args...)                                        \
+        if (snprintf(out_line, VERBOSE_LINE_MAX, format, ##args) >=        \
+            VERBOSE_LINE_MAX)                                              \
+                LOG(ERROR, "snprintf() failed. Truncated");
+
+/* Private functions */
+
+static Slot *queue_claim(size_t *pos) {
+        *pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        while (true) {
+                Slot *slot = &slots[*pos & (VERBOSE_QUEUE_SIZE - 1)];
+                size_t seq =
+                    atomic_load_explicit(&slot->seq, memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)*pos;
+                if (diff == 0) {
+                        if (atomic_compare_exchange_weak_explicit(
+                                &enqueue_pos, pos, *pos + 1,
+                                memory_order_relaxed, memory_order_relaxed))
+                                return slot;
+                } else if (diff < 0) {
+                        return NULL;  // Full.
+                } else {
+                        *pos = atomic_load_explicit(&enqueue_pos,
+                                                    memory_order_relaxed);
+                }
+        }
+}
+
+static void queue_publish(Slot *slot, size_t pos) {
+        atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+// Single consumer, under printer_mutex.
+static Slot *queue_peek(size_t *pos) {
+        *pos = atomic_load_explicit(&dequeue_pos, memory_order_relaxed);
+        Slot *slot = &slots[*pos & (VERBOSE_QUEUE_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        return seq == *pos + 1 ? slot : NULL;
+}
+
+static void queue_release(Slot *slot, size_t pos) {
+        atomic_store_explicit(&slot->seq, pos + VERBOSE_QUEUE_SIZE,
+                              memory_order_release);
+        atomic_store_explicit(&dequeue_pos, pos + 1, memory_order_relaxed);
+}
+
+static void queue_init(void) {
+        for (size_t i = 0; i < VERBOSE_QUEUE_SIZE; i++) {
+                free(slots[i].json);
+                slots[i].json = NULL;
+                atomic_init(&slots[i].seq, i);
+        }
+        atomic_init(&enqueue_pos, 0);
+        atomic_init(&dequeue_pos, 0);
+        atomic_init(&dropped, 0);
+        atomic_init(&rate_limited, 0);
+        atomic_init(&rate_window_sec, 0);
+        atomic_init(&rate_window_count, 0);
+}
+
+static void parse_filter_term(const char *term) {
+        if (!strcmp(term, "errors")) {
+                filter.errors_only = true;
+        } else if (!strncmp(term, "sock=", 5)) {
+                filter.sock_id = atol(term + 5);
+        } else if (!strncmp(term, "rate=", 5)) {
+                filter.rate = atol(term + 5);
+        } else if (!strncmp(term, "type=", 5)) {
+                for (int i = 0; i <= SOCK_EV_SUMMARY; i++) {
+                        if (strcmp(term + 5, string_from_sock_event_type(i)))
+                                continue;
+                        filter.types[i] = true;
+                        return;
+                }
+                LOG(WARN, "Unknown event type in filter: %s.", term + 5);
+        } else {
+                LOG(WARN, "Unknown filter: %s.", term);
+        }
+}
+
+// Filter of -e, e.g. "sock=3,type=send,type=recv,errors,rate=100".
+static void parse_filter(const char *str) {
+        memset(&filter, 0, sizeof(filter));
+        filter.sock_id = -1;
+        bool any_type = true;
+        if (str) {
+                char *copy = strdup(str);
+                if (!copy) return;
+                char *save;
+                for (char *term = strtok_r(copy, ",", &save); term;
+                     term = strtok_r(NULL, ",", &save)) {
+                        parse_filter_term(term);
+                        if (!strncmp(term, "type=", 5)) any_type = false;
+                }
+                free(copy);
+        }
+        if (any_type)
+                for (int i = 0; i <= SOCK_EV_SUMMARY; i++)
+                        filter.types[i] = true;
+}
+
+static bool filter_match(const SockEvent *ev, int sock_id) {
+        if (filter.sock_id >= 0 && filter.sock_id != sock_id) return false;
+        if (!filter.types[ev->type]) return false;
+        if (filter.errors_only && ev->success) return false;
+        return true;
+}
+
+// Fixed window of one second, shared by the threads.
+static bool rate_allows(unsigned long time_usec) {
+        if (!filter.rate) return true;
+        unsigned long sec = time_usec / 1000000;
+        unsigned long window = atomic_load(&rate_window_sec);
+        if (sec != window &&
+            atomic_compare_exchange_strong(&rate_window_sec, &window, sec))
+                atomic_store(&rate_window_count, 0);
+        return atomic_fetch_add(&rate_window_count, 1) < filter.rate;
+}
+
+static void open_stream(void) {
+        if (!conf_opt_j) return;
+        struct stat st;
+        if (stat(conf_opt_j, &st)) goto error;
+        stream_is_socket = S_ISSOCK(st.st_mode);
+        if (stream_is_socket) {
+                struct sockaddr_un addr;
+                memset(&addr, 0, sizeof(addr));
+                addr.sun_family = AF_UNIX;
+                strncpy(addr.sun_path, conf_opt_j, sizeof(addr.sun_path) - 1);
+                stream_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (stream_fd == -1) goto error;
+                if (connect(stream_fd, (struct sockaddr *)&addr,
+                            sizeof(addr)))
+                        goto error1;
+        } else {
+                // Fails with ENXIO if no reader has opened the FIFO yet.
+                stream_fd = open(conf_opt_j, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+                if (stream_fd == -1) goto error;
+                if (fcntl(stream_fd, F_SETFL, 0)) goto error1;
+        }
+        return;
+error1:
+        close(stream_fd);
+        stream_fd = -1;
+error:
+        LOG(ERROR, "Could not open live stream %s. %s.", conf_opt_j,
+            strerror(errno));
+        LOG_FUNC_ERROR;
+}
+
+// The reader of a FIFO may go away: SIGPIPE is blocked during the write, and
+// consumed if raised, so that it does not kill the application.
+static void write_stream(const char *buf, size_t len) {
+        sigset_t pipe_set, old_set;
+        sigemptyset(&pipe_set);
+        sigaddset(&pipe_set, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+        while (len && stream_fd >= 0) {
+                ssize_t n = stream_is_socket
+                                ? send(stream_fd, buf, len, MSG_NOSIGNAL)
+                                : write(stream_fd, buf, len);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                        LOG(WARN, "Live stream closed. %s.",
+                            n ? strerror(errno) : "Nothing written");
+                        close(stream_fd);
+                        stream_fd = -2;  // Closed, not reopened.
+                        break;
+                }
+                buf += n;
+                len -= n;
+        }
+        if (!stream_is_socket) {
+                struct timespec zero = {0, 0};
+                sigtimedwait(&pipe_set, NULL, &zero);
+        }
+        pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+}
+
+static void write_out(const char *buf, size_t len) {
 #ifdef __ANDROID__
-#define OUTPUT_EV(format, args...) \
-        __android_log_print(ANDROID_LOG_VERBOSE, "tcpsnitch", format, ##args);
+        UNUSED(len);
+        __android_log_write(ANDROID_LOG_VERBOSE, "tcpsnitch", buf);
+#else
+        fwrite(buf, 1, len, _stdout);
+        fflush(_stdout);
+#endif
+}
 
-#else  // Not Android
-#define BUF_SIZE 512
+static void batch_flush(Batch *batch, bool stream) {
+        if (!batch->len) return;
+        batch->buf[batch->len] = '\0';
+        if (stream)
+                write_stream(batch->buf, batch->len);
+        else
+                write_out(batch->buf, batch->len);
+        batch->len = 0;
+}
 
-#define MKSTR(var, format, args...)                                 \
-        char var[BUF_SIZE];                                         \
-        if (snprintf(var, sizeof(var), format, ##args) >= BUF_SIZE) \
-                LOG(ERROR, "snprintf() failed. Truncated");
+static void batch_add(Batch *batch, bool stream, const char *str) {
+        size_t len = strlen(str);
+#ifdef __ANDROID__
+        // Lines are logged one by one.
+        if (!stream) {
+                write_out(str, len);
+                return;
+        }
+#endif
+        if (batch->len + len >= VERBOSE_BATCH_MAX) batch_flush(batch, stream);
+        if (len >= VERBOSE_BATCH_MAX) {
+                stream ? write_stream(str, len) : write_out(str, len);
+                return;
+        }
+        memcpy(batch->buf + batch->len, str, len);
+        batch->len += len;
+}
 
-#define STDOUT(format, args...)               \
-        MKSTR(_str, format, ##args);          \
-        if (_stdout)                          \
-                fprintf(_stdout, "%s", _str); \
-        else                                  \
-                write(STDOUT_FD, _str, sizeof(_str));
+static void add_slot(Slot *slot) {
+        char prefix[64];
+        if (slot->line[0]) {
+                snprintf(prefix, sizeof(prefix), "[pid %d] ", pid);
+                batch_add(&out_batch, false, prefix);
+                batch_add(&out_batch, false, slot->line);
+                batch_add(&out_batch, false, "\n");
+        }
+        if (slot->json) {
+                if (stream_fd >= 0) {
+                        snprintf(prefix, sizeof(prefix),
+                                 "{\"pid\": %d, \"socket\": %d, \"event\": ",
+                                 pid, slot->sock_id);
+                        batch_add(&stream_batch, true, prefix);
+                        batch_add(&stream_batch, true, slot->json);
+                        batch_add(&stream_batch, true, "}\n");
+                }
+                free(slot->json);
+                slot->json = NULL;
+        }
+}
 
-#define OUTPUT_EV(format, args...)  \
-        MKSTR(_ev, format, ##args); \
-        STDOUT("[pid %d] %s\n", getpid(), _ev);
-#endif  // #ifdef __ANDROID__
+static void add_drops(void) {
+        long queue_drops = atomic_exchange(&dropped, 0);
+        long rate_drops = atomic_exchange(&rate_limited, 0);
+        if (!queue_drops && !rate_drops) return;
+        char line[128];
+        snprintf(line, sizeof(line),
+                 "[pid %d] %ld event(s) dropped, %ld rate-limited\n", pid,
+                 queue_drops, rate_drops);
+        batch_add(&out_batch, false, line);
+}
+
+static int drain(void) {
+        int count = 0;
+        mutex_lock(&printer_mutex);
+        size_t pos;
+        Slot *slot;
+        while ((slot = queue_peek(&pos))) {
+                add_slot(slot);
+                queue_release(slot, pos);
+                count++;
+        }
+        if (conf_opt_v) add_drops();
+        batch_flush(&out_batch, false);
+        batch_flush(&stream_batch, true);
+        mutex_unlock(&printer_mutex);
+        return count;
+}
+
+static void *printer_thread(void *arg) {
+        UNUSED(arg);
+        LOG_FUNC_INFO;
+
+        struct timespec time;
+        time.tv_sec = 0;
+        time.tv_nsec = VERBOSE_FLUSH_MS * 1000 * 1000;
+        while (true) {
+                drain();
+                nanosleep(&time, NULL);
+        }
+        // Unreachable
+        return NULL;
+}
 
 static void output_ev_socket(const SockEvSocket *ev) {
         OUTPUT_EV("socket()=%d", ev->super.return_value);
@@ -190,6 +514,27 @@ static void output_ev_tcpinfo(const SockEvTcpInfo *ev) {
         OUTPUT_EV("tcp_info=%d", ev->super.return_value);
 }
 
+static void output_ev_tx_timestamps(const SockEvTxTimestamps *ev) {
+        OUTPUT_EV("tx_timestamps: %d send(s)", ev->sends_count);
+}
+
+static void output_ev_meminfo(const SockEvMeminfo *ev) {
+        OUTPUT_EV("meminfo: rmem %u/%u, %u drop(s)", ev->sample.rmem_alloc,
+                  ev->sample.rcvbuf, ev->sample.drops);
+}
+
+static void output_ev_anomaly(const SockEvAnomaly *ev) {
+        OUTPUT_EV("anomaly: %s %lu (baseline %lu)",
+                  anom_kind_str(ev->anomaly.kind), ev->anomaly.value,
+                  ev->anomaly.baseline);
+}
+
+static void output_ev_summary(const SockEvSummary *ev) {
+        OUTPUT_EV("summary: %ld request/response(s), sent %lu, received %lu",
+                  ev->analyses.rr->exchanges, ev->bytes_sent,
+                  ev->bytes_received);
+}
+
 static void output_ev_fcntl(const SockEvFcntl *ev) {
         OUTPUT_EV("fcntl=%d", ev->super.return_value);
 }
@@ -210,11 +555,44 @@ static void output_ev_fdopen(const SockEvFdopen *ev) {
         OUTPUT_EV("fdopen()=%d", ev->super.return_value);
 }
 
-void output_event(const SockEvent *ev) {
+/* Public functions */
+
+void verbose_init(void) {
+        if (!conf_opt_v && !conf_opt_j) return;
+        pid = getpid();
+        queue_init();
+        parse_filter(conf_opt_e);
+        open_stream();
+        enabled = true;
+        if (!printer_started) {
+                pthread_t thread;
+                my_pthread_create(&thread, NULL, printer_thread, NULL);
+                printer_started = true;
+        }
+}
+
+void output_event(const SockEvent *ev, int sock_id) {
+        if (!enabled || !filter_match(ev, sock_id)) return;
+        if (!rate_allows(ev->timestamp_usec)) {
+                atomic_fetch_add(&rate_limited, 1);
+                return;
+        }
+        size_t pos;
+        Slot *slot = queue_claim(&pos);
+        if (!slot) {
+                atomic_fetch_add(&dropped, 1);
+                return;
+        }
+        slot->sock_id = sock_id;
+        slot->line[0] = '\0';
+        slot->json = conf_opt_j ? alloc_sock_ev_json(ev) : NULL;
 #ifndef __ANDROID__
-        if (!_stdout) return;  // We don't bother handling a fdopen() fail.
+        // We don't bother handling a fdopen() fail.
+        if (!conf_opt_v || !_stdout) goto publish;
+#else
+        if (!conf_opt_v) goto publish;
 #endif
-        if (!conf_opt_v) return;
+        out_line = slot->line;
 
         switch (ev->type) {
                 case SOCK_EV_SOCKET:
@@ -348,5 +726,36 @@ void output_event(const SockEvent *ev) {
                 case SOCK_EV_TCP_INFO:
                         output_ev_tcpinfo((const SockEvTcpInfo *)ev);
                         break;
+                case SOCK_EV_TX_TIMESTAMPS:
+                        output_ev_tx_timestamps(
+                            (const SockEvTxTimestamps *)ev);
+                        break;
+                case SOCK_EV_MEMINFO:
+                        output_ev_meminfo((const SockEvMeminfo *)ev);
+                        break;
+                case SOCK_EV_ANOMALY:
+                        output_ev_anomaly((const SockEvAnomaly *)ev);
+                        break;
+                case SOCK_EV_SUMMARY:
+                        output_ev_summary((const SockEvSummary *)ev);
+                        break;
         }
+publish:
+        queue_publish(slot, pos);
+}
+
+void verbose_flush(void) {
+        if (enabled) drain();
+}
+
+void verbose_reset(void) {
+        mutex_init(&printer_mutex);
+        printer_started = false;  // Threads do not survive fork().
+        enabled = false;
+        queue_init();
+        out_batch.len = 0;
+        stream_batch.len = 0;
+        // The child opens its own stream.
+        if (stream_fd >= 0) close(stream_fd);
+        stream_fd = -1;
 }
@@ -3,6 +3,15 @@
 
 #include "sock_events.h"
 
-void output_event(const SockEvent *ev);
+/* Verbose output (-v) and live JSON stream (-j) of the events, filtered with
+ * -e. Written asynchronously by a printer thread. */
+
+void verbose_init(void);
+
+void output_event(const SockEvent *ev, int sock_id);
+
+void verbose_flush(void);  // Writes the queued events.
+
+void verbose_reset(void);  // Free state (called after fork()).
 
 #endif
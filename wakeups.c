@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+
+#include "wakeups.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+#define EPOLL_FDS_MAX 64  // Max number of epoll fds tracked per process.
+
+static pthread_mutex_t epoll_mutex = MUTEX_ERRORCHECK;
+static EpollWakeups epoll_fds[EPOLL_FDS_MAX];
+static int epoll_fds_count = 0;
+
+/* Private functions */
+
+static WakeupThread *get_thread(Wakeups *w, pid_t thread_id, bool create) {
+        for (int i = 0; i < w->threads_count; i++)
+                if (w->threads[i].thread_id == thread_id)
+                        return &w->threads[i];
+        if (!create) return NULL;
+        if (w->threads_count == WAKEUP_MAX_THREADS) {
+                w->threads_dropped++;
+                return NULL;
+        }
+        WakeupThread *t = &w->threads[w->threads_count++];
+        memset(t, 0, sizeof(WakeupThread));
+        t->thread_id = thread_id;
+        return t;
+}
+
+static void count_wakeup(Wakeups *w, WakeupThread *t) {
+        w->wakeups++;
+        if (t) t->wakeups++;
+}
+
+static void count_outcome(Wakeups *w, WakeupThread *t, WakeupOutcome outcome) {
+        switch (outcome) {
+                case WAKEUP_NONE:
+                        break;
+                case WAKEUP_PRODUCTIVE:
+                        w->productive++;
+                        if (t) t->productive++;
+                        break;
+                case WAKEUP_LOST_RACE:
+                        w->lost_races++;
+                        if (t) t->lost_races++;
+                        // Fall through - a lost race is also spurious.
+                case WAKEUP_SPURIOUS:
+                        w->spurious++;
+                        if (t) t->spurious++;
+                        break;
+        }
+}
+
+static void end_batch(Wakeups *w, WakeupThread *t) {
+        if (!t->in_batch) return;
+        histo_add(&w->calls_per_wakeup, t->batch);
+        t->in_batch = false;
+        t->batch = 0;
+}
+
+// Must be called with epoll_mutex held.
+static Wakeups *get_epoll_wakeups(int epfd) {
+        for (int i = 0; i < epoll_fds_count; i++)
+                if (epoll_fds[i].epfd == epfd) return &epoll_fds[i].wakeups;
+        if (epoll_fds_count == EPOLL_FDS_MAX) return NULL;
+        EpollWakeups *ew = &epoll_fds[epoll_fds_count++];
+        memset(ew, 0, sizeof(EpollWakeups));
+        ew->epfd = epfd;
+        return &ew->wakeups;
+}
+
+static char *alloc_epfd_line(int i, void *arg) {
+        UNUSED(arg);
+        return alloc_epoll_wakeups_json(&epoll_fds[i]);
+}
+
+/* Public functions */
+
+void wakeup_on_ready(Wakeups *w, pid_t thread_id, int epfd,
+                     unsigned long time_usec) {
+        WakeupThread *t = get_thread(w, thread_id, true);
+        count_wakeup(w, t);
+        if (!t) return;
+        // Previous notification was never followed by a read-side call.
+        if (t->pending) w->unconsumed++;
+        t->pending = true;
+        t->pending_epfd = epfd;
+        t->pending_usec = time_usec;
+        end_batch(w, t);
+        t->in_batch = true;
+}
+
+WakeupOutcome wakeup_on_consume(Wakeups *w, pid_t thread_id, bool success,
+                                int err, unsigned long time_usec, int *epfd) {
+        WakeupOutcome outcome = WAKEUP_NONE;
+        WakeupThread *t = get_thread(w, thread_id, false);
+        *epfd = -1;
+
+        if (t && t->pending) {
+                *epfd = t->pending_epfd;
+                t->pending = false;
+                if (success || (err != EAGAIN && err != EWOULDBLOCK))
+                        outcome = WAKEUP_PRODUCTIVE;
+                else if (w->last_consumer && w->last_consumer != thread_id &&
+                         w->last_consumed_usec >= t->pending_usec)
+                        outcome = WAKEUP_LOST_RACE;
+                else
+                        outcome = WAKEUP_SPURIOUS;
+                count_outcome(w, t, outcome);
+        }
+
+        if (t && t->in_batch) {
+                if (success)
+                        t->batch++;
+                else if (err == EAGAIN || err == EWOULDBLOCK)
+                        end_batch(w, t);
+        }
+
+        if (success) {
+                w->last_consumer = thread_id;
+                w->last_consumed_usec = time_usec;
+        }
+        return outcome;
+}
+
+void wakeup_flush(Wakeups *w) {
+        for (int i = 0; i < w->threads_count; i++) {
+                end_batch(w, &w->threads[i]);
+                if (!w->threads[i].pending) continue;
+                w->threads[i].pending = false;
+                w->unconsumed++;
+        }
+}
+
+double wakeup_spurious_ratio(const Wakeups *w) {
+        long classified = w->productive + w->spurious;
+        return classified ? (double)w->spurious / classified : 0;
+}
+
+void wakeup_epoll_on_ready(int epfd, pid_t thread_id) {
+        mutex_lock(&epoll_mutex);
+        Wakeups *w = get_epoll_wakeups(epfd);
+        if (w) count_wakeup(w, get_thread(w, thread_id, true));
+        mutex_unlock(&epoll_mutex);
+}
+
+void wakeup_epoll_on_outcome(int epfd, pid_t thread_id,
+                             WakeupOutcome outcome) {
+        mutex_lock(&epoll_mutex);
+        Wakeups *w = get_epoll_wakeups(epfd);
+        if (w) count_outcome(w, get_thread(w, thread_id, false), outcome);
+        mutex_unlock(&epoll_mutex);
+}
+
+void dump_all_epoll_wakeups(void) {
+        if (!logs_dir_path) return;
+        mutex_lock(&epoll_mutex);
+        if (!epoll_fds_count) goto exit;
+
+        LOG_FUNC_INFO;
+        if (!write_json_lines("epoll.json", false, epoll_fds_count, alloc_epfd_line, NULL))
+                goto error;
+        goto exit;
+error:
+        LOG(ERROR, "Could not write epoll wakeups.");
+        LOG_FUNC_ERROR;
+exit:
+        mutex_unlock(&epoll_mutex);
+}
+
+void wakeup_reset(void) {
+        mutex_init(&epoll_mutex);
+        epoll_fds_count = 0;
+}
@@ -0,0 +1,82 @@
+#ifndef WAKEUPS_H
+#define WAKEUPS_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "histogram.h"
+
+/* Correlates the readiness notifications returned to a thread by poll(),
+ * select() or epoll_wait() with the next call made by the same thread on the
+ * socket. A notification followed by a successful accept()/recv()/read() is
+ * productive. One followed by EAGAIN is spurious: if another thread consumed
+ * the socket in the meantime, the thread lost the race (thundering herd). */
+
+#define WAKEUP_MAX_THREADS 16  // Threads tracked per socket or epoll fd.
+
+typedef enum WakeupOutcome {
+        WAKEUP_NONE,  // No pending notification for this thread.
+        WAKEUP_PRODUCTIVE,
+        WAKEUP_SPURIOUS,
+        WAKEUP_LOST_RACE  // Spurious, another thread consumed the socket.
+} WakeupOutcome;
+
+typedef struct {
+        pid_t thread_id;
+        long wakeups;
+        long productive;
+        long spurious;    // Including lost races.
+        long lost_races;  // Spurious, another thread consumed the socket.
+        // Pending notification, only used for sockets.
+        bool pending;
+        int pending_epfd;  // -1 for poll() and select().
+        unsigned long pending_usec;
+        // Successful calls since the last notification, only for sockets.
+        bool in_batch;
+        long batch;
+} WakeupThread;
+
+typedef struct {
+        long wakeups;
+        long productive;
+        long spurious;
+        long lost_races;
+        long unconsumed;  // Notifications not followed by a read-side call.
+        pid_t last_consumer;  // Last thread that consumed the socket.
+        unsigned long last_consumed_usec;
+        int threads_count;
+        long threads_dropped;  // Wakeups of threads beyond WAKEUP_MAX_THREADS.
+        WakeupThread threads[WAKEUP_MAX_THREADS];
+        // Successful calls (e.g. accept() batch size) per notification.
+        Histogram calls_per_wakeup;
+} Wakeups;
+
+typedef struct {
+        int epfd;
+        Wakeups wakeups;
+} EpollWakeups;
+
+// A readiness notification for reading was returned to thread_id.
+void wakeup_on_ready(Wakeups *w, pid_t thread_id, int epfd,
+                     unsigned long time_usec);
+
+/* thread_id called accept()/recv()/read()... on the socket. Returns the
+ * outcome of its pending notification, and the epoll fd it came from. */
+WakeupOutcome wakeup_on_consume(Wakeups *w, pid_t thread_id, bool success,
+                                int err, unsigned long time_usec, int *epfd);
+
+// Count pending notifications as unconsumed and close the open batches.
+void wakeup_flush(Wakeups *w);
+
+double wakeup_spurious_ratio(const Wakeups *w);
+
+// Per epoll fd statistics for the whole process.
+
+void wakeup_epoll_on_ready(int epfd, pid_t thread_id);
+
+void wakeup_epoll_on_outcome(int epfd, pid_t thread_id, WakeupOutcome outcome);
+
+void dump_all_epoll_wakeups(void);  // Written to epoll.json.
+
+void wakeup_reset(void);  // Free state (called after fork()).
+
+#endif
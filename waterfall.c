@@ -0,0 +1,191 @@
+#define _GNU_SOURCE
+
+#include "waterfall.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "init.h"
+#include "json_builder.h"
+#include "lib.h"
+#include "logger.h"
+#include "string_builders.h"
+
+static pthread_mutex_t wf_mutex = MUTEX_ERRORCHECK;
+static WfDest dests[WF_DESTS_MAX];
+static int dests_count = 0;
+static long dests_dropped = 0;  // Connections to untracked destinations.
+
+/* Private functions */
+
+static long elapsed(unsigned long from, unsigned long to) {
+        if (!from || !to) return -1;
+        return to > from ? (long)(to - from) : 0;
+}
+
+static void set_established(Waterfall *wf, unsigned long usec) {
+        wf->connecting = false;
+        if (!wf->established_usec) wf->established_usec = usec;
+}
+
+static bool same_dest(const WfDest *dest, const Waterfall *wf) {
+        return dest->accepted == wf->accepted &&
+               same_inet_addr((const struct sockaddr *)&dest->addr,
+                              (const struct sockaddr *)&wf->addr);
+}
+
+static WfDest *get_dest(const Waterfall *wf) {
+        for (int i = 0; i < dests_count; i++)
+                if (same_dest(&dests[i], wf)) return &dests[i];
+        if (dests_count == WF_DESTS_MAX) return NULL;
+        WfDest *dest = &dests[dests_count++];
+        memcpy(&dest->addr, &wf->addr, wf->addr_len);
+        dest->addr_len = wf->addr_len;
+        dest->accepted = wf->accepted;
+        return dest;
+}
+
+static void add_phase(Histogram *histo, long usec) {
+        if (usec >= 0) histo_add(histo, usec);
+}
+
+static char *alloc_dest_line(int i, void *arg) {
+        UNUSED(arg);
+        return alloc_wf_dest_json(&dests[i]);
+}
+
+/* Public functions */
+
+void wf_on_connect(Waterfall *wf, const struct sockaddr *addr, socklen_t len,
+                   const DnsLink *dns, bool success, bool in_progress,
+                   unsigned long start_usec, unsigned long end_usec) {
+        if (wf->tracked || !addr || len > sizeof(wf->addr)) return;
+        if (!success && !in_progress) return;
+        wf->tracked = true;
+        memcpy(&wf->addr, addr, len);
+        wf->addr_len = len;
+        if (dns) wf->dns = *dns;
+        wf->connect_usec = start_usec;
+        if (success)
+                set_established(wf, end_usec);
+        else
+                wf->connecting = true;
+}
+
+void wf_on_accept(Waterfall *wf, int fd, unsigned long end_usec) {
+        wf->addr_len = sizeof(wf->addr);
+        if (my_getsockname(fd, (struct sockaddr *)&wf->addr, &wf->addr_len))
+                return;
+        wf->tracked = true;
+        wf->accepted = true;
+        wf->connect_usec = end_usec;
+        set_established(wf, end_usec);
+}
+
+void wf_on_call(Waterfall *wf, int fd, unsigned long end_usec) {
+        if (!wf->connecting) return;
+        struct tcp_info info;
+        if (fill_tcp_info(fd, &info)) return;
+        if (info.tcpi_state == TCP_SYN_SENT) return;
+        if (info.tcpi_state == TCP_CLOSE)
+                wf->connecting = false;  // The connection failed.
+        else
+                set_established(wf, end_usec);
+}
+
+void wf_on_data(Waterfall *wf, bool sent, long bytes, unsigned long start_usec,
+                unsigned long end_usec) {
+        if (!wf->tracked || bytes <= 0) return;
+        if (wf->connecting) set_established(wf, end_usec);
+        unsigned long usec = sent ? start_usec : end_usec;
+        if (sent && !wf->first_sent_usec) wf->first_sent_usec = usec;
+        if (!sent && !wf->first_recv_usec) wf->first_recv_usec = usec;
+        if (!wf->first_data_usec) wf->first_data_usec = usec;
+        if (wf->last_data_usec && usec > wf->last_data_usec + WF_IDLE_USEC) {
+                unsigned long gap = usec - wf->last_data_usec;
+                wf->idle_gaps++;
+                wf->idle_usec += gap;
+                if (gap > wf->max_idle_usec) wf->max_idle_usec = gap;
+        }
+        if (usec > wf->last_data_usec) wf->last_data_usec = usec;
+}
+
+void wf_on_shutdown(Waterfall *wf, unsigned long start_usec) {
+        if (!wf->close_start_usec) wf->close_start_usec = start_usec;
+}
+
+void wf_on_close(Waterfall *wf, unsigned long start_usec,
+                 unsigned long end_usec) {
+        wf_on_shutdown(wf, start_usec);
+        wf->closed_usec = end_usec;
+}
+
+void wf_phases(const Waterfall *wf, WfPhases *phases) {
+        phases->dns = wf->dns.found ? (long)wf->dns.duration_usec : -1;
+        phases->connect = wf->accepted
+                              ? -1
+                              : elapsed(wf->connect_usec, wf->established_usec);
+        phases->first_byte_sent =
+            elapsed(wf->established_usec, wf->first_sent_usec);
+        phases->first_byte_received =
+            elapsed(wf->established_usec, wf->first_recv_usec);
+        phases->transfer = elapsed(wf->first_data_usec, wf->last_data_usec);
+        phases->close_wait =
+            elapsed(wf->last_data_usec ? wf->last_data_usec
+                                       : wf->established_usec,
+                    wf->close_start_usec);
+        phases->close = elapsed(wf->close_start_usec, wf->closed_usec);
+}
+
+void wf_aggregate(Waterfall *wf) {
+        if (!wf->tracked || wf->aggregated) return;
+        wf->aggregated = true;
+        WfPhases phases;
+        wf_phases(wf, &phases);
+        mutex_lock(&wf_mutex);
+        WfDest *dest = get_dest(wf);
+        if (!dest) {
+                dests_dropped++;
+                goto exit;
+        }
+        dest->connections++;
+        add_phase(&dest->dns, phases.dns);
+        add_phase(&dest->connect, phases.connect);
+        add_phase(&dest->first_byte_sent, phases.first_byte_sent);
+        add_phase(&dest->first_byte_received, phases.first_byte_received);
+        add_phase(&dest->transfer, phases.transfer);
+        if (wf->first_data_usec) histo_add(&dest->idle, wf->idle_usec);
+        add_phase(&dest->close_wait, phases.close_wait);
+        add_phase(&dest->close, phases.close);
+exit:
+        mutex_unlock(&wf_mutex);
+}
+
+void dump_all_waterfalls(void) {
+        if (!logs_dir_path) return;
+        mutex_lock(&wf_mutex);
+        if (!dests_count) goto exit;
+
+        LOG_FUNC_INFO;
+        if (dests_dropped)
+                LOG(WARN, "%ld connections to untracked destinations.",
+                    dests_dropped);
+        if (!write_json_lines("waterfall.json", false, dests_count, alloc_dest_line, NULL))
+                goto error;
+        goto exit;
+error:
+        LOG(ERROR, "Could not write the connection phases.");
+        LOG_FUNC_ERROR;
+exit:
+        mutex_unlock(&wf_mutex);
+}
+
+void wf_reset(void) {
+        mutex_init(&wf_mutex);
+        memset(dests, 0, sizeof(dests));
+        dests_count = 0;
+        dests_dropped = 0;
+}
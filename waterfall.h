@@ -0,0 +1,107 @@
+#ifndef WATERFALL_H
+#define WATERFALL_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+#include "histogram.h"
+#include "name_resolution.h"
+
+/* Phases of a connection, as in the network panel of a browser: name
+ * resolution (when done in-process and linked to the connect()), TCP connect,
+ * time to the first byte sent and received, transfer, idle gaps, and close.
+ * They are computed from the calls of the application as they happen:
+ * - dns: duration of the resolution that produced the connected address;
+ * - connect: from the connect() call to its return or, for a non-blocking
+ *   connect(), to the first call of the application that finds the connection
+ *   established (an upper bound);
+ * - first_byte_sent / first_byte_received: from the connection established
+ *   (or accepted) to the first send call and to the return of the first
+ *   receive call carrying data;
+ * - transfer: from the first data call to the last one, with the gaps of more
+ *   than WF_IDLE_USEC between data calls counted as idle;
+ * - close_wait: from the last data call to shutdown(SHUT_WR) or close();
+ * - close: from there to the return of close(), which includes the wait for
+ *   the unsent data with SO_LINGER.
+ * Each connection gets its phases in its summary, and the phases are
+ * aggregated per destination (or per local address for accepted connections)
+ * for the whole process in waterfall.json. */
+
+#define WF_IDLE_USEC 100000  // Gaps between data calls counted as idle.
+#define WF_DESTS_MAX 64      // Destinations tracked per process.
+
+typedef struct {
+        bool tracked;   // Connected or accepted.
+        bool accepted;
+        bool connecting;  // Non-blocking connect() not seen established yet.
+        bool aggregated;  // Accounted in its destination.
+        struct sockaddr_storage addr;  // Destination, or local address.
+        socklen_t addr_len;
+        DnsLink dns;
+        unsigned long connect_usec;      // connect() called, or accept().
+        unsigned long established_usec;  // 0 until established.
+        unsigned long first_sent_usec;
+        unsigned long first_recv_usec;
+        unsigned long first_data_usec;
+        unsigned long last_data_usec;
+        long idle_gaps;
+        unsigned long idle_usec;
+        unsigned long max_idle_usec;
+        unsigned long close_start_usec;  // shutdown(SHUT_WR) or close().
+        unsigned long closed_usec;       // close() returned.
+} Waterfall;
+
+// Phases of a connection, -1 if not reached.
+typedef struct {
+        long dns;
+        long connect;
+        long first_byte_sent;
+        long first_byte_received;
+        long transfer;
+        long close_wait;
+        long close;
+} WfPhases;
+
+typedef struct {
+        struct sockaddr_storage addr;
+        socklen_t addr_len;
+        bool accepted;
+        long connections;
+        Histogram dns;
+        Histogram connect;
+        Histogram first_byte_sent;
+        Histogram first_byte_received;
+        Histogram transfer;
+        Histogram idle;
+        Histogram close_wait;
+        Histogram close;
+} WfDest;
+
+// connect() was called at start_usec and returned at end_usec.
+void wf_on_connect(Waterfall *wf, const struct sockaddr *addr, socklen_t len,
+                   const DnsLink *dns, bool success, bool in_progress,
+                   unsigned long start_usec, unsigned long end_usec);
+
+// accept() returned fd at end_usec.
+void wf_on_accept(Waterfall *wf, int fd, unsigned long end_usec);
+
+// Any other call of the application on fd.
+void wf_on_call(Waterfall *wf, int fd, unsigned long end_usec);
+
+void wf_on_data(Waterfall *wf, bool sent, long bytes, unsigned long start_usec,
+                unsigned long end_usec);
+
+void wf_on_shutdown(Waterfall *wf, unsigned long start_usec);
+
+void wf_on_close(Waterfall *wf, unsigned long start_usec,
+                 unsigned long end_usec);
+
+void wf_phases(const Waterfall *wf, WfPhases *phases);
+
+// Accounts for the connection in its destination, once.
+void wf_aggregate(Waterfall *wf);
+
+void dump_all_waterfalls(void);  // Written to waterfall.json.
+
+void wf_reset(void);  // Free state (called after fork()).
+
+#endif